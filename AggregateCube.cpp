@@ -0,0 +1,174 @@
+#include "AggregateCube.h"
+#include "Metrics.h"
+
+#include <algorithm>
+
+using namespace std;
+
+static void addToCell(CubeCell& cell, const CubeCell& other) {
+    cell.totals += other.totals;
+    cell.rows += other.rows;
+}
+
+AggregateCube::AggregateCube(const TableView& table) {
+    METRICS_TIMER(timer, STAGE_AGGREGATE);
+    METRICS_ITEMS(timer, table.rows);
+    if (table.rows == 0) {
+        resize(table.airports, 1, 0);
+        return;
+    }
+    int first = periodYear(table.period[0]);
+    int last = first;
+    for (size_t i = 0; i < table.rows; i++) {
+        int year = periodYear(table.period[i]);
+        first = min(first, year);
+        last = max(last, year);
+    }
+    resize(table.airports, first, last);
+
+    // Base cells first, then the roll-ups are filled from them in one pass over the cube
+    for (size_t i = 0; i < table.rows; i++) {
+        if (periodMonth(table.period[i]) < 1 || periodMonth(table.period[i]) > 12) {
+            continue; // Not a real month, no cell for it
+        }
+        CubeCell& base = cells[index(table.airport[i] + 1, periodYear(table.period[i]) - minYear + 1, periodMonth(table.period[i]))];
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (table.counters[c] != nullptr) {
+                base.totals.sums[c] += table.counters[c][i];
+            }
+        }
+        base.rows++;
+    }
+    for (size_t a = 1; a <= airports; a++) {
+        for (size_t y = 1; y < yearSlots(); y++) {
+            for (int m = 1; m <= 12; m++) {
+                const CubeCell& base = cells[index(a, y, m)];
+                addToCell(cells[index(a, y, WHOLE_YEAR)], base);
+                addToCell(cells[index(a, ALL_YEARS, m)], base);
+                addToCell(cells[index(0, y, m)], base);
+            }
+        }
+    }
+    for (size_t a = 1; a <= airports; a++) {
+        for (size_t y = 1; y < yearSlots(); y++) {
+            addToCell(cells[index(0, y, WHOLE_YEAR)], cells[index(a, y, WHOLE_YEAR)]);
+        }
+        for (int m = 1; m <= 12; m++) {
+            addToCell(cells[index(0, ALL_YEARS, m)], cells[index(a, ALL_YEARS, m)]);
+        }
+    }
+    for (size_t a = 0; a <= airports; a++) {
+        for (size_t y = 1; y < yearSlots(); y++) {
+            addToCell(cells[index(a, ALL_YEARS, WHOLE_YEAR)], cells[index(a, y, WHOLE_YEAR)]);
+        }
+    }
+}
+
+AggregateCube::AggregateCube(const CubeCell* cells, size_t airports, int minYear, int maxYear, size_t yearStride)
+    : airports(airports), minYear(minYear), maxYear(maxYear), yearStride(yearStride), mapped(cells) {}
+
+AggregateCube::AggregateCube(const AggregateCube& other)
+    : airports(other.airports), minYear(other.minYear), maxYear(other.maxYear), yearStride(other.yearStride),
+      cells(other.cells) {
+    if (other.mapped != nullptr) {
+        cells.assign(other.mapped, other.mapped + other.cellCount());
+    }
+}
+
+AggregateCube& AggregateCube::operator=(const AggregateCube& other) {
+    if (this != &other) {
+        AggregateCube copy(other);
+        *this = move(copy);
+    }
+    return *this;
+}
+
+void AggregateCube::ownCells() {
+    if (mapped != nullptr) {
+        cells.assign(mapped, mapped + cellCount());
+        mapped = nullptr;
+    }
+}
+
+const CubeCell& AggregateCube::cell(int airport, int year, int month) const {
+    if (airport < ALL_AIRPORTS || airport >= static_cast<int>(airports) || month < 0 || month > 12) {
+        return empty;
+    }
+    if (year != ALL_YEARS && !hasYear(year)) {
+        return empty;
+    }
+    size_t yearSlot = year == ALL_YEARS ? 0 : static_cast<size_t>(year - minYear + 1);
+    return cellData()[index(static_cast<size_t>(airport + 1), yearSlot, month)];
+}
+
+void AggregateCube::resize(size_t newAirports, int newMinYear, int newMaxYear, size_t newYearStride) {
+    ownCells();
+    AggregateCube grown;
+    grown.airports = newAirports;
+    grown.minYear = newMinYear;
+    grown.maxYear = newMaxYear;
+    grown.yearStride = max(grown.yearSlots(), newYearStride);
+    grown.cells.assign((newAirports + 1) * grown.yearStride * 13, CubeCell());
+    if (!cells.empty()) {
+        for (size_t a = 0; a <= airports; a++) {
+            for (size_t y = 0; y < yearSlots(); y++) {
+                size_t newYearSlot = y == 0 ? 0 : static_cast<size_t>(minYear + static_cast<int>(y) - 1 - newMinYear + 1);
+                for (int m = 0; m <= 12; m++) {
+                    grown.cells[grown.index(a, newYearSlot, m)] = cells[index(a, y, m)];
+                }
+            }
+        }
+    }
+    airports = grown.airports;
+    minYear = grown.minYear;
+    maxYear = grown.maxYear;
+    yearStride = grown.yearStride;
+    cells.swap(grown.cells);
+}
+
+// Appends grow the axes in place where they can: new airports go after the last one (the
+// vector's own geometric growth), new years into spare year slots; only a year before the
+// first one or past the spare slots re-lays the cube out, with about twice the year slots
+void AggregateCube::grow(size_t newAirports, int year) {
+    ownCells();
+    if (minYear > maxYear) {
+        resize(newAirports, year, year);
+        return;
+    }
+    if (year < minYear || static_cast<size_t>(year - minYear + 2) > yearStride) {
+        int newMin = min(minYear, year);
+        int newMax = max(maxYear, year);
+        size_t slots = static_cast<size_t>(newMax - newMin + 2);
+        resize(newAirports, newMin, newMax, year > maxYear ? 2 * slots - 1 : slots);
+        return;
+    }
+    maxYear = max(maxYear, year);
+    if (newAirports > airports) {
+        airports = newAirports;
+        cells.resize((airports + 1) * yearStride * 13);
+    }
+}
+
+void AggregateCube::addRow(uint32_t airport, uint16_t period, const int32_t values[COUNTER_COUNT]) {
+    int year = periodYear(period);
+    int month = periodMonth(period);
+    if (month < 1 || month > 12) {
+        return;
+    }
+    if (airport >= airports || !hasYear(year)) {
+        grow(max(airports, static_cast<size_t>(airport) + 1), year);
+    }
+    ownCells();
+    size_t yearSlot = static_cast<size_t>(year - minYear + 1);
+    for (size_t a : { static_cast<size_t>(airport) + 1, size_t(0) }) {
+        for (size_t y : { yearSlot, size_t(0) }) {
+            for (int m : { month, WHOLE_YEAR }) {
+                CubeCell& target = cells[index(a, y, m)];
+                for (int c = 0; c < COUNTER_COUNT; c++) {
+                    target.totals.sums[c] += values[c];
+                }
+                target.rows++;
+            }
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "ColumnStore.h"
+#include "Kernels.h"
+
+#include <cstdint>
+#include <vector>
+
+// One cube cell: counter sums plus how many table rows went into them
+using CubeCell = RowTotals;
+
+// Pre-aggregated counter sums for every (airport x year x month), built once at load time
+// Roll-ups are cells of their own: ALL_AIRPORTS, ALL_YEARS and month 0 (all months)
+// so every lookup is a single index computation whatever the history length
+class AggregateCube {
+public:
+    static const int ALL_AIRPORTS = -1;
+    static const int ALL_YEARS = 0;
+    static const int WHOLE_YEAR = 0; // Month slot holding the sum of the 12 months
+
+    AggregateCube() = default;
+    explicit AggregateCube(const TableView& table);
+    // Cube over cells laid out like cellData() of another cube, e.g. mapped from a snapshot;
+    // they are used in place until a row is added or ownCells() copies them
+    AggregateCube(const CubeCell* cells, size_t airports, int minYear, int maxYear, size_t yearStride);
+    // A copy always owns its cells, it may outlive the mapping of the original
+    AggregateCube(const AggregateCube& other);
+    AggregateCube& operator=(const AggregateCube& other);
+    AggregateCube(AggregateCube&&) = default;
+    AggregateCube& operator=(AggregateCube&&) = default;
+
+    const CubeCell& cell(int airport, int year, int month) const;
+    // Adds one row to its cell and every roll-up above it, growing the axes if needed
+    void addRow(uint32_t airport, uint16_t period, const int32_t values[COUNTER_COUNT]);
+
+    size_t airportCount() const { return airports; }
+    int firstYear() const { return minYear; }
+    int lastYear() const { return maxYear; }
+    bool hasYear(int year) const { return year >= minYear && year <= maxYear; }
+    size_t memoryUsage() const { return mapped != nullptr ? cellCount() * sizeof(CubeCell) : cells.capacity() * sizeof(CubeCell); }
+
+    // The cell array and its year capacity, what a snapshot stores
+    const CubeCell* cellData() const { return mapped != nullptr ? mapped : cells.data(); }
+    size_t cellCount() const { return (airports + 1) * yearStride * 13; }
+    size_t yearCapacity() const { return yearStride; }
+    // Copies mapped cells into the cube, before the mapping goes away
+    void ownCells();
+
+private:
+    // Airport slot 0 and year slot 0 are the roll-ups, real ids/years start at 1
+    // Each airport has room for yearStride year slots, the ones past maxYear stay empty until
+    // appended rows reach them, so a delta with a new year rarely moves the cube
+    size_t index(size_t airportSlot, size_t yearSlot, int month) const {
+        return (airportSlot * yearStride + yearSlot) * 13 + month;
+    }
+    size_t yearSlots() const { return minYear > maxYear ? 1 : static_cast<size_t>(maxYear - minYear + 2); }
+    void resize(size_t newAirports, int newMinYear, int newMaxYear, size_t newYearStride = 0);
+    void grow(size_t newAirports, int year);
+
+    size_t airports = 0;
+    int minYear = 1;
+    int maxYear = 0;
+    size_t yearStride = 1;
+    std::vector<CubeCell> cells;
+    const CubeCell* mapped = nullptr; // Cells used in place, `cells` is empty meanwhile
+    CubeCell empty;
+};
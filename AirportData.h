@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Arena.h"
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct CsvRow;
+struct TableView;
+
+struct AirportData {
+    std::string code; //Airport 3-letter Code
+    std::string name; //Airport Name
+    std::string month; //Travel Month
+    std::string year; //Year Stats
+    int carrier; //Number of delays due to carrier
+    int late; //Number of delays due to late arrival of aircraft
+    int navis; //Number of delays due to National Aviation System
+    int security; //Number of delays due to security
+    int weather; //Number of delays due to weather
+    int canceled; //Number of canceled flights
+    int delayed; //Number of delayed flights
+    int total_flights; //Number of Total Flights
+};
+
+// Structure for Trie Node
+// Its containers allocate from the memory resource it was made with, the owning trie's arena
+struct TrieNode {
+    explicit TrieNode(std::pmr::memory_resource* memory) : children(memory), airport_data(memory) {}
+
+    std::pmr::unordered_map<char, TrieNode*> children;
+    std::pmr::vector<AirportData> airport_data;
+};
+
+// Owns one trie: nodes, child maps and row arrays all live in a single arena, so dropping
+// the trie (e.g. on reload) hands its memory back in whole blocks instead of node by node
+class Trie {
+public:
+    Trie() = default;
+    Trie(Trie&& other) noexcept;
+    Trie& operator=(Trie&& other) noexcept;
+    ~Trie();
+
+    // Made on first use, so a default-constructed trie allocates nothing
+    TrieNode* root();
+    TrieNode* root() const { return top; }
+    // Byte-exact size of the nodes and containers; row strings too long for the small-string
+    // buffer (airport names) are on the heap and not included
+    size_t bytesUsed() const { return memory ? memory->bytesUsed() : 0; }
+    size_t bytesLive() const { return memory ? memory->bytesLive() : 0; }
+    size_t bytesReserved() const { return memory ? memory->bytesReserved() : 0; }
+    size_t blockCount() const { return memory ? memory->blockCount() : 0; }
+    // Drops every node and row; the arena's blocks go back to the heap at once
+    void clear();
+
+    // A node allocated from `memory`, for inserting below an existing node
+    static TrieNode* newNode(std::pmr::memory_resource* memory);
+
+private:
+    std::unique_ptr<Arena> memory; // Behind a pointer so moving the trie keeps node pointers valid
+    TrieNode* top = nullptr;
+};
+
+// Defined in Source.cpp
+void GetAirportInfo(AirportData& data, const CsvRow& columns);
+void GetAirportInfo(AirportData& data, const TableView& table, size_t row);
+void insertTrie(TrieNode* root, const AirportData& data);
+Trie buildTrie(const std::string& filename);
+std::unordered_map<std::string, std::vector<AirportData>> buildHashTable(const std::string& filename);
+// Same structures filled from already loaded columns instead of the CSV text
+Trie buildTrie(const TableView& table);
+std::unordered_map<std::string, std::vector<AirportData>> buildHashTable(const TableView& table);
+std::string toUpper(const std::string& str);
+std::string toLower(const std::string& str);
+void traverseTrie(TrieNode* root, std::vector<std::pair<std::string, std::vector<AirportData>>>& airportData);
+std::string isValidMonth(const std::string& month);
@@ -0,0 +1,369 @@
+#include "AirportSearch.h"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <set>
+
+using namespace std;
+
+vector<string> searchWords(string_view text) {
+    vector<string> words;
+    string word;
+    for (char c : text) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (isalnum(u)) {
+            word += static_cast<char>(tolower(u));
+        }
+        else if (c != '\'') {
+            if (!word.empty()) {
+                words.push_back(word);
+            }
+            word.clear();
+        }
+    }
+    if (!word.empty()) {
+        words.push_back(word);
+    }
+    return words;
+}
+
+void RankedTrie::build(vector<pair<string, uint32_t>> keys, const vector<long long>& traffic, size_t topN) {
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+    sorted = move(keys);
+    rank = &traffic;
+    this->topN = topN;
+    nodes.assign(1, Node{ 0, 0, 0, 0, 0, 0, 0 });
+    terminals.clear();
+    tops.clear();
+    buildNode(0, 0, sorted.size(), 0);
+    sorted = {};
+    rank = nullptr;
+}
+
+// Keys [lo, hi) share their first `depth` characters; the node's children are laid out
+// next to each other before any of them is filled, so a node only needs a range
+void RankedTrie::buildNode(uint32_t index, size_t lo, size_t hi, size_t depth) {
+    size_t i = lo;
+    nodes[index].terminalBegin = static_cast<uint32_t>(terminals.size());
+    for (; i < hi && sorted[i].first.size() == depth; i++) {
+        terminals.push_back(sorted[i].second);
+    }
+    nodes[index].terminalCount = static_cast<uint32_t>(terminals.size()) - nodes[index].terminalBegin;
+
+    vector<pair<size_t, size_t>> groups;
+    while (i < hi) {
+        size_t end = i;
+        while (end < hi && sorted[end].first[depth] == sorted[i].first[depth]) {
+            end++;
+        }
+        groups.emplace_back(i, end);
+        i = end;
+    }
+    uint32_t first = static_cast<uint32_t>(nodes.size());
+    nodes[index].firstChild = first;
+    nodes[index].childCount = static_cast<uint32_t>(groups.size());
+    for (const auto& group : groups) {
+        nodes.push_back(Node{ sorted[group.first].first[depth], 0, 0, 0, 0, 0, 0 });
+    }
+    for (size_t g = 0; g < groups.size(); g++) {
+        buildNode(first + static_cast<uint32_t>(g), groups[g].first, groups[g].second, depth + 1);
+    }
+
+    // Best of the own terminals and the children's lists
+    vector<uint32_t> candidates(terminals.begin() + nodes[index].terminalBegin,
+                                terminals.begin() + nodes[index].terminalBegin + nodes[index].terminalCount);
+    for (size_t g = 0; g < groups.size(); g++) {
+        const Node& child = nodes[first + g];
+        candidates.insert(candidates.end(), tops.begin() + child.topBegin, tops.begin() + child.topBegin + child.topCount);
+    }
+    const vector<long long>& traffic = *rank;
+    sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+        return traffic[a] > traffic[b] || (traffic[a] == traffic[b] && a < b);
+    });
+    candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+    candidates.resize(min(candidates.size(), topN));
+    nodes[index].topBegin = static_cast<uint32_t>(tops.size());
+    nodes[index].topCount = static_cast<uint32_t>(candidates.size());
+    tops.insert(tops.end(), candidates.begin(), candidates.end());
+}
+
+int32_t RankedTrie::child(uint32_t node, char c) const {
+    const Node& parent = nodes[node];
+    for (uint32_t i = parent.firstChild; i < parent.firstChild + parent.childCount; i++) {
+        if (nodes[i].label == c) {
+            return static_cast<int32_t>(i);
+        }
+    }
+    return -1;
+}
+
+int32_t RankedTrie::find(string_view prefix) const {
+    if (nodes.empty()) {
+        return -1;
+    }
+    int32_t node = 0;
+    for (char c : prefix) {
+        node = child(static_cast<uint32_t>(node), static_cast<char>(tolower(static_cast<unsigned char>(c))));
+        if (node < 0) {
+            return -1;
+        }
+    }
+    return node;
+}
+
+vector<uint32_t> RankedTrie::complete(string_view prefix) const {
+    int32_t node = find(prefix);
+    if (node < 0) {
+        return {};
+    }
+    return vector<uint32_t>(tops.begin() + nodes[node].topBegin, tops.begin() + nodes[node].topBegin + nodes[node].topCount);
+}
+
+vector<uint32_t> RankedTrie::matching(string_view prefix) const {
+    vector<uint32_t> airports;
+    int32_t start = find(prefix);
+    if (start < 0) {
+        return airports;
+    }
+    vector<uint32_t> pending(1, static_cast<uint32_t>(start));
+    while (!pending.empty()) {
+        const Node& node = nodes[pending.back()];
+        pending.pop_back();
+        airports.insert(airports.end(), terminals.begin() + node.terminalBegin,
+                        terminals.begin() + node.terminalBegin + node.terminalCount);
+        for (uint32_t c = node.firstChild; c < node.firstChild + node.childCount; c++) {
+            pending.push_back(c);
+        }
+    }
+    sort(airports.begin(), airports.end());
+    airports.erase(unique(airports.begin(), airports.end()), airports.end());
+    return airports;
+}
+
+// One Levenshtein row per trie level; a subtree is skipped once its whole row is over the limit
+void RankedTrie::fuzzyWalk(uint32_t node, string_view word, const vector<int>& row, int maxEdits,
+                           vector<pair<uint32_t, int>>& hits) const {
+    const Node& current = nodes[node];
+    if (row.back() <= maxEdits) {
+        for (uint32_t t = current.terminalBegin; t < current.terminalBegin + current.terminalCount; t++) {
+            hits.emplace_back(terminals[t], row.back());
+        }
+    }
+    vector<int> next(row.size());
+    for (uint32_t c = current.firstChild; c < current.firstChild + current.childCount; c++) {
+        next[0] = row[0] + 1;
+        int best = next[0];
+        for (size_t i = 1; i < row.size(); i++) {
+            int substitute = row[i - 1] + (word[i - 1] == nodes[c].label ? 0 : 1);
+            next[i] = min({ next[i - 1] + 1, row[i] + 1, substitute });
+            best = min(best, next[i]);
+        }
+        if (best <= maxEdits) {
+            fuzzyWalk(c, word, next, maxEdits, hits);
+        }
+    }
+}
+
+void RankedTrie::fuzzy(string_view word, int maxEdits, vector<pair<uint32_t, int>>& hits) const {
+    if (nodes.empty()) {
+        return;
+    }
+    string lowered(word);
+    transform(lowered.begin(), lowered.end(), lowered.begin(), [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+    vector<int> row(lowered.size() + 1);
+    for (size_t i = 0; i < row.size(); i++) {
+        row[i] = static_cast<int>(i);
+    }
+    fuzzyWalk(0, lowered, row, maxEdits, hits);
+}
+
+size_t RankedTrie::memoryUsage() const {
+    return nodes.capacity() * sizeof(Node) + (terminals.capacity() + tops.capacity()) * sizeof(uint32_t);
+}
+
+AirportSearch::AirportSearch(const TableView& table, const AggregateCube& cube, size_t topN) : topN(topN) {
+    vector<pair<string, uint32_t>> codeKeys;
+    vector<pair<string, uint32_t>> nameKeys;
+    traffic.resize(table.airports);
+    nameWords.resize(table.airports);
+    for (uint32_t a = 0; a < table.airports; a++) {
+        traffic[a] = cube.cell(static_cast<int>(a), AggregateCube::ALL_YEARS, AggregateCube::WHOLE_YEAR).totals[TOTAL_FLIGHTS];
+        string code = table.airportCode(a);
+        transform(code.begin(), code.end(), code.begin(), [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+        codeKeys.emplace_back(code, a);
+        nameWords[a] = searchWords(table.airportName(a));
+        for (const string& word : nameWords[a]) {
+            nameKeys.emplace_back(word, a);
+        }
+    }
+    codes.build(move(codeKeys), traffic, topN);
+    names.build(move(nameKeys), traffic, topN);
+}
+
+vector<SearchHit> AirportSearch::byCodePrefix(string_view prefix, size_t limit) const {
+    vector<SearchHit> hits;
+    for (uint32_t airport : codes.complete(prefix)) {
+        if (hits.size() == limit) {
+            break;
+        }
+        hits.push_back(hit(airport, 0));
+    }
+    return hits;
+}
+
+vector<SearchHit> AirportSearch::byCodeFuzzy(string_view code, int maxEdits, size_t limit) const {
+    vector<pair<uint32_t, int>> matches;
+    codes.fuzzy(code, maxEdits, matches);
+    vector<SearchHit> hits;
+    for (const auto& match : matches) {
+        hits.push_back(hit(match.first, match.second));
+    }
+    sort(hits.begin(), hits.end(), [](const SearchHit& a, const SearchHit& b) {
+        return a.distance != b.distance ? a.distance < b.distance
+                                        : a.flights != b.flights ? a.flights > b.flights : a.airport < b.airport;
+    });
+    hits.resize(min(hits.size(), limit));
+    return hits;
+}
+
+vector<SearchHit> AirportSearch::byName(string_view text, size_t limit) const {
+    vector<string> words = searchWords(text);
+    vector<SearchHit> hits;
+    if (words.empty()) {
+        return hits;
+    }
+    // One word is a precomputed list; with more, the top list of one word can miss airports
+    // that match them all, so every airport under the rarest word is filtered and ranked
+    vector<uint32_t> candidates;
+    size_t key = 0;
+    if (words.size() == 1) {
+        candidates = names.complete(words[0]);
+    }
+    else {
+        for (size_t w = 0; w < words.size(); w++) {
+            vector<uint32_t> matches = names.matching(words[w]);
+            if (w == 0 || matches.size() < candidates.size()) {
+                candidates = move(matches);
+                key = w;
+            }
+        }
+    }
+    for (uint32_t airport : candidates) {
+        bool all = true;
+        for (size_t w = 0; w < words.size() && all; w++) {
+            all = w == key || any_of(nameWords[airport].begin(), nameWords[airport].end(),
+                                     [&](const string& word) { return word.compare(0, words[w].size(), words[w]) == 0; });
+        }
+        if (all) {
+            hits.push_back(hit(airport, 0));
+        }
+    }
+    if (words.size() > 1) {
+        sort(hits.begin(), hits.end(), [](const SearchHit& a, const SearchHit& b) {
+            return a.flights > b.flights || (a.flights == b.flights && a.airport < b.airport);
+        });
+    }
+    hits.resize(min(hits.size(), limit));
+    return hits;
+}
+
+vector<SearchHit> AirportSearch::suggest(string_view text, size_t limit) const {
+    vector<SearchHit> hits;
+    auto add = [&](const vector<SearchHit>& more) {
+        for (const SearchHit& candidate : more) {
+            bool seen = any_of(hits.begin(), hits.end(), [&](const SearchHit& h) { return h.airport == candidate.airport; });
+            if (!seen && hits.size() < limit) {
+                hits.push_back(candidate);
+            }
+        }
+    };
+    if (text.size() <= 4 && text.find(' ') == string_view::npos) {
+        add(byCodePrefix(text, limit));
+    }
+    add(byName(text, limit));
+    if (text.size() >= 2 && text.size() <= 4) {
+        add(byCodeFuzzy(text, 1, limit));
+    }
+    return hits;
+}
+
+size_t AirportSearch::memoryUsage() const {
+    size_t bytes = codes.memoryUsage() + names.memoryUsage() + traffic.capacity() * sizeof(long long);
+    for (const auto& words : nameWords) {
+        for (const string& word : words) {
+            bytes += sizeof(string) + word.capacity();
+        }
+    }
+    return bytes;
+}
+
+bool verifyNameSearch(const TableView& table, const AggregateCube& cube, string& report) {
+    const size_t limit = 10;
+    AirportSearch search(table, cube, limit);
+    vector<long long> traffic(table.airports);
+    vector<vector<string>> words(table.airports);
+    map<string, size_t> airportsPerWord;
+    for (uint32_t a = 0; a < table.airports; a++) {
+        traffic[a] = cube.cell(static_cast<int>(a), AggregateCube::ALL_YEARS, AggregateCube::WHOLE_YEAR).totals[TOTAL_FLIGHTS];
+        words[a] = searchWords(table.airportName(a));
+        set<string> distinct(words[a].begin(), words[a].end());
+        for (const string& word : distinct) {
+            airportsPerWord[word]++;
+        }
+    }
+    string common;
+    size_t most = 0;
+    for (const auto& entry : airportsPerWord) {
+        if (entry.second > most) {
+            common = entry.first;
+            most = entry.second;
+        }
+    }
+    // The scan: every airport with a name word starting with each query word, by traffic
+    auto scan = [&](const vector<string>& query) {
+        vector<uint32_t> found;
+        for (uint32_t a = 0; a < table.airports; a++) {
+            bool all = true;
+            for (size_t w = 0; w < query.size() && all; w++) {
+                all = any_of(words[a].begin(), words[a].end(),
+                             [&](const string& word) { return word.compare(0, query[w].size(), query[w]) == 0; });
+            }
+            if (all) {
+                found.push_back(a);
+            }
+        }
+        sort(found.begin(), found.end(), [&](uint32_t a, uint32_t b) {
+            return traffic[a] > traffic[b] || (traffic[a] == traffic[b] && a < b);
+        });
+        found.resize(min(found.size(), limit));
+        return found;
+    };
+    set<string> queries;
+    for (uint32_t a = 0; a < table.airports; a++) {
+        for (const string& word : words[a]) {
+            queries.insert(common + " " + word);
+            queries.insert(word.substr(0, 4) + " " + common.substr(0, 6));
+        }
+    }
+    size_t mismatches = 0;
+    for (const string& text : queries) {
+        vector<uint32_t> expected = scan(searchWords(text));
+        vector<SearchHit> hits = search.byName(text, limit);
+        bool same = hits.size() == expected.size();
+        for (size_t h = 0; h < hits.size() && same; h++) {
+            same = hits[h].airport == expected[h];
+        }
+        if (!same) {
+            if (mismatches < 10) {
+                report += "\"" + text + "\": " + to_string(hits.size()) + " matches, a full scan finds " +
+                          to_string(expected.size()) + "\n";
+            }
+            mismatches++;
+        }
+    }
+    report += "Name search: " + to_string(queries.size()) + " queries pairing \"" + common + "\" with every name word, " +
+              (mismatches == 0 ? string("all match a full scan") : to_string(mismatches) + " DIFFER from a full scan") + "\n";
+    return mismatches == 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "AggregateCube.h"
+#include "ColumnStore.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// One search result; distance is the edit distance for fuzzy matches, 0 otherwise
+struct SearchHit {
+    uint32_t airport;
+    int distance;
+    long long flights; // All-time total flights, the ranking key
+};
+
+// Trie over lowercase keys (A-Z folded, 0-9) whose nodes carry the best-ranked airports of
+// their subtree, so a prefix query is one walk plus a copy of a precomputed list
+// Children are stored as sorted runs in one node array rather than fixed fan-out tables,
+// which keeps long name keys compact
+class RankedTrie {
+public:
+    // keys: (key, airport) pairs, a key may map to several airports and an airport to several keys
+    void build(std::vector<std::pair<std::string, uint32_t>> keys, const std::vector<long long>& traffic, size_t topN);
+
+    // Best airports (at most topN, highest traffic first) with a key starting with prefix
+    std::vector<uint32_t> complete(std::string_view prefix) const;
+    // Every airport with a key starting with prefix, in id order
+    std::vector<uint32_t> matching(std::string_view prefix) const;
+    // Airports with a key within maxEdits edits (Levenshtein) of word, with the distance
+    void fuzzy(std::string_view word, int maxEdits, std::vector<std::pair<uint32_t, int>>& hits) const;
+    size_t memoryUsage() const;
+
+private:
+    struct Node {
+        char label;
+        uint32_t firstChild;
+        uint32_t childCount;
+        uint32_t terminalBegin; // Airports whose key ends here, in `terminals`
+        uint32_t terminalCount;
+        uint32_t topBegin;      // Best airports of the subtree, in `tops`
+        uint32_t topCount;
+    };
+    void buildNode(uint32_t index, size_t lo, size_t hi, size_t depth);
+    int32_t child(uint32_t node, char c) const;
+    // Node reached by the lowercased prefix, -1 when no key starts with it
+    int32_t find(std::string_view prefix) const;
+    void fuzzyWalk(uint32_t node, std::string_view word, const std::vector<int>& row, int maxEdits,
+                   std::vector<std::pair<uint32_t, int>>& hits) const;
+
+    std::vector<std::pair<std::string, uint32_t>> sorted; // Only during build
+    const std::vector<long long>* rank = nullptr;         // Only during build
+    size_t topN = 0;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> terminals;
+    std::vector<uint32_t> tops;
+};
+
+// Autocomplete over airport codes and the words of airport names, ranked by traffic
+// Built once from a loaded table; rebuild it after rows are appended
+class AirportSearch {
+public:
+    AirportSearch() = default;
+    AirportSearch(const TableView& table, const AggregateCube& cube, size_t topN = 10);
+
+    // Codes starting with prefix ("M" -> MIA, MCO, MDW...)
+    std::vector<SearchHit> byCodePrefix(std::string_view prefix, size_t limit) const;
+    // Codes within maxEdits typos of code, closest first
+    std::vector<SearchHit> byCodeFuzzy(std::string_view code, int maxEdits, size_t limit) const;
+    // Names with a word starting with every word of text ("Logan", "hartsfield jack")
+    std::vector<SearchHit> byName(std::string_view text, size_t limit) const;
+    // What a search box shows: code prefix matches, then name matches, then near-miss codes
+    std::vector<SearchHit> suggest(std::string_view text, size_t limit) const;
+    size_t memoryUsage() const;
+
+private:
+    SearchHit hit(uint32_t airport, int distance) const { return SearchHit{ airport, distance, traffic[airport] }; }
+
+    std::vector<long long> traffic;
+    std::vector<std::vector<std::string>> nameWords; // Per airport, for multi-word filtering
+    RankedTrie codes;
+    RankedTrie names;
+    size_t topN = 0;
+};
+
+// Lowercase words of text: letters and digits, apostrophes dropped ("O'Hare" -> "ohare")
+std::vector<std::string> searchWords(std::string_view text);
+
+// Self-check: byName against a scan of every airport name, for the most common name word
+// paired with each word (and word prefix) of every name. Mismatches are listed in `report`
+bool verifyNameSearch(const TableView& table, const AggregateCube& cube, std::string& report);
@@ -0,0 +1,69 @@
+#include "Arena.h"
+
+#include <cstdint>
+#include <new>
+
+using namespace std;
+
+Arena::Arena(size_t blockSize) : blockSize(blockSize) {}
+
+Arena::~Arena() {
+    release();
+}
+
+void Arena::release() {
+    while (head != nullptr) {
+        Block* next = head->next;
+        ::operator delete(head);
+        head = next;
+    }
+    cursor = nullptr;
+    end = nullptr;
+    used = 0;
+    returned = 0;
+    reserved = 0;
+    blocks = 0;
+}
+
+Arena::Block* Arena::newBlock(size_t size) {
+    Block* block = static_cast<Block*>(::operator new(HEADER + size));
+    block->size = size;
+    reserved += HEADER + size;
+    blocks++;
+    return block;
+}
+
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    uintptr_t address = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(alignment - 1);
+    if (cursor != nullptr && address + bytes <= reinterpret_cast<uintptr_t>(end)) {
+        used += address + bytes - reinterpret_cast<uintptr_t>(cursor);
+        cursor = reinterpret_cast<char*>(address + bytes);
+        return reinterpret_cast<void*>(address);
+    }
+    if (bytes + alignment > blockSize / 4) {
+        // Big arrays get a block of their own behind the current one, so its free space is kept
+        Block* block = newBlock(bytes + alignment);
+        char* start = reinterpret_cast<char*>(block) + HEADER;
+        if (head == nullptr) {
+            block->next = nullptr;
+            head = block;
+        }
+        else {
+            block->next = head->next;
+            head->next = block;
+        }
+        address = (reinterpret_cast<uintptr_t>(start) + alignment - 1) & ~(alignment - 1);
+        used += address + bytes - reinterpret_cast<uintptr_t>(start);
+        return reinterpret_cast<void*>(address);
+    }
+    Block* block = newBlock(blockSize);
+    block->next = head;
+    head = block;
+    cursor = reinterpret_cast<char*>(block) + HEADER;
+    end = cursor + blockSize;
+    return do_allocate(bytes, alignment);
+}
+
+void Arena::do_deallocate(void*, size_t bytes, size_t) {
+    returned += bytes;
+}
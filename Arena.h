@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+// Monotonic arena: allocations bump a pointer through large blocks taken from the heap, and
+// nothing is given back until release(), which frees every block at once
+// Plugs into the std::pmr containers as their memory resource; deallocate only counts the
+// bytes returned (e.g. an outgrown vector array), the space is reused after release()
+// Not thread-safe: one arena is filled by one thread at a time
+class Arena : public std::pmr::memory_resource {
+public:
+    explicit Arena(size_t blockSize = 64 * 1024);
+    ~Arena() override;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Frees every block; whatever was built in the arena must not be used (or destroyed) afterwards
+    void release();
+
+    size_t bytesUsed() const { return used; }          // Handed out, alignment padding included
+    size_t bytesLive() const { return used - returned; } // Used minus what containers gave back
+    size_t bytesReserved() const { return reserved; }  // Taken from the heap, block headers included
+    size_t blockCount() const { return blocks; }
+
+private:
+    struct Block {
+        Block* next;
+        size_t size; // Bytes after the header
+    };
+    // The header keeps the payload aligned to max_align_t
+    static constexpr size_t HEADER =
+        (sizeof(Block) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    Block* newBlock(size_t size);
+
+    size_t blockSize;
+    Block* head = nullptr; // Current block first
+    char* cursor = nullptr;
+    char* end = nullptr;
+    size_t used = 0;
+    size_t returned = 0;
+    size_t reserved = 0;
+    size_t blocks = 0;
+};
@@ -0,0 +1,181 @@
+#include "BatchQuery.h"
+#include "CsvLoader.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+
+// One parsed query line; airport stays -1 and `error` is set when it cannot be answered
+struct BatchQuery {
+    string_view code;
+    string_view monthText;
+    string_view yearText;
+    int airport = -1;
+    int month = 0;
+    int year = AggregateCube::ALL_YEARS;
+    const char* error = nullptr;
+};
+
+static string_view trim(string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+static bool equalsIgnoreCase(string_view a, string_view b) {
+    return a.size() == b.size() &&
+           equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return toupper(x) == toupper(y); });
+}
+
+static BatchQuery parseQuery(const Dataset& dataset, const CsvRow& row) {
+    BatchQuery query;
+    query.code = trim(row[0]);
+    query.monthText = trim(row[1]);
+    query.yearText = trim(row[2]);
+
+    char code[4] = {};
+    if (query.code.empty() || query.code.size() > sizeof(code)) {
+        query.error = "unknown airport";
+        return query;
+    }
+    transform(query.code.begin(), query.code.end(), code, [](char c) { return static_cast<char>(toupper(c)); });
+    int airport = dataset.table.findAirport(string_view(code, query.code.size()));
+    if (airport < 0) {
+        query.error = "unknown airport";
+        return query;
+    }
+
+    if (equalsIgnoreCase(query.monthText, "all")) {
+        query.month = AggregateCube::WHOLE_YEAR;
+    }
+    else {
+        query.month = parseInt(query.monthText);
+        if (query.month < 1 || query.month > 12) {
+            query.month = monthNumber(query.monthText);
+        }
+        if (query.month == 0) {
+            query.error = "unknown month";
+            return query;
+        }
+    }
+
+    if (!query.yearText.empty() && !equalsIgnoreCase(query.yearText, "all")) {
+        query.year = parseInt(query.yearText);
+        if (!dataset.cube.hasYear(query.year)) {
+            query.error = "unknown year";
+            return query;
+        }
+    }
+    query.airport = airport;
+    return query;
+}
+
+static const string_view CSV_HEADER = "code,month,year,rows,total_flights,delayed_flights,canceled_flights,delay_rate,"
+                                      "carrier_delays,late_delays,navis_delays,security_delays,weather_delays,status";
+// Result columns between year and status, left empty on an error row
+static const size_t CSV_RESULT_COLUMNS = count(CSV_HEADER.begin(), CSV_HEADER.end(), ',') + 1 - 4;
+
+static void writeCsvHeader(BufferedWriter& out) {
+    out.write(CSV_HEADER).write('\n');
+}
+
+// Query text is echoed back as given (after trimming), numbers come from the cube cell
+static void writeResult(BufferedWriter& out, BatchFormat format, const BatchQuery& query, const CubeCell& cell) {
+    static const char* const CAUSE_KEYS[] = { "carrier_delays", "late_delays", "navis_delays", "security_delays",
+                                              "weather_delays" };
+    const char* status = query.error == nullptr ? "ok" : query.error;
+    string_view month = query.error == nullptr && query.month != AggregateCube::WHOLE_YEAR ? monthName(query.month)
+                                                                                          : query.monthText;
+    if (format == BATCH_CSV) {
+        out.write(query.code).write(',').write(month).write(',');
+        out.write(query.yearText.empty() ? string_view("all") : query.yearText).write(',');
+        if (query.error == nullptr) {
+            out.write(cell.rows).write(',').write(cell.totals[TOTAL_FLIGHTS]).write(',');
+            out.write(cell.totals[DELAYED_FLIGHTS]).write(',').write(cell.totals[CANCELED_FLIGHTS]).write(',');
+            out.write(delayRate(cell.totals), 4);
+            for (int c = CARRIER_DELAYS; c <= WEATHER_DELAYS; c++) {
+                out.write(',').write(cell.totals[c]);
+            }
+        }
+        else {
+            for (size_t c = 1; c < CSV_RESULT_COLUMNS; c++) {
+                out.write(',');
+            }
+        }
+        out.write(',').write(status).write('\n');
+        return;
+    }
+
+    out.write("{\"code\":\"").writeJsonEscaped(query.code);
+    out.write("\",\"month\":\"").writeJsonEscaped(month);
+    out.write("\",\"year\":\"").writeJsonEscaped(query.yearText.empty() ? string_view("all") : query.yearText);
+    out.write("\",\"status\":\"").write(status).write('"');
+    if (query.error == nullptr) {
+        out.write(",\"rows\":").write(cell.rows);
+        out.write(",\"total_flights\":").write(cell.totals[TOTAL_FLIGHTS]);
+        out.write(",\"delayed_flights\":").write(cell.totals[DELAYED_FLIGHTS]);
+        out.write(",\"canceled_flights\":").write(cell.totals[CANCELED_FLIGHTS]);
+        out.write(",\"delay_rate\":").write(delayRate(cell.totals), 4);
+        for (int c = CARRIER_DELAYS; c <= WEATHER_DELAYS; c++) {
+            out.write(",\"").write(CAUSE_KEYS[c]).write("\":").write(cell.totals[c]);
+        }
+    }
+    out.write("}\n");
+}
+
+BatchStats runBatchQueries(const Dataset& dataset, string_view queries, BatchFormat format, BufferedWriter& out) {
+    vector<BatchQuery> parsed;
+    {
+        METRICS_TIMER(timer, STAGE_PARSE);
+        parsed.reserve(countLines(queries));
+        forEachCsvRow(queries, [&](const CsvRow& row) { parsed.push_back(parseQuery(dataset, row)); }, false);
+        METRICS_ITEMS(timer, parsed.size());
+    }
+
+    BatchStats stats;
+    stats.queries = parsed.size();
+    static const CubeCell EMPTY_CELL;
+    METRICS_TIMER(timer, STAGE_FORMAT);
+    METRICS_ITEMS(timer, parsed.size());
+    if (format == BATCH_CSV) {
+        writeCsvHeader(out);
+    }
+    for (const BatchQuery& query : parsed) {
+        if (query.error == nullptr) {
+            writeResult(out, format, query, dataset.cube.cell(query.airport, query.year, query.month));
+            stats.answered++;
+        } else {
+            writeResult(out, format, query, EMPTY_CELL);
+        }
+    }
+    out.flush();
+    return stats;
+}
+
+bool runBatchFile(const Dataset& dataset, const string& input, BatchFormat format, BufferedWriter& out,
+                  BatchStats& stats, string& error) {
+    if (input == "-") {
+        string queries;
+        char block[1 << 16];
+        size_t read;
+        while ((read = fread(block, 1, sizeof(block), stdin)) > 0) {
+            queries.append(block, read);
+        }
+        stats = runBatchQueries(dataset, queries, format, out);
+        return true;
+    }
+    MappedFile file(input);
+    if (!file.isOpen()) {
+        error = "Cannot open " + input;
+        return false;
+    }
+    stats = runBatchQueries(dataset, file.contents(), format, out);
+    return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "BufferedWriter.h"
+#include "Dataset.h"
+
+#include <string>
+#include <string_view>
+
+// Output layout of a batch run, one result line per query line in input order
+enum BatchFormat {
+    BATCH_CSV,
+    BATCH_JSONL
+};
+
+struct BatchStats {
+    size_t queries = 0;
+    size_t answered = 0; // The rest had an unknown airport, month or year
+};
+
+// Answers every "CODE,Month[,Year]" line of `queries` from the dataset's cube
+// Month is a name or 1-12, and may be "all" for the whole year; without a year
+// every year is summed. Queries are grouped by airport before they are answered
+BatchStats runBatchQueries(const Dataset& dataset, std::string_view queries, BatchFormat format, BufferedWriter& out);
+
+// Same, reading the queries from a file, or from stdin when `input` is "-"
+// Returns false (with a message) when the input cannot be read
+bool runBatchFile(const Dataset& dataset, const std::string& input, BatchFormat format, BufferedWriter& out,
+                  BatchStats& stats, std::string& error);
@@ -0,0 +1,65 @@
+#include "BenchHarness.h"
+
+#include <cmath>
+#include <numeric>
+#include <random>
+
+using namespace std;
+
+double clockOverheadNs() {
+    // Smallest of many back-to-back reads, the part every sample pays at least
+    double best = 1e300;
+    for (int i = 0; i < 1000; i++) {
+        auto start = chrono::steady_clock::now();
+        auto end = chrono::steady_clock::now();
+        best = min(best, chrono::duration<double, nano>(end - start).count());
+    }
+    return best;
+}
+
+double percentile(vector<double>& samples, double p) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    size_t rank = min(samples.size() - 1, static_cast<size_t>(p * (samples.size() - 1) + 0.5));
+    nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+vector<uint32_t> uniformKeys(size_t keyCount, size_t operations, uint64_t seed) {
+    vector<uint32_t> keys(operations, 0);
+    if (keyCount == 0) {
+        return keys;
+    }
+    mt19937_64 rng(seed);
+    uniform_int_distribution<uint32_t> pick(0, static_cast<uint32_t>(keyCount - 1));
+    for (auto& key : keys) {
+        key = pick(rng);
+    }
+    return keys;
+}
+
+vector<uint32_t> zipfKeys(size_t keyCount, size_t operations, double exponent, uint64_t seed) {
+    vector<uint32_t> keys(operations, 0);
+    if (keyCount == 0) {
+        return keys;
+    }
+    mt19937_64 rng(seed);
+    vector<uint32_t> byRank(keyCount);
+    iota(byRank.begin(), byRank.end(), 0);
+    shuffle(byRank.begin(), byRank.end(), rng);
+
+    // Inverse CDF sampling over the rank weights 1/r^s
+    vector<double> cdf(keyCount);
+    double total = 0.0;
+    for (size_t r = 0; r < keyCount; r++) {
+        total += 1.0 / pow(static_cast<double>(r + 1), exponent);
+        cdf[r] = total;
+    }
+    uniform_real_distribution<double> pick(0.0, total);
+    for (auto& key : keys) {
+        size_t rank = lower_bound(cdf.begin(), cdf.end(), pick(rng)) - cdf.begin();
+        key = byRank[min(rank, keyCount - 1)];
+    }
+    return keys;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Keeps a computed value alive so the optimizer cannot drop the work that produced it
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#ifdef _MSC_VER
+    const volatile char* volatile sink = reinterpret_cast<const volatile char*>(&value);
+    (void)sink;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+struct BenchConfig {
+    size_t warmup = 2;          // Untimed passes over the keys first
+    size_t repetitions = 20;    // Timed passes, every operation of each is one latency sample
+    size_t operations = 10000;  // Operations per pass
+    double zipfExponent = 1.0;
+    uint64_t seed = 42;
+};
+
+// Per-operation latency in nanoseconds (clock overhead subtracted) and the throughput
+// of passes timed as a whole, without a clock read per operation
+struct LatencyStats {
+    size_t samples = 0;
+    double meanNs = 0.0; // Whole-pass time / operations
+    double p50Ns = 0.0;
+    double p90Ns = 0.0;
+    double p99Ns = 0.0;
+    double maxNs = 0.0;
+};
+
+// Cost of one steady_clock read pair, subtracted from every sample
+double clockOverheadNs();
+
+// Sorted-sample percentile, p in [0, 1]
+double percentile(std::vector<double>& samples, double p);
+
+// Key indices in [0, keyCount): every key equally likely, or Zipf distributed with the
+// given exponent (rank 1 most frequent; ranks go to keys in a seeded shuffled order)
+std::vector<uint32_t> uniformKeys(size_t keyCount, size_t operations, uint64_t seed);
+std::vector<uint32_t> zipfKeys(size_t keyCount, size_t operations, double exponent, uint64_t seed);
+
+// Runs op(i) for i in [0, config.operations): warm-up passes, then repetitions that
+// time every call on its own and repetitions timed as a whole for the mean
+template <typename Op>
+LatencyStats measureLatency(const BenchConfig& config, Op&& op) {
+    using Clock = std::chrono::steady_clock;
+    for (size_t w = 0; w < config.warmup; w++) {
+        for (size_t i = 0; i < config.operations; i++) {
+            op(i);
+        }
+    }
+    double overhead = clockOverheadNs();
+    std::vector<double> samples;
+    samples.reserve(config.repetitions * config.operations);
+    double totalNs = 0.0;
+    for (size_t r = 0; r < config.repetitions; r++) {
+        for (size_t i = 0; i < config.operations; i++) {
+            auto start = Clock::now();
+            op(i);
+            auto end = Clock::now();
+            samples.push_back(std::max(0.0, std::chrono::duration<double, std::nano>(end - start).count() - overhead));
+        }
+        auto start = Clock::now();
+        for (size_t i = 0; i < config.operations; i++) {
+            op(i);
+        }
+        totalNs += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    LatencyStats stats;
+    stats.samples = samples.size();
+    if (samples.empty()) {
+        return stats;
+    }
+    stats.meanNs = totalNs / (config.repetitions * config.operations);
+    stats.p50Ns = percentile(samples, 0.50);
+    stats.p90Ns = percentile(samples, 0.90);
+    stats.p99Ns = percentile(samples, 0.99);
+    stats.maxNs = percentile(samples, 1.0);
+    return stats;
+}
@@ -0,0 +1,422 @@
+#include "Benchmark.h"
+#include "BufferedWriter.h"
+#include "ColumnStore.h"
+#include "AggregateCube.h"
+#include "CompactTrie.h"
+#include "FlatIndex.h"
+#include "Generator.h"
+#include "Kernels.h"
+#include "MemoryTracker.h"
+#include "ParallelLoader.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// Copies the loaded rows over and over until the table has `rows` rows
+static AirportTable tileTable(const AirportTable& source, size_t rows) {
+    AirportTable table = source;
+    if (source.rowCount() == 0) {
+        return table;
+    }
+    table.reserve(rows);
+    int32_t values[COUNTER_COUNT];
+    for (size_t i = table.rowCount(); i < rows; i++) {
+        size_t from = i % source.rowCount();
+        source.rowValues(from, values);
+        table.appendRow(source.airport[from], source.period[from], values);
+    }
+    return table;
+}
+
+// Runs fn `repetitions` times and returns the best time in seconds
+template <typename Fn>
+static double bestOf(int repetitions, Fn&& fn) {
+    double best = 1e300;
+    for (int r = 0; r < repetitions; r++) {
+        auto start_time = chrono::steady_clock::now();
+        fn();
+        auto end_time = chrono::steady_clock::now();
+        best = min(best, chrono::duration<double>(end_time - start_time).count());
+    }
+    return best;
+}
+
+static void printThroughput(const string& name, double seconds, size_t rows, size_t bytes) {
+    cout << setw(36) << left << name << right << fixed << setprecision(3) << setw(10) << seconds * 1000.0 << " ms"
+         << setw(10) << setprecision(2) << rows / seconds / 1e6 << " Mrows/s" << setw(10) << bytes / seconds / 1e9
+         << " GB/s" << endl;
+}
+
+void runKernelBenchmark(const string& filename, size_t rows) {
+    AirportTable table = tileTable(buildAirportTable(filename), rows);
+    TableView view = table.view();
+    if (view.rows == 0) {
+        cout << "No data loaded from " << filename << endl;
+        return;
+    }
+    const int repetitions = 10;
+    cout << "Kernel benchmark: " << view.rows << " rows, " << view.airports << " airports, dispatch = " << kernelName()
+         << endl;
+
+    // Bytes each kernel has to read: the period column plus the counters (plus airport ids when filtering or grouping by airport)
+    size_t allCounters = view.rows * (sizeof(uint16_t) + COUNTER_COUNT * sizeof(int32_t));
+
+    RowFilter everything;
+    RowFilter june;
+    june.monthMask = 1 << 6;
+    RowFilter airportYears;
+    airportYears.airport = 0;
+    airportYears.firstYear = 2005;
+    airportYears.lastYear = 2010;
+
+    long long sink = 0;
+    printThroughput("sum all causes, scalar", bestOf(repetitions, [&] { sink += sumCountersScalar(view, everything).rows; }),
+                    view.rows, allCounters);
+    printThroughput("sum all causes, avx2", bestOf(repetitions, [&] { sink += sumCountersAvx2(view, everything).rows; }),
+                    view.rows, allCounters);
+    printThroughput("sum June only, scalar", bestOf(repetitions, [&] { sink += sumCountersScalar(view, june).rows; }),
+                    view.rows, allCounters);
+    printThroughput("sum June only, avx2", bestOf(repetitions, [&] { sink += sumCountersAvx2(view, june).rows; }),
+                    view.rows, allCounters);
+    printThroughput("one airport 2005-2010, scalar", bestOf(repetitions, [&] { sink += sumCountersScalar(view, airportYears).rows; }),
+                    view.rows, allCounters + view.rows * sizeof(uint32_t));
+    printThroughput("one airport 2005-2010, avx2", bestOf(repetitions, [&] { sink += sumCountersAvx2(view, airportYears).rows; }),
+                    view.rows, allCounters + view.rows * sizeof(uint32_t));
+    double rateSink = 0.0;
+    printThroughput("every airport, scalar", bestOf(repetitions, [&] { rateSink += delayRate(sumCountersByAirportScalar(view, everything)[0].totals); }),
+                    view.rows, allCounters + view.rows * sizeof(uint32_t));
+    printThroughput("every airport, avx2", bestOf(repetitions, [&] { rateSink += delayRate(sumCountersByAirportAvx2(view, everything)[0].totals); }),
+                    view.rows, allCounters + view.rows * sizeof(uint32_t));
+
+    // Both kernels must agree, and printing the sums keeps the loops from being optimized away
+    bool same = true;
+    auto agree = [&](const RowTotals& scalar, const RowTotals& simd) {
+        same = same && scalar.rows == simd.rows;
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            same = same && scalar.totals[c] == simd.totals[c];
+        }
+    };
+    for (const RowFilter& filter : { everything, june, airportYears }) {
+        agree(sumCountersScalar(view, filter), sumCountersAvx2(view, filter));
+        vector<RowTotals> scalar = sumCountersByAirportScalar(view, filter);
+        vector<RowTotals> simd = sumCountersByAirportAvx2(view, filter);
+        for (size_t a = 0; a < scalar.size(); a++) {
+            agree(scalar[a], simd[a]);
+        }
+    }
+    cout << "Kernels agree: " << (same ? "yes" : "NO") << " (checksum " << sink << ", " << rateSink << ")" << endl;
+}
+
+// What building one structure cost
+struct BuildCost {
+    string structure;
+    long long buildMicroseconds = 0;
+    long long retainedBytes = 0; // Heap still held once the build returned
+    size_t allocatedBytes = 0;   // Including temporaries freed during the build
+    size_t allocations = 0;
+};
+
+struct LookupResult {
+    string structure;
+    string workload;
+    LatencyStats latency;
+};
+
+template <typename Build>
+static BuildCost measureBuild(const string& structure, Build&& build) {
+    BuildCost cost;
+    cost.structure = structure;
+    AllocationScope scope;
+    auto start_time = chrono::steady_clock::now();
+    build();
+    auto end_time = chrono::steady_clock::now();
+    cost.buildMicroseconds = chrono::duration_cast<chrono::microseconds>(end_time - start_time).count();
+    cost.retainedBytes = scope.live();
+    cost.allocatedBytes = scope.allocated();
+    cost.allocations = scope.allocations();
+    return cost;
+}
+
+static void writeJson(BufferedWriter& out, const string& filename, size_t rows, size_t airports,
+                      const BenchConfig& config, const vector<BuildCost>& builds, const vector<LookupResult>& lookups) {
+    out.write("{\"dataset\":\"").writeJsonEscaped(filename).write("\",\"rows\":").write(static_cast<long long>(rows));
+    out.write(",\"airports\":").write(static_cast<long long>(airports));
+    out.write(",\"config\":{\"warmup\":").write(static_cast<long long>(config.warmup));
+    out.write(",\"repetitions\":").write(static_cast<long long>(config.repetitions));
+    out.write(",\"operations\":").write(static_cast<long long>(config.operations));
+    out.write(",\"zipf_exponent\":").write(config.zipfExponent, 2);
+    out.write(",\"seed\":").write(static_cast<long long>(config.seed)).write('}');
+    out.write(",\"peak_rss_bytes\":").write(static_cast<long long>(peakRssBytes()));
+    out.write(",\"peak_heap_bytes\":").write(static_cast<long long>(allocationStats().peakLiveBytes));
+    out.write(",\"builds\":[");
+    for (size_t i = 0; i < builds.size(); i++) {
+        const BuildCost& build = builds[i];
+        out.write(i == 0 ? "{" : ",{").write("\"structure\":\"").write(build.structure);
+        out.write("\",\"build_us\":").write(build.buildMicroseconds);
+        out.write(",\"retained_bytes\":").write(build.retainedBytes);
+        out.write(",\"allocated_bytes\":").write(static_cast<long long>(build.allocatedBytes));
+        out.write(",\"allocations\":").write(static_cast<long long>(build.allocations)).write('}');
+    }
+    out.write("],\"lookups\":[");
+    for (size_t i = 0; i < lookups.size(); i++) {
+        const LookupResult& lookup = lookups[i];
+        out.write(i == 0 ? "{" : ",{").write("\"structure\":\"").write(lookup.structure);
+        out.write("\",\"workload\":\"").write(lookup.workload);
+        out.write("\",\"samples\":").write(static_cast<long long>(lookup.latency.samples));
+        out.write(",\"mean_ns\":").write(lookup.latency.meanNs, 2);
+        out.write(",\"p50_ns\":").write(lookup.latency.p50Ns, 2);
+        out.write(",\"p90_ns\":").write(lookup.latency.p90Ns, 2);
+        out.write(",\"p99_ns\":").write(lookup.latency.p99Ns, 2);
+        out.write(",\"max_ns\":").write(lookup.latency.maxNs, 2).write('}');
+    }
+    out.write("]}\n");
+    out.flush();
+}
+
+void runLookupBenchmark(const string& filename, unsigned threads, const BenchConfig& config, const string& jsonFile) {
+    // Builds, each measured on its own so the retained bytes belong to one structure
+    vector<BuildCost> builds;
+    AirportTable table;
+    unordered_map<string, vector<AirportData>> hashTable;
+    Trie trie;
+    CompactTrie compact;
+    PerfectHashIndex perfect;
+    FlatAirportIndex flat;
+    builds.push_back(measureBuild("columnar", [&] { table = buildAirportTableParallel(filename, threads); }));
+    TableView view = table.view();
+    if (view.rows == 0) {
+        cout << "No data loaded from " << filename << endl;
+        return;
+    }
+    builds.push_back(measureBuild("hash_table", [&] { hashTable = buildHashTableParallel(filename, threads); }));
+    builds.push_back(measureBuild("trie", [&] { trie = buildTrieParallel(filename, threads); }));
+    builds.push_back(measureBuild("compact_trie", [&] {
+        vector<pair<string, vector<AirportData>>> airports;
+        traverseTrie(trie.root(), airports);
+        compact = CompactTrie(airports);
+    }));
+    builds.push_back(measureBuild("perfect_hash", [&] { perfect = PerfectHashIndex(compact); }));
+    builds.push_back(measureBuild("flat_index", [&] { flat = buildFlatIndexParallel(filename, threads); }));
+
+    vector<string> codes;
+    for (size_t a = 0; a < view.airports; a++) {
+        codes.push_back(view.airportCode(static_cast<uint32_t>(a)));
+    }
+    vector<pair<string, vector<uint32_t>>> workloads = {
+        { "uniform", uniformKeys(codes.size(), config.operations, config.seed) },
+        { "zipf", zipfKeys(codes.size(), config.operations, config.zipfExponent, config.seed) },
+    };
+    // Every lookup's result goes through doNotOptimize, so none of the loops can be dropped
+    vector<LookupResult> lookups;
+    auto measureLookups = [&](const char* structure, auto&& lookup) {
+        for (const auto& workload : workloads) {
+            LookupResult result;
+            result.structure = structure;
+            result.workload = workload.first;
+            const vector<uint32_t>& keys = workload.second;
+            result.latency = measureLatency(config, [&](size_t i) { doNotOptimize(lookup(codes[keys[i]])); });
+            lookups.push_back(result);
+        }
+    };
+    measureLookups("columnar", [&](const string& code) { return view.findAirport(code); });
+    measureLookups("hash_table", [&](const string& code) { return hashTable.find(code); });
+    measureLookups("trie", [&](const string& code) { return findTrie(trie.root(), code); });
+    measureLookups("compact_trie", [&](const string& code) { return compact.find(code); });
+    measureLookups("perfect_hash", [&](const string& code) { return perfect.find(code); });
+    measureLookups("flat_index", [&](const string& code) { return flat.find(code); });
+
+    cout << "Lookup benchmark: " << view.rows << " rows, " << view.airports << " airports, " << config.warmup
+         << " warm-up + " << config.repetitions << " x " << config.operations << " lookups per workload" << endl;
+    cout << left << setw(16) << "structure" << right << setw(12) << "build us" << setw(14) << "kept bytes"
+         << setw(16) << "alloc bytes" << setw(12) << "allocs" << endl;
+    for (const BuildCost& build : builds) {
+        cout << left << setw(16) << build.structure << right << setw(12) << build.buildMicroseconds << setw(14)
+             << build.retainedBytes << setw(16) << build.allocatedBytes << setw(12) << build.allocations << endl;
+    }
+    cout << left << setw(16) << "structure" << setw(10) << "keys" << right << setw(10) << "mean ns" << setw(10)
+         << "p50 ns" << setw(10) << "p90 ns" << setw(10) << "p99 ns" << setw(12) << "max ns" << endl;
+    for (const LookupResult& lookup : lookups) {
+        cout << left << setw(16) << lookup.structure << setw(10) << lookup.workload << right << fixed << setprecision(1)
+             << setw(10) << lookup.latency.meanNs << setw(10) << lookup.latency.p50Ns << setw(10) << lookup.latency.p90Ns
+             << setw(10) << lookup.latency.p99Ns << setw(12) << lookup.latency.maxNs << endl;
+    }
+    cout << "Peak RSS: " << peakRssBytes() / 1024.0 / 1024.0 << " MB, peak heap: "
+         << allocationStats().peakLiveBytes / 1024.0 / 1024.0 << " MB" << endl;
+    if (!ALLOCATION_TRACKING) {
+        cout << "Heap columns are 0: build with TRACK_ALLOCATIONS=1 to count allocations" << endl;
+    }
+
+    if (!jsonFile.empty()) {
+        unique_ptr<BufferedWriter> out(jsonFile == "-" ? new BufferedWriter(stdout) : new BufferedWriter(jsonFile));
+        if (!out->isOpen()) {
+            cout << "Cannot open " << jsonFile << " for writing" << endl;
+            return;
+        }
+        writeJson(*out, filename, view.rows, view.airports, config, builds, lookups);
+    }
+}
+
+// Everything measured for one dataset size
+struct ScalingResult {
+    size_t airports = 0;
+    size_t rows = 0;
+    size_t fileBytes = 0;
+    long long generateMicroseconds = 0;
+    vector<pair<unsigned, long long>> loadMicroseconds; // Per thread count
+    vector<BuildCost> builds;
+    vector<LookupResult> lookups;
+};
+
+static void writeScalingJson(BufferedWriter& out, int years, const BenchConfig& config, const vector<ScalingResult>& results) {
+    out.write("{\"years\":").write(static_cast<long long>(years));
+    out.write(",\"repetitions\":").write(static_cast<long long>(config.repetitions));
+    out.write(",\"operations\":").write(static_cast<long long>(config.operations));
+    out.write(",\"peak_rss_bytes\":").write(static_cast<long long>(peakRssBytes()));
+    out.write(",\"sizes\":[");
+    for (size_t r = 0; r < results.size(); r++) {
+        const ScalingResult& result = results[r];
+        out.write(r == 0 ? "{" : ",{").write("\"airports\":").write(static_cast<long long>(result.airports));
+        out.write(",\"rows\":").write(static_cast<long long>(result.rows));
+        out.write(",\"file_bytes\":").write(static_cast<long long>(result.fileBytes));
+        out.write(",\"generate_us\":").write(result.generateMicroseconds);
+        out.write(",\"loads\":[");
+        for (size_t i = 0; i < result.loadMicroseconds.size(); i++) {
+            out.write(i == 0 ? "{" : ",{").write("\"threads\":").write(static_cast<long long>(result.loadMicroseconds[i].first));
+            out.write(",\"load_us\":").write(result.loadMicroseconds[i].second).write('}');
+        }
+        out.write("],\"builds\":[");
+        for (size_t i = 0; i < result.builds.size(); i++) {
+            const BuildCost& build = result.builds[i];
+            out.write(i == 0 ? "{" : ",{").write("\"structure\":\"").write(build.structure);
+            out.write("\",\"build_us\":").write(build.buildMicroseconds);
+            out.write(",\"retained_bytes\":").write(build.retainedBytes).write('}');
+        }
+        out.write("],\"lookups\":[");
+        for (size_t i = 0; i < result.lookups.size(); i++) {
+            const LookupResult& lookup = result.lookups[i];
+            out.write(i == 0 ? "{" : ",{").write("\"query\":\"").write(lookup.structure);
+            out.write("\",\"mean_ns\":").write(lookup.latency.meanNs, 2);
+            out.write(",\"p50_ns\":").write(lookup.latency.p50Ns, 2);
+            out.write(",\"p99_ns\":").write(lookup.latency.p99Ns, 2).write('}');
+        }
+        out.write("]}");
+    }
+    out.write("]}\n");
+    out.flush();
+}
+
+void runScalingBenchmark(const vector<size_t>& airportCounts, int years, const vector<unsigned>& threadCounts,
+                         const BenchConfig& config, const string& jsonFile) {
+    vector<ScalingResult> results;
+    for (size_t airports : airportCounts) {
+        ScalingResult result;
+        result.airports = airports;
+        GeneratorConfig generator;
+        generator.airports = airports;
+        generator.years = years;
+        generator.seed = config.seed;
+        string filename = (filesystem::temp_directory_path() / ("airlines_scale_" + to_string(airports) + ".csv")).string();
+        {
+            auto start_time = chrono::steady_clock::now();
+            BufferedWriter out(filename);
+            if (!out.isOpen()) {
+                cout << "Cannot write " << filename << endl;
+                return;
+            }
+            result.rows = generateDataset(generator, out);
+            result.generateMicroseconds =
+                chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start_time).count();
+        }
+        result.fileBytes = static_cast<size_t>(filesystem::file_size(filename));
+
+        // Load on every thread count, the last table is kept for the queries
+        AirportTable table;
+        for (unsigned threads : threadCounts) {
+            table = AirportTable();
+            BuildCost cost = measureBuild("columnar", [&] { table = buildAirportTableParallel(filename, threads); });
+            result.loadMicroseconds.emplace_back(threads, cost.buildMicroseconds);
+            if (result.builds.empty()) {
+                result.builds.push_back(cost);
+            }
+        }
+        unsigned threads = threadCounts.back();
+        TableView view = table.view();
+        AggregateCube cube;
+        unordered_map<string, vector<AirportData>> hashTable;
+        Trie trie;
+        CompactTrie compact;
+        FlatAirportIndex flat;
+        result.builds.push_back(measureBuild("cube", [&] { cube = AggregateCube(view); }));
+        result.builds.push_back(measureBuild("hash_table", [&] { hashTable = buildHashTableParallel(filename, threads); }));
+        result.builds.push_back(measureBuild("trie", [&] { trie = buildTrieParallel(filename, threads); }));
+        result.builds.push_back(measureBuild("compact_trie", [&] {
+            vector<pair<string, vector<AirportData>>> grouped;
+            traverseTrie(trie.root(), grouped);
+            compact = CompactTrie(grouped);
+        }));
+        result.builds.push_back(measureBuild("flat_index", [&] { flat = buildFlatIndexParallel(filename, threads); }));
+        remove(filename.c_str());
+
+        // Zipf keys: most queries hit the busy airports, like real traffic
+        vector<string> codes;
+        for (size_t a = 0; a < view.airports; a++) {
+            codes.push_back(view.airportCode(static_cast<uint32_t>(a)));
+        }
+        vector<uint32_t> keys = zipfKeys(codes.size(), config.operations, config.zipfExponent, config.seed);
+        vector<uint32_t> periods = uniformKeys(static_cast<size_t>(years) * 12, config.operations, config.seed + 1);
+        auto measureQuery = [&](const char* query, auto&& run) {
+            LookupResult lookup;
+            lookup.structure = query;
+            lookup.workload = "zipf";
+            lookup.latency = measureLatency(config, [&](size_t i) { doNotOptimize(run(i)); });
+            result.lookups.push_back(lookup);
+        };
+        measureQuery("columnar_find", [&](size_t i) { return view.findAirport(codes[keys[i]]); });
+        measureQuery("hash_table_find", [&](size_t i) { return hashTable.find(codes[keys[i]]); });
+        measureQuery("trie_find", [&](size_t i) { return findTrie(trie.root(), codes[keys[i]]); });
+        measureQuery("compact_trie_find", [&](size_t i) { return compact.find(codes[keys[i]]); });
+        measureQuery("flat_index_find", [&](size_t i) { return flat.find(codes[keys[i]]); });
+        measureQuery("cube_cell", [&](size_t i) {
+            return cube.cell(static_cast<int>(keys[i]), generator.firstYear + static_cast<int>(periods[i] / 12),
+                             static_cast<int>(periods[i] % 12) + 1).rows;
+        });
+        results.push_back(result);
+
+        cout << "Scale: " << airports << " airports x " << years << " years = " << result.rows << " rows, "
+             << fixed << setprecision(1) << result.fileBytes / 1024.0 / 1024.0 << " MB CSV (generated in "
+             << result.generateMicroseconds / 1000 << " ms)" << endl;
+        for (const auto& load : result.loadMicroseconds) {
+            double seconds = load.second / 1e6;
+            cout << "  load, " << setw(2) << load.first << " threads: " << setw(10) << setprecision(1) << load.second / 1000.0
+                 << " ms" << setw(10) << setprecision(2) << result.rows / seconds / 1e6 << " Mrows/s" << setw(10)
+                 << result.fileBytes / seconds / 1e6 << " MB/s" << endl;
+        }
+        for (const BuildCost& build : result.builds) {
+            cout << "  " << left << setw(14) << build.structure << right << setw(10) << setprecision(1)
+                 << build.buildMicroseconds / 1000.0 << " ms" << setw(10) << build.retainedBytes / 1024.0 / 1024.0
+                 << " MB" << setw(10) << static_cast<double>(build.retainedBytes) / result.rows << " B/row" << endl;
+        }
+        for (const LookupResult& lookup : result.lookups) {
+            cout << "  " << left << setw(18) << lookup.structure << right << " mean " << setw(8) << lookup.latency.meanNs
+                 << " ns  p50 " << setw(8) << lookup.latency.p50Ns << " ns  p99 " << setw(8) << lookup.latency.p99Ns
+                 << " ns" << endl;
+        }
+    }
+    cout << "Peak RSS: " << peakRssBytes() / 1024.0 / 1024.0 << " MB" << endl;
+
+    if (!jsonFile.empty()) {
+        unique_ptr<BufferedWriter> out(jsonFile == "-" ? new BufferedWriter(stdout) : new BufferedWriter(jsonFile));
+        if (!out->isOpen()) {
+            cout << "Cannot open " << jsonFile << " for writing" << endl;
+            return;
+        }
+        writeScalingJson(*out, years, config, results);
+    }
+}
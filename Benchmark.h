@@ -0,0 +1,22 @@
+#pragma once
+
+#include "BenchHarness.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Aggregation kernel throughput (scalar vs AVX2) over the CSV rows tiled up to `rows` rows
+void runKernelBenchmark(const std::string& filename, size_t rows);
+
+// Builds every lookup structure from the CSV, recording build time and the heap it kept,
+// then measures airport-code lookups on uniform and Zipf key streams
+// Prints a table, and writes the results as JSON to jsonFile ("-" for stdout) when set
+void runLookupBenchmark(const std::string& filename, unsigned threads, const BenchConfig& config,
+                        const std::string& jsonFile);
+
+// Generates a synthetic dataset for every airport count (years x 12 months each) and
+// measures load time on each thread count, memory kept per structure and query latency
+// as the data grows; the generated files are removed afterwards
+void runScalingBenchmark(const std::vector<size_t>& airportCounts, int years, const std::vector<unsigned>& threadCounts,
+                         const BenchConfig& config, const std::string& jsonFile);
@@ -0,0 +1,82 @@
+#include "BufferedWriter.h"
+
+#include <charconv>
+#include <cstring>
+
+using namespace std;
+
+BufferedWriter::BufferedWriter(FILE* stream, size_t capacity) : stream(stream), buffer(capacity) {}
+
+BufferedWriter::BufferedWriter(const string& filename, size_t capacity) : buffer(capacity) {
+    stream = fopen(filename.c_str(), "wb");
+    ownsStream = stream != nullptr;
+}
+
+BufferedWriter::~BufferedWriter() {
+    flush();
+    if (ownsStream) {
+        fclose(stream);
+    }
+}
+
+void BufferedWriter::flush() {
+    if (stream != nullptr && used > 0) {
+        fwrite(buffer.data(), 1, used, stream);
+        fflush(stream);
+    }
+    used = 0;
+}
+
+// Makes room for `bytes` more characters, flushing first when the buffer is full
+void BufferedWriter::reserve(size_t bytes) {
+    if (used + bytes > buffer.size()) {
+        flush();
+        if (bytes > buffer.size()) {
+            buffer.resize(bytes);
+        }
+    }
+}
+
+BufferedWriter& BufferedWriter::write(string_view text) {
+    reserve(text.size());
+    memcpy(buffer.data() + used, text.data(), text.size());
+    used += text.size();
+    return *this;
+}
+
+BufferedWriter& BufferedWriter::write(char c) {
+    reserve(1);
+    buffer[used++] = c;
+    return *this;
+}
+
+BufferedWriter& BufferedWriter::write(long long value) {
+    reserve(24);
+    char* end = to_chars(buffer.data() + used, buffer.data() + buffer.size(), value).ptr;
+    used = static_cast<size_t>(end - buffer.data());
+    return *this;
+}
+
+BufferedWriter& BufferedWriter::write(double value, int decimals) {
+    reserve(352); // Longest fixed-notation double plus decimals
+    char* end = to_chars(buffer.data() + used, buffer.data() + buffer.size(), value, chars_format::fixed, decimals).ptr;
+    used = static_cast<size_t>(end - buffer.data());
+    return *this;
+}
+
+BufferedWriter& BufferedWriter::writeJsonEscaped(string_view text) {
+    static const char* const HEX = "0123456789abcdef";
+    for (char c : text) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (c == '\"' || c == '\\') {
+            write('\\').write(c);
+        }
+        else if (u < 0x20) {
+            write("\\u00").write(HEX[u >> 4]).write(HEX[u & 15]);
+        }
+        else {
+            write(c);
+        }
+    }
+    return *this;
+}
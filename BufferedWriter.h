@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Output buffer flushed in large blocks instead of one write (or endl flush) per line
+class BufferedWriter {
+public:
+    // Writes to an already open stream (e.g. stdout), which is not closed
+    explicit BufferedWriter(FILE* stream, size_t capacity = 1 << 20);
+    // Opens the file for writing; isOpen() is false when that failed
+    explicit BufferedWriter(const std::string& filename, size_t capacity = 1 << 20);
+    ~BufferedWriter();
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    bool isOpen() const { return stream != nullptr; }
+    BufferedWriter& write(std::string_view text);
+    BufferedWriter& write(char c);
+    BufferedWriter& write(long long value);
+    // Fixed notation with the given number of decimals
+    BufferedWriter& write(double value, int decimals);
+    // Text inside a JSON string, with quotes and control characters escaped
+    BufferedWriter& writeJsonEscaped(std::string_view text);
+    void flush();
+
+private:
+    void reserve(size_t bytes);
+
+    FILE* stream = nullptr;
+    bool ownsStream = false;
+    std::vector<char> buffer;
+    size_t used = 0;
+};
@@ -0,0 +1,478 @@
+#include "ColumnFile.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+static const char COLUMN_FILE_MAGIC[8] = { 'A', 'I', 'R', 'C', 'O', 'L', 'S', '\0' };
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+// Zero bytes after every segment, so unpacking can always load 8 bytes at once
+static const size_t SEGMENT_PADDING = 8;
+
+enum ColumnEncoding : uint8_t {
+    ENCODING_FOR,   // Base + bit-packed offsets from it
+    ENCODING_DELTA, // First value + bit-packed differences to the previous one (minus the smallest)
+    ENCODING_DICT,  // Distinct values + bit-packed indices into them
+    ENCODING_COUNT
+};
+
+static int bitsFor(uint64_t value) {
+    int bits = 0;
+    while (value != 0) {
+        bits++;
+        value >>= 1;
+    }
+    return bits;
+}
+
+static size_t packedBytes(size_t count, int width) {
+    return (count * static_cast<size_t>(width) + 7) / 8;
+}
+
+// Bytes one column of a block takes, header included
+static size_t encodedSize(int encoding, int width, size_t rows, size_t distinct) {
+    switch (encoding) {
+    case ENCODING_FOR:
+        return 2 + 4 + packedBytes(rows, width);
+    case ENCODING_DELTA:
+        return 2 + 8 + packedBytes(rows - 1, width);
+    default:
+        return 2 + 2 + 4 * distinct + packedBytes(rows, width);
+    }
+}
+
+// Little-endian bit stream, LSB first
+class BitPacker {
+public:
+    explicit BitPacker(vector<char>& out) : out(out) {}
+    // Flushes the last partial bytes
+    ~BitPacker() {
+        for (int i = 0; i < used; i += 8) {
+            out.push_back(static_cast<char>(pending >> i));
+        }
+    }
+
+    void put(uint64_t value, int width) {
+        if (width == 0) {
+            return;
+        }
+        pending |= value << used;
+        used += width;
+        if (used >= 32) {
+            for (int i = 0; i < 32; i += 8) {
+                out.push_back(static_cast<char>(pending >> i));
+            }
+            pending >>= 32;
+            used -= 32;
+        }
+    }
+
+private:
+    vector<char>& out;
+    uint64_t pending = 0;
+    int used = 0;
+};
+
+static void unpack(const char* data, size_t count, int width, uint32_t* values) {
+    if (width == 0) {
+        fill(values, values + count, 0u);
+        return;
+    }
+    uint64_t mask = (1ull << width) - 1;
+    size_t bit = 0;
+    for (size_t i = 0; i < count; i++, bit += width) {
+        uint64_t word;
+        memcpy(&word, data + (bit >> 3), 8);
+        values[i] = static_cast<uint32_t>((word >> (bit & 7)) & mask);
+    }
+}
+
+template <typename T>
+static void append(vector<char>& out, T value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+// Encodes one column of a block with whichever encoding comes out smallest
+static void encodeColumn(const int32_t* values, size_t rows, vector<char>& out) {
+    int32_t low = *min_element(values, values + rows);
+    int32_t high = *max_element(values, values + rows);
+    int forWidth = bitsFor(static_cast<uint64_t>(static_cast<int64_t>(high) - low));
+
+    int64_t lowDelta = 0;
+    int64_t highDelta = 0;
+    for (size_t i = 1; i < rows; i++) {
+        int64_t delta = static_cast<int64_t>(values[i]) - values[i - 1];
+        lowDelta = i == 1 ? delta : min(lowDelta, delta);
+        highDelta = i == 1 ? delta : max(highDelta, delta);
+    }
+    int deltaWidth = bitsFor(static_cast<uint64_t>(highDelta - lowDelta));
+
+    vector<int32_t> distinct(values, values + rows);
+    sort(distinct.begin(), distinct.end());
+    distinct.erase(unique(distinct.begin(), distinct.end()), distinct.end());
+    int dictWidth = bitsFor(distinct.size() - 1);
+
+    int encoding = ENCODING_FOR;
+    size_t best = encodedSize(ENCODING_FOR, forWidth, rows, 0);
+    if (rows > 1 && deltaWidth <= 32 && encodedSize(ENCODING_DELTA, deltaWidth, rows, 0) < best) {
+        encoding = ENCODING_DELTA;
+        best = encodedSize(ENCODING_DELTA, deltaWidth, rows, 0);
+    }
+    if (distinct.size() <= 0xFFFF && encodedSize(ENCODING_DICT, dictWidth, rows, distinct.size()) < best) {
+        encoding = ENCODING_DICT;
+    }
+
+    out.push_back(static_cast<char>(encoding));
+    if (encoding == ENCODING_FOR) {
+        out.push_back(static_cast<char>(forWidth));
+        append(out, low);
+        BitPacker packer(out);
+        for (size_t i = 0; i < rows; i++) {
+            packer.put(static_cast<uint64_t>(static_cast<int64_t>(values[i]) - low), forWidth);
+        }
+    }
+    else if (encoding == ENCODING_DELTA) {
+        out.push_back(static_cast<char>(deltaWidth));
+        append(out, values[0]);
+        append(out, static_cast<int32_t>(lowDelta));
+        BitPacker packer(out);
+        for (size_t i = 1; i < rows; i++) {
+            packer.put(static_cast<uint64_t>(static_cast<int64_t>(values[i]) - values[i - 1] - lowDelta), deltaWidth);
+        }
+    }
+    else {
+        out.push_back(static_cast<char>(dictWidth));
+        append(out, static_cast<uint16_t>(distinct.size()));
+        for (int32_t value : distinct) {
+            append(out, value);
+        }
+        BitPacker packer(out);
+        for (size_t i = 0; i < rows; i++) {
+            packer.put(static_cast<uint64_t>(lower_bound(distinct.begin(), distinct.end(), values[i]) - distinct.begin()),
+                       dictWidth);
+        }
+    }
+}
+
+// Size of the encoded column starting at data, 0 when the header is invalid or it does not fit in `available`
+static size_t encodedColumnSize(const char* data, size_t available, size_t rows) {
+    if (available < 2) {
+        return 0;
+    }
+    int encoding = static_cast<uint8_t>(data[0]);
+    int width = static_cast<uint8_t>(data[1]);
+    if (encoding >= ENCODING_COUNT || width > 32) {
+        return 0;
+    }
+    size_t distinct = 0;
+    if (encoding == ENCODING_DICT) {
+        if (available < 4) {
+            return 0;
+        }
+        uint16_t count;
+        memcpy(&count, data + 2, sizeof(count));
+        distinct = count;
+    }
+    size_t size = encodedSize(encoding, width, rows, distinct);
+    return size <= available ? size : 0;
+}
+
+static void decodeColumn(const char* data, size_t rows, int32_t* values) {
+    int encoding = static_cast<uint8_t>(data[0]);
+    int width = static_cast<uint8_t>(data[1]);
+    uint32_t* raw = reinterpret_cast<uint32_t*>(values);
+    if (encoding == ENCODING_FOR) {
+        int32_t base;
+        memcpy(&base, data + 2, 4);
+        unpack(data + 6, rows, width, raw);
+        for (size_t i = 0; i < rows; i++) {
+            values[i] = static_cast<int32_t>(static_cast<uint32_t>(base) + raw[i]);
+        }
+    }
+    else if (encoding == ENCODING_DELTA) {
+        int32_t first;
+        int32_t base;
+        memcpy(&first, data + 2, 4);
+        memcpy(&base, data + 6, 4);
+        unpack(data + 10, rows - 1, width, raw + 1);
+        raw[0] = static_cast<uint32_t>(first);
+        for (size_t i = 1; i < rows; i++) {
+            raw[i] = raw[i - 1] + static_cast<uint32_t>(base) + raw[i];
+        }
+    }
+    else {
+        uint16_t count;
+        memcpy(&count, data + 2, 2);
+        const char* dictionary = data + 4;
+        unpack(dictionary + 4 * static_cast<size_t>(count), rows, width, raw);
+        for (size_t i = 0; i < rows; i++) {
+            int32_t value = 0;
+            if (raw[i] < count) {
+                memcpy(&value, dictionary + 4 * static_cast<size_t>(raw[i]), 4);
+            }
+            values[i] = value;
+        }
+    }
+}
+
+static uint64_t alignUp(uint64_t offset) {
+    return (offset + 7) / 8 * 8;
+}
+
+bool writeColumnFile(const TableView& table, const string& filename, string& error) {
+    METRICS_TIMER(timer, STAGE_FORMAT);
+    METRICS_ITEMS(timer, table.rows);
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (table.counters[c] == nullptr && table.rows > 0) {
+            error = "Cannot write a column file of a table with missing columns";
+            return false;
+        }
+    }
+
+    // Airport ids renumbered in code order, so sorted rows also have sorted ids and codes
+    vector<uint32_t> byCode(table.airports);
+    for (uint32_t id = 0; id < table.airports; id++) {
+        byCode[id] = id;
+    }
+    sort(byCode.begin(), byCode.end(), [&](uint32_t a, uint32_t b) { return table.codes[a] < table.codes[b]; });
+    vector<uint32_t> newId(table.airports);
+    for (uint32_t id = 0; id < table.airports; id++) {
+        newId[byCode[id]] = id;
+    }
+    vector<uint32_t> order(table.rows);
+    for (size_t i = 0; i < table.rows; i++) {
+        order[i] = static_cast<uint32_t>(i);
+    }
+    stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        uint32_t x = newId[table.airport[a]];
+        uint32_t y = newId[table.airport[b]];
+        return x != y ? x < y : table.period[a] < table.period[b];
+    });
+
+    size_t blockTotal = (table.rows + COLUMN_BLOCK_ROWS - 1) / COLUMN_BLOCK_ROWS;
+    vector<ColumnBlockInfo> blocks(blockTotal);
+    vector<char> segments[COLUMN_FILE_COLUMNS];
+    int32_t values[COLUMN_BLOCK_ROWS];
+    for (size_t b = 0; b < blockTotal; b++) {
+        size_t begin = b * COLUMN_BLOCK_ROWS;
+        size_t rows = min(COLUMN_BLOCK_ROWS, table.rows - begin);
+        ColumnBlockInfo& info = blocks[b];
+        memset(&info, 0, sizeof(info));
+        info.rows = static_cast<uint32_t>(rows);
+        info.minCode = table.codes[table.airport[order[begin]]];
+        info.maxCode = table.codes[table.airport[order[begin + rows - 1]]];
+        info.minPeriod = 0xFFFF;
+        info.maxTotal = table.counters[TOTAL_FLIGHTS][order[begin]];
+        for (size_t i = begin; i < begin + rows; i++) {
+            uint16_t period = table.period[order[i]];
+            info.minPeriod = min(info.minPeriod, period);
+            info.maxPeriod = max(info.maxPeriod, period);
+            info.monthMask |= static_cast<uint16_t>(1u << (periodMonth(period) & 15));
+            info.maxTotal = max(info.maxTotal, table.counters[TOTAL_FLIGHTS][order[i]]);
+        }
+        for (int column = 0; column < COLUMN_FILE_COLUMNS; column++) {
+            for (size_t i = 0; i < rows; i++) {
+                uint32_t row = order[begin + i];
+                if (column == 0) {
+                    values[i] = static_cast<int32_t>(newId[table.airport[row]]);
+                }
+                else if (column == 1) {
+                    values[i] = table.period[row];
+                }
+                else {
+                    values[i] = table.counters[column - 2][row];
+                }
+            }
+            info.offsets[column] = static_cast<uint32_t>(segments[column].size());
+            encodeColumn(values, rows, segments[column]);
+        }
+    }
+
+    // Dictionary in the new id order
+    vector<uint32_t> codes(table.airports);
+    vector<uint32_t> nameOffsets(table.airports + 1, 0);
+    vector<CodeIndexEntry> codeIndex(table.airports);
+    string names;
+    for (uint32_t id = 0; id < table.airports; id++) {
+        codes[id] = table.codes[byCode[id]];
+        names += table.airportName(byCode[id]);
+        nameOffsets[id + 1] = static_cast<uint32_t>(names.size());
+        codeIndex[id] = CodeIndexEntry{ codes[id], id };
+    }
+
+    ColumnFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COLUMN_FILE_MAGIC, sizeof(header.magic));
+    header.version = COLUMN_FILE_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.rows = table.rows;
+    header.airports = table.airports;
+    header.blocks = blockTotal;
+    header.nameBytes = names.size();
+    uint64_t offset = alignUp(sizeof(header));
+    header.dictionary = offset;
+    offset = alignUp(offset + (codes.size() + nameOffsets.size()) * sizeof(uint32_t) +
+                     codeIndex.size() * sizeof(CodeIndexEntry) + names.size());
+    header.directory = offset;
+    offset = alignUp(offset + blocks.size() * sizeof(ColumnBlockInfo));
+    for (int column = 0; column < COLUMN_FILE_COLUMNS; column++) {
+        header.segments[column] = offset;
+        header.segmentSizes[column] = segments[column].size();
+        offset = alignUp(offset + segments[column].size() + SEGMENT_PADDING);
+    }
+    header.fileSize = offset;
+
+    vector<char> contents;
+    contents.reserve(header.fileSize);
+    auto appendBytes = [&](const void* data, size_t size) {
+        contents.insert(contents.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+    };
+    auto padTo = [&](uint64_t position) { contents.resize(position, 0); };
+    appendBytes(&header, sizeof(header));
+    padTo(header.dictionary);
+    appendBytes(codes.data(), codes.size() * sizeof(uint32_t));
+    appendBytes(nameOffsets.data(), nameOffsets.size() * sizeof(uint32_t));
+    appendBytes(codeIndex.data(), codeIndex.size() * sizeof(CodeIndexEntry));
+    appendBytes(names.data(), names.size());
+    padTo(header.directory);
+    appendBytes(blocks.data(), blocks.size() * sizeof(ColumnBlockInfo));
+    for (int column = 0; column < COLUMN_FILE_COLUMNS; column++) {
+        padTo(header.segments[column]);
+        appendBytes(segments[column].data(), segments[column].size());
+    }
+    padTo(header.fileSize);
+
+    ofstream out(filename, ios::binary | ios::trunc);
+    if (!out) {
+        error = "Cannot open " + filename + " for writing";
+        return false;
+    }
+    out.write(contents.data(), contents.size());
+    out.flush();
+    if (!out) {
+        error = "Failed writing " + filename;
+        return false;
+    }
+    return true;
+}
+
+bool ColumnFile::open(const string& filename, string& error) {
+    METRICS_TIMER(timer, STAGE_READ);
+    file = MappedFile(filename);
+    table = TableView();
+    rows = 0;
+    blockTotal = 0;
+    blocks = nullptr;
+    error.clear();
+    string_view contents = file.contents();
+    if (!file.isOpen()) {
+        error = "Cannot open column file " + filename;
+        return false;
+    }
+    ColumnFileHeader header;
+    if (contents.size() < sizeof(header)) {
+        error = filename + " is too small to be a column file";
+        file = MappedFile();
+        return false;
+    }
+    memcpy(&header, contents.data(), sizeof(header));
+    uint64_t dictionaryBytes = (2 * header.airports + 1) * sizeof(uint32_t) + header.airports * sizeof(CodeIndexEntry) +
+                               header.nameBytes;
+    if (memcmp(header.magic, COLUMN_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        error = filename + " is not a column file";
+    }
+    else if (header.byteOrder != BYTE_ORDER_MARK) {
+        error = filename + " was written on a machine with a different byte order";
+    }
+    else if (header.version != COLUMN_FILE_VERSION) {
+        error = filename + " is column file version " + to_string(header.version) + ", expected " +
+                to_string(COLUMN_FILE_VERSION) + " (rebuild it with --build-columns)";
+    }
+    else if (header.fileSize != contents.size()) {
+        error = filename + " is truncated";
+    }
+    else if (header.rows > header.blocks * COLUMN_BLOCK_ROWS || header.airports > header.fileSize ||
+             header.nameBytes > header.fileSize || header.blocks > header.fileSize ||
+             header.dictionary + dictionaryBytes > header.fileSize ||
+             header.directory + header.blocks * sizeof(ColumnBlockInfo) > header.fileSize) {
+        error = filename + " has a bad section table";
+    }
+    else if (header.blocks > 0 && header.airports == 0) {
+        error = filename + " has rows but no airports";
+    }
+    for (int column = 0; column < COLUMN_FILE_COLUMNS && error.empty(); column++) {
+        if (header.segmentSizes[column] > header.fileSize ||
+            header.segments[column] + header.segmentSizes[column] + SEGMENT_PADDING > header.fileSize) {
+            error = filename + " has a bad section table";
+        }
+    }
+    const char* base = contents.data();
+    const ColumnBlockInfo* directory = reinterpret_cast<const ColumnBlockInfo*>(base + header.directory);
+    // Every encoded column has to fit in its segment, so decoding never reads past the file
+    for (size_t b = 0; b < header.blocks && error.empty(); b++) {
+        const ColumnBlockInfo& info = directory[b];
+        if (info.rows == 0 || info.rows > COLUMN_BLOCK_ROWS) {
+            error = filename + " has a bad block directory";
+        }
+        for (int column = 0; column < COLUMN_FILE_COLUMNS && error.empty(); column++) {
+            uint64_t start = info.offsets[column];
+            if (start >= header.segmentSizes[column] ||
+                encodedColumnSize(base + header.segments[column] + start, header.segmentSizes[column] - start,
+                                  info.rows) == 0) {
+                error = filename + " has a bad block directory";
+            }
+        }
+    }
+    if (!error.empty()) {
+        file = MappedFile();
+        return false;
+    }
+
+    const char* dictionary = base + header.dictionary;
+    table.airports = header.airports;
+    table.codes = reinterpret_cast<const uint32_t*>(dictionary);
+    table.nameOffsets = table.codes + header.airports;
+    table.codeIndex = reinterpret_cast<const CodeIndexEntry*>(table.nameOffsets + header.airports + 1);
+    table.nameBlob = reinterpret_cast<const char*>(table.codeIndex + header.airports);
+    if (!table.validDictionary(header.nameBytes)) {
+        error = filename + " has a corrupt dictionary";
+        table = TableView();
+        file = MappedFile();
+        return false;
+    }
+    rows = header.rows;
+    blockTotal = header.blocks;
+    blocks = directory;
+    for (int column = 0; column < COLUMN_FILE_COLUMNS; column++) {
+        segments[column] = base + header.segments[column];
+    }
+    METRICS_ITEMS(timer, contents.size());
+    return true;
+}
+
+TableView ColumnFile::decodeBlock(size_t b, uint32_t projection, ColumnBlockData& data) const {
+    const ColumnBlockInfo& info = blocks[b];
+    TableView view = table;
+    view.rows = info.rows;
+    decodeColumn(segments[0] + info.offsets[0], info.rows, reinterpret_cast<int32_t*>(data.airport));
+    int32_t periods[COLUMN_BLOCK_ROWS];
+    decodeColumn(segments[1] + info.offsets[1], info.rows, periods);
+    for (size_t i = 0; i < info.rows; i++) {
+        data.period[i] = static_cast<uint16_t>(periods[i]);
+        // A corrupt id would index past the dictionary
+        data.airport[i] = data.airport[i] < table.airports ? data.airport[i] : 0;
+    }
+    view.airport = data.airport;
+    view.period = data.period;
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if ((projection >> c) & 1) {
+            decodeColumn(segments[2 + c] + info.offsets[2 + c], info.rows, data.counters[c]);
+            view.counters[c] = data.counters[c];
+        }
+    }
+    return view;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ColumnStore.h"
+#include "CsvLoader.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compressed columnar file: rows sorted by (airport code, year, month) and cut into blocks
+// of COLUMN_BLOCK_ROWS; every column of a block is encoded on its own, as frame-of-reference
+// bit-packing, bit-packed deltas or a bit-packed dictionary, whichever is smallest
+// Each column is one segment of the file, so reading some columns never touches the others,
+// and the block directory carries a zone map per block so a scan can skip whole blocks
+// on year, month, airport code or flight count
+// Native byte order, like the snapshot; the other order is rejected
+const uint32_t COLUMN_FILE_VERSION = 1;
+const size_t COLUMN_BLOCK_ROWS = 256;
+// Airport id, period, then the counters
+const int COLUMN_FILE_COLUMNS = 2 + COUNTER_COUNT;
+
+// Directory entry and zone map of one block
+struct ColumnBlockInfo {
+    uint32_t rows;
+    uint32_t minCode; // Packed airport codes of the first and last row
+    uint32_t maxCode;
+    uint16_t minPeriod;
+    uint16_t maxPeriod;
+    uint16_t monthMask; // Bit m set when month m occurs
+    uint16_t reserved;
+    int32_t maxTotal;   // Largest total flights of any row
+    uint32_t offsets[COLUMN_FILE_COLUMNS]; // Where each column of the block starts in its segment
+};
+
+struct ColumnFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t rows;
+    uint64_t airports;
+    uint64_t blocks;
+    uint64_t nameBytes;
+    uint64_t fileSize;
+    uint64_t dictionary;                       // Codes, name offsets, code index and names, in that order
+    uint64_t directory;                        // blocks x ColumnBlockInfo
+    uint64_t segments[COLUMN_FILE_COLUMNS];    // Start of each column segment
+    uint64_t segmentSizes[COLUMN_FILE_COLUMNS];
+};
+
+// Writes the table sorted and encoded, returns false (with a message) on failure
+// Every counter column must be loaded
+bool writeColumnFile(const TableView& table, const std::string& filename, std::string& error);
+
+// Decoded columns of one block
+struct ColumnBlockData {
+    uint32_t airport[COLUMN_BLOCK_ROWS];
+    uint16_t period[COLUMN_BLOCK_ROWS];
+    int32_t counters[COUNTER_COUNT][COLUMN_BLOCK_ROWS];
+};
+
+// A mapped column file; blocks are decoded on demand, nothing else is read up front
+class ColumnFile {
+public:
+    // Checks the header, the dictionary (name offsets, code index) and every block's encoded sizes against the file
+    bool open(const std::string& filename, std::string& error);
+    bool isOpen() const { return file.isOpen(); }
+    size_t fileSize() const { return file.contents().size(); }
+    size_t rowCount() const { return rows; }
+    size_t blockCount() const { return blockTotal; }
+    const ColumnBlockInfo& block(size_t b) const { return blocks[b]; }
+    // The airport dictionary, ids in code order; no rows
+    const TableView& dictionary() const { return table; }
+
+    // Decodes the airport and period columns and the counters in `projection` of block b
+    // The returned view has the block's rows, its dictionary is the file's and the
+    // counters left out of the projection are null
+    TableView decodeBlock(size_t b, uint32_t projection, ColumnBlockData& data) const;
+
+private:
+    MappedFile file;
+    TableView table;
+    size_t rows = 0;
+    size_t blockTotal = 0;
+    const ColumnBlockInfo* blocks = nullptr;
+    const char* segments[COLUMN_FILE_COLUMNS] = {};
+};
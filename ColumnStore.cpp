@@ -0,0 +1,265 @@
+#include "ColumnStore.h"
+#include "CsvLoader.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+
+static const char* const MONTH_NAMES[13] = { "", "January", "February", "March", "April", "May", "June", "July",
+                                             "August", "September", "October", "November", "December" };
+
+static const char* const COUNTER_NAMES[COUNTER_COUNT] = {
+    "carrier_delays", "late_delays",     "navis_delays",    "security_delays",  "weather_delays",  "canceled_flights",
+    "delayed_flights", "total_flights",  "diverted_flights", "on_time_flights", "carriers_total",  "carrier_minutes",
+    "late_minutes",   "navis_minutes",   "security_minutes", "weather_minutes", "delay_minutes"
+};
+
+// airlines.csv column every counter is parsed from
+static const CsvColumn COUNTER_SOURCES[COUNTER_COUNT] = {
+    COL_DELAYS_CARRIER, COL_DELAYS_LATE,     COL_DELAYS_NAVIS,     COL_DELAYS_SECURITY,  COL_DELAYS_WEATHER,
+    COL_CANCELED,       COL_DELAYED,         COL_TOTAL_FLIGHTS,    COL_DIVERTED,         COL_ON_TIME,
+    COL_CARRIERS_TOTAL, COL_MINUTES_CARRIER, COL_MINUTES_LATE,     COL_MINUTES_NAVIS,    COL_MINUTES_SECURITY,
+    COL_MINUTES_WEATHER, COL_MINUTES_TOTAL
+};
+
+uint32_t packCode(string_view code) {
+    uint32_t packed = 0;
+    for (size_t i = 0; i < 4; i++) {
+        packed <<= 8;
+        if (i < code.size()) {
+            packed |= static_cast<unsigned char>(code[i]);
+        }
+    }
+    return packed;
+}
+
+string unpackCode(uint32_t packed) {
+    string code;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        char c = static_cast<char>((packed >> shift) & 0xFF);
+        if (c != '\0') {
+            code.push_back(c);
+        }
+    }
+    return code;
+}
+
+const char* monthName(int month) {
+    if (month < 1 || month > 12) {
+        return "";
+    }
+    return MONTH_NAMES[month];
+}
+
+int monthNumber(string_view name) {
+    for (int month = 1; month <= 12; month++) {
+        string_view candidate = MONTH_NAMES[month];
+        if (candidate.size() == name.size() &&
+            equal(name.begin(), name.end(), candidate.begin(), [](char a, char b) { return tolower(a) == tolower(b); })) {
+            return month;
+        }
+    }
+    return 0;
+}
+
+const char* counterName(int column) {
+    return column >= 0 && column < COUNTER_COUNT ? COUNTER_NAMES[column] : "";
+}
+
+bool parseCounterProjection(string_view list, uint32_t& projection) {
+    projection = REQUIRED_COUNTERS;
+    while (!list.empty()) {
+        size_t comma = min(list.find(','), list.size());
+        string_view name = list.substr(0, comma);
+        list.remove_prefix(min(comma + 1, list.size()));
+        if (name == "all") {
+            projection |= ALL_COUNTERS;
+        }
+        else if (name == "delays") {
+            projection |= DELAY_COUNTERS;
+        }
+        else if (name == "minutes") {
+            for (int c = CARRIER_MINUTES; c <= DELAY_MINUTES; c++) {
+                projection |= 1u << c;
+            }
+        }
+        else {
+            int c = 0;
+            while (c < COUNTER_COUNT && name != COUNTER_NAMES[c]) {
+                c++;
+            }
+            if (c == COUNTER_COUNT) {
+                return false;
+            }
+            projection |= 1u << c;
+        }
+    }
+    return true;
+}
+
+size_t csvColumnsFor(uint32_t projection) {
+    size_t columns = COL_YEAR + 1;
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if ((projection >> c) & 1) {
+            columns = max(columns, static_cast<size_t>(COUNTER_SOURCES[c]) + 1);
+        }
+    }
+    return columns;
+}
+
+int TableView::findAirport(string_view code) const {
+    if (code.size() > 4) {
+        return -1;
+    }
+    uint32_t packed = packCode(code);
+    const CodeIndexEntry* end = codeIndex + airports;
+    const CodeIndexEntry* it = lower_bound(codeIndex, end, packed,
+                                           [](const CodeIndexEntry& entry, uint32_t key) { return entry.code < key; });
+    if (it == end || it->code != packed) {
+        return -1;
+    }
+    return static_cast<int>(it->airport);
+}
+
+bool TableView::validDictionary(uint64_t nameBytes) const {
+    if (nameOffsets[0] != 0 || nameOffsets[airports] != nameBytes) {
+        return false;
+    }
+    for (size_t a = 0; a < airports; a++) {
+        const CodeIndexEntry& entry = codeIndex[a];
+        if (nameOffsets[a] > nameOffsets[a + 1] || entry.airport >= airports ||
+            (a > 0 && codeIndex[a - 1].code >= entry.code)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void AirportTable::reserve(size_t rows) {
+    airport.reserve(rows);
+    period.reserve(rows);
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (hasColumn(c)) {
+            counters[c].reserve(rows);
+        }
+    }
+}
+
+uint32_t AirportTable::internAirport(string_view code, string_view name) {
+    uint32_t packed = packCode(code);
+    auto it = lower_bound(codeIndex.begin(), codeIndex.end(), packed,
+                          [](const CodeIndexEntry& entry, uint32_t key) { return entry.code < key; });
+    if (it != codeIndex.end() && it->code == packed) {
+        return it->airport;
+    }
+    uint32_t id = static_cast<uint32_t>(codes.size());
+    codes.push_back(packed);
+    nameBlob.append(name);
+    nameOffsets.push_back(static_cast<uint32_t>(nameBlob.size()));
+    codeIndex.insert(it, CodeIndexEntry{ packed, id });
+    return id;
+}
+
+void AirportTable::appendRow(uint32_t airportId, uint16_t key, const int32_t values[COUNTER_COUNT]) {
+    airport.push_back(airportId);
+    period.push_back(key);
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (hasColumn(c)) {
+            counters[c].push_back(values[c]);
+        }
+    }
+}
+
+void AirportTable::appendRow(const CsvRow& columns) {
+    int32_t values[COUNTER_COUNT];
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        values[c] = hasColumn(c) ? parseInt(columns[COUNTER_SOURCES[c]]) : 0;
+    }
+    uint32_t id = internAirport(columns[COL_CODE], AirportName(columns[COL_NAME]));
+    appendRow(id, periodKey(parseInt(columns[COL_YEAR]), parseInt(columns[COL_MONTH])), values);
+}
+
+void AirportTable::appendTable(const AirportTable& other) {
+    // Local ids are in first-seen order, interning them in that order keeps the ids a
+    // single pass over both tables would give
+    TableView local = other.view();
+    vector<uint32_t> remap(local.airports);
+    for (uint32_t id = 0; id < local.airports; id++) {
+        remap[id] = internAirport(local.airportCode(id), local.airportName(id));
+    }
+    for (size_t i = 0; i < other.rowCount(); i++) {
+        airport.push_back(remap[other.airport[i]]);
+    }
+    period.insert(period.end(), other.period.begin(), other.period.end());
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        counters[c].insert(counters[c].end(), other.counters[c].begin(), other.counters[c].end());
+    }
+}
+
+void AirportTable::rowValues(size_t row, int32_t values[COUNTER_COUNT]) const {
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        values[c] = hasColumn(c) ? counters[c][row] : 0;
+    }
+}
+
+size_t AirportTable::memoryUsage() const {
+    size_t bytes = airport.capacity() * sizeof(uint32_t) + period.capacity() * sizeof(uint16_t);
+    for (const auto& column : counters) {
+        bytes += column.capacity() * sizeof(int32_t);
+    }
+    bytes += codes.capacity() * sizeof(uint32_t) + nameOffsets.capacity() * sizeof(uint32_t);
+    bytes += nameBlob.capacity() + codeIndex.capacity() * sizeof(CodeIndexEntry);
+    return bytes;
+}
+
+TableView AirportTable::view() const {
+    TableView table;
+    table.rows = rowCount();
+    table.airport = airport.data();
+    table.period = period.data();
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        table.counters[c] = hasColumn(c) ? counters[c].data() : nullptr;
+    }
+    table.airports = airportCount();
+    table.codes = codes.data();
+    table.nameOffsets = nameOffsets.data();
+    table.nameBlob = nameBlob.data();
+    table.codeIndex = codeIndex.data();
+    return table;
+}
+
+AirportTable buildAirportTable(const string& filename, uint32_t projection) {
+    AirportTable table;
+    table.projection = projection;
+    MappedFile file(filename);
+    string_view contents = file.contents();
+    METRICS_TIMER(timer, STAGE_PARSE);
+    // Reserving up front avoids regrowing every column while loading
+    table.reserve(countLines(contents));
+    forEachCsvRow(contents, [&](const CsvRow& columns) {
+        table.appendRow(columns);
+    }, true, csvColumnsFor(projection));
+    METRICS_ITEMS(timer, table.rowCount());
+    return table;
+}
+
+AirportTable buildAirportTable(const TableView& view) {
+    AirportTable table;
+    table.airport.assign(view.airport, view.airport + view.rows);
+    table.period.assign(view.period, view.period + view.rows);
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (view.counters[c] != nullptr) {
+            table.counters[c].assign(view.counters[c], view.counters[c] + view.rows);
+        }
+        else if (view.rows > 0) {
+            table.projection &= ~(1u << c);
+        }
+    }
+    table.codes.assign(view.codes, view.codes + view.airports);
+    table.nameOffsets.assign(view.nameOffsets, view.nameOffsets + view.airports + 1);
+    table.nameBlob.assign(view.nameBlob, view.nameOffsets[view.airports]);
+    table.codeIndex.assign(view.codeIndex, view.codeIndex + view.airports);
+    return table;
+}
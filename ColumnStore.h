@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct CsvRow;
+
+// Counter columns stored for every row, one contiguous int32 array each
+enum CounterColumn {
+    CARRIER_DELAYS,   // Number of delays due to carrier
+    LATE_DELAYS,      // Number of delays due to late arrival of aircraft
+    NAVIS_DELAYS,     // Number of delays due to National Aviation System
+    SECURITY_DELAYS,  // Number of delays due to security
+    WEATHER_DELAYS,   // Number of delays due to weather
+    CANCELED_FLIGHTS, // Number of canceled flights
+    DELAYED_FLIGHTS,  // Number of delayed flights
+    TOTAL_FLIGHTS,    // Number of Total Flights
+    DIVERTED_FLIGHTS, // Number of diverted flights
+    ON_TIME_FLIGHTS,  // Number of on-time flights
+    CARRIERS_TOTAL,   // Number of carriers serving the airport that month
+    CARRIER_MINUTES,  // Minutes delayed, by cause and in total
+    LATE_MINUTES,
+    NAVIS_MINUTES,
+    SECURITY_MINUTES,
+    WEATHER_MINUTES,
+    DELAY_MINUTES,
+    COUNTER_COUNT
+};
+
+// Set of counter columns to load, one bit per CounterColumn
+// Columns left out are not parsed or stored, and their view pointers are null
+const uint32_t ALL_COUNTERS = (1u << COUNTER_COUNT) - 1;
+const uint32_t DELAY_COUNTERS = (1u << (TOTAL_FLIGHTS + 1)) - 1; // The original eight
+// Always loaded, the delay rate kernels and the rankings read them unconditionally
+const uint32_t REQUIRED_COUNTERS = (1u << CANCELED_FLIGHTS) | (1u << DELAYED_FLIGHTS) | (1u << TOTAL_FLIGHTS);
+
+// Column name as used by --columns and the batch output ("late_minutes", ...)
+const char* counterName(int column);
+// Parses a comma separated list of column names, "delays", "minutes" or "all"
+// The required columns are always added; returns false on an unknown name
+bool parseCounterProjection(std::string_view list, uint32_t& projection);
+// Number of leading CSV columns a row must be split into to load the projection
+size_t csvColumnsFor(uint32_t projection);
+
+// Year and month packed in 16 bits (year * 16 + month), sorts in time order
+inline uint16_t periodKey(int year, int month) { return static_cast<uint16_t>(year * 16 + month); }
+inline int periodYear(uint16_t period) { return period >> 4; }
+inline int periodMonth(uint16_t period) { return period & 15; }
+
+// Airport code packed into an integer (up to 4 characters), compares like the string
+uint32_t packCode(std::string_view code);
+std::string unpackCode(uint32_t packed);
+
+// Month number (1-12) to name and back, 0 / "" when invalid
+const char* monthName(int month);
+int monthNumber(std::string_view name);
+
+// Dictionary entry used to find an airport id from its packed code
+struct CodeIndexEntry {
+    uint32_t code;
+    uint32_t airport;
+};
+
+// Read-only view over the columns, everything that scans data works on this
+struct TableView {
+    size_t rows = 0;
+    const uint32_t* airport = nullptr; // Dictionary id of every row
+    const uint16_t* period = nullptr;  // Packed year/month of every row
+    const int32_t* counters[COUNTER_COUNT] = {};
+
+    size_t airports = 0;
+    const uint32_t* codes = nullptr;       // Packed code of every airport id
+    const uint32_t* nameOffsets = nullptr; // airports + 1 offsets into nameBlob
+    const char* nameBlob = nullptr;
+    const CodeIndexEntry* codeIndex = nullptr; // Sorted by code
+
+    // Returns the airport id or -1 when the code is unknown
+    int findAirport(std::string_view code) const;
+    // Checks a dictionary read from a file before anything indexes with it: name offsets
+    // ascending from 0 to nameBytes, code index sorted by code with ids in range
+    bool validDictionary(uint64_t nameBytes) const;
+    std::string airportCode(uint32_t id) const { return unpackCode(codes[id]); }
+    std::string_view airportName(uint32_t id) const {
+        return std::string_view(nameBlob + nameOffsets[id], nameOffsets[id + 1] - nameOffsets[id]);
+    }
+};
+
+// Columnar (struct-of-arrays) airport table
+// Rows stay in load order; codes and names are interned once per airport
+struct AirportTable {
+    uint32_t projection = ALL_COUNTERS; // Counter columns that are stored
+    std::vector<uint32_t> airport;
+    std::vector<uint16_t> period;
+    std::vector<int32_t> counters[COUNTER_COUNT];
+
+    std::vector<uint32_t> codes;
+    std::vector<uint32_t> nameOffsets{0};
+    std::string nameBlob;
+    std::vector<CodeIndexEntry> codeIndex;
+
+    size_t rowCount() const { return period.size(); }
+    size_t airportCount() const { return codes.size(); }
+    bool hasColumn(int column) const { return (projection >> column) & 1; }
+    void reserve(size_t rows);
+    // Returns the id of the airport, adding it to the dictionary the first time
+    uint32_t internAirport(std::string_view code, std::string_view name);
+    void appendRow(uint32_t airportId, uint16_t periodKey, const int32_t values[COUNTER_COUNT]);
+    // Parses one airlines.csv row straight into the columns
+    // Only the projected columns are parsed
+    void appendRow(const CsvRow& columns);
+    // Appends every row of a table with the same projection, its airports interned in id order
+    void appendTable(const AirportTable& other);
+    // Counters of one row, 0 for columns that are not stored
+    void rowValues(size_t row, int32_t values[COUNTER_COUNT]) const;
+    // Bytes held by the columns and the dictionary
+    size_t memoryUsage() const;
+    TableView view() const;
+};
+
+// Function to read CSV into a columnar table
+AirportTable buildAirportTable(const std::string& filename, uint32_t projection = ALL_COUNTERS);
+// Copies loaded columns (e.g. a mapped snapshot) into a table that can grow
+// Columns missing from the view stay left out of the copy's projection
+AirportTable buildAirportTable(const TableView& table);
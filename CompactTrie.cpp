@@ -0,0 +1,196 @@
+#include "CompactTrie.h"
+#include "ColumnStore.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+AirportRecords findTrie(TrieNode* root, string_view code) {
+    TrieNode* node = root;
+    for (char c : code) {
+        auto it = node->children.find(c);
+        if (it == node->children.end()) {
+            return AirportRecords();
+        }
+        node = it->second;
+    }
+    return AirportRecords{ node->airport_data.data(), node->airport_data.size() };
+}
+
+int CompactTrie::slot(char c) {
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A';
+    }
+    if (c >= '0' && c <= '9') {
+        return 26 + (c - '0');
+    }
+    return -1;
+}
+
+int32_t CompactTrie::newNode() {
+    Node node;
+    fill(begin(node.child), end(node.child), -1);
+    node.leaf = -1;
+    nodes.push_back(node);
+    return static_cast<int32_t>(nodes.size() - 1);
+}
+
+CompactTrie::CompactTrie(const unordered_map<string, vector<AirportData>>& airports) {
+    vector<pair<const string*, const vector<AirportData>*>> list;
+    for (const auto& entry : airports) {
+        list.emplace_back(&entry.first, &entry.second);
+    }
+    build(list);
+}
+
+CompactTrie::CompactTrie(const vector<pair<string, vector<AirportData>>>& airports) {
+    vector<pair<const string*, const vector<AirportData>*>> list;
+    for (const auto& entry : airports) {
+        list.emplace_back(&entry.first, &entry.second);
+    }
+    build(list);
+}
+
+void CompactTrie::build(vector<pair<const string*, const vector<AirportData>*>>& airports) {
+    size_t rows = 0;
+    for (const auto& entry : airports) {
+        rows += entry.second->size();
+    }
+    sort(airports.begin(), airports.end(), [](const auto& a, const auto& b) { return *a.first < *b.first; });
+
+    records.reserve(rows);
+    newNode();
+    for (const auto& entry : airports) {
+        const string& code = *entry.first;
+        int32_t current = 0;
+        bool valid = !code.empty();
+        for (char c : code) {
+            int s = slot(c);
+            if (s < 0) {
+                valid = false; // Not an IATA style code, cannot be stored in a 36-way node
+                break;
+            }
+            if (nodes[current].child[s] < 0) {
+                int32_t child = newNode();
+                nodes[current].child[s] = child;
+            }
+            current = nodes[current].child[s];
+        }
+        if (!valid) {
+            continue;
+        }
+        const vector<AirportData>& data = *entry.second;
+        nodes[current].leaf = static_cast<int32_t>(spans.size());
+        spans.push_back(Span{ static_cast<uint32_t>(records.size()), static_cast<uint32_t>(data.size()) });
+        codes.push_back(code);
+        records.insert(records.end(), data.begin(), data.end());
+    }
+}
+
+AirportRecords CompactTrie::find(string_view code) const {
+    if (nodes.empty() || code.empty()) {
+        return AirportRecords();
+    }
+    int32_t current = 0;
+    for (char c : code) {
+        int s = slot(c);
+        if (s < 0 || nodes[current].child[s] < 0) {
+            return AirportRecords();
+        }
+        current = nodes[current].child[s];
+    }
+    int32_t leaf = nodes[current].leaf;
+    return leaf < 0 ? AirportRecords() : airport(static_cast<size_t>(leaf));
+}
+
+AirportRecords CompactTrie::airport(size_t leaf) const {
+    const Span& span = spans[leaf];
+    return AirportRecords{ records.data() + span.begin, span.count };
+}
+
+size_t CompactTrie::memoryUsage() const {
+    size_t bytes = nodes.capacity() * sizeof(Node) + spans.capacity() * sizeof(Span);
+    bytes += codes.capacity() * sizeof(string) + records.capacity() * sizeof(AirportData);
+    return bytes;
+}
+
+uint32_t PerfectHashIndex::hash(uint32_t key, uint32_t seed) {
+    uint32_t h = key ^ (seed * 0x9E3779B9u);
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+PerfectHashIndex::PerfectHashIndex(const CompactTrie& source) : trie(&source) {
+    size_t n = source.airportCount();
+    if (n == 0) {
+        return;
+    }
+    // About four keys per bucket; the biggest buckets are placed first while most slots are free
+    size_t bucketCount = (n + 3) / 4;
+    vector<vector<uint32_t>> buckets(bucketCount);
+    for (uint32_t leaf = 0; leaf < n; leaf++) {
+        if (source.airportCode(leaf).size() > 4) {
+            continue; // Would not fit the packed key
+        }
+        uint32_t key = packCode(source.airportCode(leaf));
+        buckets[hash(key, 0) % bucketCount].push_back(leaf);
+    }
+    vector<size_t> order(bucketCount);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    seeds.assign(bucketCount, 0);
+    keys.assign(n, 0);
+    leaves.assign(n, 0);
+    vector<bool> used(n, false);
+    vector<size_t> placed;
+    for (size_t b : order) {
+        if (buckets[b].empty()) {
+            continue;
+        }
+        for (uint32_t seed = 1;; seed++) {
+            placed.clear();
+            bool fits = true;
+            for (uint32_t leaf : buckets[b]) {
+                size_t slot = hash(packCode(source.airportCode(leaf)), seed) % n;
+                if (used[slot] || std::find(placed.begin(), placed.end(), slot) != placed.end()) {
+                    fits = false;
+                    break;
+                }
+                placed.push_back(slot);
+            }
+            if (!fits) {
+                continue;
+            }
+            seeds[b] = seed;
+            for (size_t i = 0; i < placed.size(); i++) {
+                used[placed[i]] = true;
+                keys[placed[i]] = packCode(source.airportCode(buckets[b][i]));
+                leaves[placed[i]] = buckets[b][i];
+            }
+            break;
+        }
+    }
+}
+
+AirportRecords PerfectHashIndex::find(string_view code) const {
+    if (keys.empty() || code.empty() || code.size() > 4) {
+        return AirportRecords();
+    }
+    uint32_t key = packCode(code);
+    uint32_t seed = seeds[hash(key, 0) % seeds.size()];
+    size_t slot = hash(key, seed) % keys.size();
+    if (keys[slot] != key) {
+        return AirportRecords();
+    }
+    return trie->airport(leaves[slot]);
+}
+
+size_t PerfectHashIndex::memoryUsage() const {
+    return (seeds.capacity() + keys.capacity() + leaves.capacity()) * sizeof(uint32_t);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "AirportData.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// All rows of one airport, a span inside a shared record array
+struct AirportRecords {
+    const AirportData* rows = nullptr;
+    size_t count = 0;
+
+    bool empty() const { return count == 0; }
+    const AirportData* begin() const { return rows; }
+    const AirportData* end() const { return rows + count; }
+    const AirportData& operator[](size_t i) const { return rows[i]; }
+};
+
+// Lookup on the original trie, same interface as the structures below
+AirportRecords findTrie(TrieNode* root, std::string_view code);
+
+// Trie whose nodes live in one array with a fixed 36-way child table (A-Z, 0-9)
+// Leaves hold an index into `airports`, which points into one shared record array
+class CompactTrie {
+public:
+    static const int FANOUT = 36;
+    struct Node {
+        int32_t child[FANOUT]; // Node index, -1 when there is no child
+        int32_t leaf;          // Index into airports, -1 when no code ends here
+    };
+
+    CompactTrie() = default;
+    // Rows are copied once, grouped by airport code in sorted order
+    explicit CompactTrie(const std::unordered_map<std::string, std::vector<AirportData>>& airports);
+    // Same, from the (code, rows) list traverseTrie collects
+    explicit CompactTrie(const std::vector<std::pair<std::string, std::vector<AirportData>>>& airports);
+
+    AirportRecords find(std::string_view code) const;
+    // Airport spans in code order; leaf indices refer to this list
+    size_t airportCount() const { return spans.size(); }
+    AirportRecords airport(size_t leaf) const;
+    const std::string& airportCode(size_t leaf) const { return codes[leaf]; }
+    size_t nodeCount() const { return nodes.size(); }
+    size_t memoryUsage() const;
+
+private:
+    static int slot(char c);
+    int32_t newNode();
+    void build(std::vector<std::pair<const std::string*, const std::vector<AirportData>*>>& airports);
+
+    struct Span {
+        uint32_t begin;
+        uint32_t count;
+    };
+    std::vector<Node> nodes;
+    std::vector<Span> spans;
+    std::vector<std::string> codes;
+    std::vector<AirportData> records;
+};
+
+// Build-once, read-only index from airport code to the CompactTrie's airports,
+// keyed by a minimal perfect hash of the packed codes (hash and displace)
+// The trie it was built from must outlive it
+class PerfectHashIndex {
+public:
+    PerfectHashIndex() = default;
+    explicit PerfectHashIndex(const CompactTrie& trie);
+
+    AirportRecords find(std::string_view code) const;
+    size_t memoryUsage() const;
+
+private:
+    static uint32_t hash(uint32_t key, uint32_t seed);
+
+    const CompactTrie* trie = nullptr;
+    std::vector<uint32_t> seeds; // Displacement seed per bucket
+    std::vector<uint32_t> keys;  // Packed code in every slot, to reject unknown codes
+    std::vector<uint32_t> leaves;
+};
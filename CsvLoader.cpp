@@ -0,0 +1,192 @@
+#include "CsvLoader.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <charconv>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile(const string& filename) {
+    METRICS_TIMER(timer, STAGE_READ);
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = static_cast<const char*>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping stays valid after the descriptor is closed
+    if (view == MAP_FAILED) {
+        return;
+    }
+    madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+    data = static_cast<const char*>(view);
+    size = static_cast<size_t>(info.st_size);
+#endif
+    METRICS_ITEMS(timer, size);
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        swap(data, other.data);
+        swap(size, other.size);
+#ifdef _WIN32
+        swap(fileHandle, other.fileHandle);
+        swap(mappingHandle, other.mappingHandle);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::close() {
+    if (data == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(mappingHandle);
+    CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    munmap(const_cast<char*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+// Same quoting rules as the old splitLine: a comma inside quotes is not a delimiter
+// and \" does not close the quotes. Since nothing is copied the surrounding quotes are
+// trimmed from the view instead of being skipped character by character.
+// https://stackoverflow.com/questions/1120140/how-can-i-read-and-parse-csv-files-in-c/53845961
+void splitLineView(string_view line, CsvRow& row, size_t maxColumns) {
+    row.count = 0;
+    maxColumns = min(maxColumns, CSV_MAX_COLUMNS);
+    size_t start = 0;
+    bool quoted = false;
+    char prev = '\0'; // Previous character to detect quote escaping
+    for (size_t i = 0; i < line.size() && row.count < maxColumns; i++) {
+        char c = line[i];
+        if (c == '\"') {
+            if (prev != '\\') {
+                quoted = !quoted;
+            }
+        }
+        else if (c == ',' && !quoted) {
+            row.columns[row.count++] = line.substr(start, i - start);
+            start = i + 1;
+        }
+        prev = c;
+    }
+    if (row.count < maxColumns) {
+        row.columns[row.count++] = line.substr(start);
+    }
+    for (size_t i = 0; i < row.count; i++) {
+        string_view& column = row.columns[i];
+        if (column.size() >= 2 && column.front() == '\"' && column.back() == '\"') {
+            column = column.substr(1, column.size() - 2);
+        }
+    }
+}
+
+string_view AirportName(string_view fullName) {
+    size_t pos = fullName.find(": ");
+    if (pos != string_view::npos && pos + 2 < fullName.size()) {
+        return fullName.substr(pos + 2);
+    }
+    return fullName;
+}
+
+size_t countLines(string_view contents) {
+    size_t lines = 0;
+    const char* current = contents.data();
+    const char* end = current + contents.size();
+    while (current < end) {
+        const char* newline = static_cast<const char*>(memchr(current, '\n', end - current));
+        lines++;
+        if (newline == nullptr) {
+            break;
+        }
+        current = newline + 1;
+    }
+    return lines;
+}
+
+vector<string_view> splitChunks(string_view contents, size_t parts) {
+    METRICS_TIMER(timer, STAGE_SPLIT);
+    vector<string_view> chunks;
+    if (parts == 0) {
+        parts = 1;
+    }
+    size_t start = 0;
+    for (size_t k = 1; k <= parts && start < contents.size(); k++) {
+        size_t end = contents.size();
+        if (k < parts) {
+            end = max(start, contents.size() / parts * k);
+            size_t newline = contents.find('\n', end);
+            end = newline == string_view::npos ? contents.size() : newline + 1;
+        }
+        chunks.push_back(contents.substr(start, end - start));
+        start = end;
+    }
+    METRICS_ITEMS(timer, chunks.size());
+    return chunks;
+}
+
+int parseInt(string_view column) {
+    int value = 0;
+    from_chars(column.data(), column.data() + column.size(), value);
+    return value;
+}
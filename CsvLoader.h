@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// Read-only memory mapping of a whole file
+// contents() is empty if the file could not be opened (same as a failed ifstream)
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return data != nullptr; }
+    std::string_view contents() const { return std::string_view(data, size); }
+
+private:
+    void close();
+
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// One CSV row split in place, every column is a view into the mapped file
+const size_t CSV_MAX_COLUMNS = 32;
+struct CsvRow {
+    std::string_view columns[CSV_MAX_COLUMNS];
+    size_t count = 0;
+    // Columns past the end of the row read as empty
+    std::string_view operator[](size_t i) const { return i < count ? columns[i] : std::string_view(); }
+};
+
+// Column positions in airlines.csv
+enum CsvColumn {
+    COL_CODE = 0,
+    COL_NAME = 1,
+    COL_LABEL = 2,
+    COL_MONTH = 3,
+    COL_MONTH_NAME = 4,
+    COL_YEAR = 5,
+    COL_DELAYS_CARRIER = 6,
+    COL_DELAYS_LATE = 7,
+    COL_DELAYS_NAVIS = 8,
+    COL_DELAYS_SECURITY = 9,
+    COL_DELAYS_WEATHER = 10,
+    COL_CARRIERS_TOTAL = 11,
+    COL_CANCELED = 12,
+    COL_DELAYED = 13,
+    COL_DIVERTED = 14,
+    COL_ON_TIME = 15,
+    COL_TOTAL_FLIGHTS = 16,
+    COL_MINUTES_CARRIER = 17,
+    COL_MINUTES_LATE = 18,
+    COL_MINUTES_NAVIS = 19,
+    COL_MINUTES_SECURITY = 20,
+    COL_MINUTES_TOTAL = 21,
+    COL_MINUTES_WEATHER = 22,
+    CSV_COLUMN_COUNT
+};
+
+// Function to split a CSV line without copying, quotes around a column are dropped
+// Scanning stops after maxColumns columns, the rest of the line is never looked at
+void splitLineView(std::string_view line, CsvRow& row, size_t maxColumns = CSV_MAX_COLUMNS);
+
+// Function to parse an integer column without allocating, empty or bad input gives 0
+int parseInt(std::string_view column);
+
+// Function to extract airport name from "City, ST: Name" without copying
+std::string_view AirportName(std::string_view fullName);
+
+// Number of lines in the text (an upper bound for the number of rows)
+size_t countLines(std::string_view contents);
+
+// Splits the text into at most `parts` pieces, each one starting right after a newline
+std::vector<std::string_view> splitChunks(std::string_view contents, size_t parts);
+
+// Calls onRow(const CsvRow&) for every data row, the header line is skipped unless
+// skipHeader is false (chunks after the first one from splitChunks)
+// Only the first maxColumns columns of each row are split
+// Handles both \n and \r\n line endings, blank lines are ignored
+template <typename Callback>
+void forEachCsvRow(std::string_view contents, Callback&& onRow, bool skipHeader = true,
+                   size_t maxColumns = CSV_MAX_COLUMNS) {
+    CsvRow row;
+    bool header = skipHeader;
+    while (!contents.empty()) {
+        const char* end = static_cast<const char*>(memchr(contents.data(), '\n', contents.size()));
+        size_t length = end ? static_cast<size_t>(end - contents.data()) : contents.size();
+        std::string_view line = contents.substr(0, length);
+        contents.remove_prefix(end ? length + 1 : length);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (header) {
+            header = false;
+            continue;
+        }
+        if (line.empty()) {
+            continue;
+        }
+        splitLineView(line, row, maxColumns);
+        onRow(static_cast<const CsvRow&>(row));
+    }
+}
@@ -0,0 +1,47 @@
+#include "Dataset.h"
+#include "GzipReader.h"
+#include "ParallelLoader.h"
+#include "PipelinedLoader.h"
+#include "RouteStore.h"
+
+using namespace std;
+
+AirportTable loadAirportTable(const string& csvFile, unsigned threads, uint32_t projection, bool pipelined,
+                              string& error) {
+    error.clear();
+    bool compressed = isGzipFile(csvFile);
+    if (isRouteFeed(csvFile)) {
+        RouteTable routes;
+        bool loaded = pipelined || compressed ? buildRouteTablePipelined(csvFile, error, projection, routes)
+                                              : buildRouteTableParallel(csvFile, threads, projection, routes, error);
+        return loaded ? rollUpAirportMonths(routes, threads) : AirportTable();
+    }
+    if (pipelined || compressed) {
+        return buildAirportTablePipelined(csvFile, error, projection);
+    }
+    return buildAirportTableParallel(csvFile, threads, projection);
+}
+
+unique_ptr<Dataset> loadDataset(const string& csvFile, const string& snapshotFile, unsigned threads, string& error,
+                                uint32_t projection, bool pipelined) {
+    unique_ptr<Dataset> dataset(new Dataset());
+    if (!snapshotFile.empty()) {
+        if (!dataset->snapshot.open(snapshotFile, false, error)) {
+            return nullptr;
+        }
+        dataset->table = dataset->snapshot.view();
+        dataset->cube = dataset->snapshot.cube();
+        dataset->source = snapshotFile;
+        return dataset;
+    }
+    else {
+        dataset->owned = loadAirportTable(csvFile, threads, projection, pipelined, error);
+        if (!error.empty()) {
+            return nullptr;
+        }
+        dataset->table = dataset->owned.view();
+        dataset->source = csvFile;
+    }
+    dataset->cube = AggregateCube(dataset->table);
+    return dataset;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "AggregateCube.h"
+#include "ColumnStore.h"
+#include "Snapshot.h"
+
+#include <memory>
+#include <string>
+
+// Everything a run needs to answer queries: the columns and the cube, built from a CSV
+// or mapped from a snapshot. `table` (and a mapped cube) point into one of the two
+// owners, so a Dataset is never copied or moved, only handed around by pointer
+struct Dataset {
+    AirportTable owned;
+    Snapshot snapshot;
+    TableView table;
+    AggregateCube cube;
+    std::string source; // File the columns came from
+
+    Dataset() = default;
+    Dataset(const Dataset&) = delete;
+    Dataset& operator=(const Dataset&) = delete;
+};
+
+// Parses the projected columns of csvFile on `threads` workers
+// A gzip-compressed csvFile, or any csvFile when `pipelined` is set, goes through the
+// pipelined loader instead of being mapped; a route feed (see RouteStore.h) is loaded and
+// rolled up to airport months
+// `error` is set (and the table empty) when the file cannot be read or parsed
+AirportTable loadAirportTable(const std::string& csvFile, unsigned threads, uint32_t projection, bool pipelined,
+                              std::string& error);
+
+// Maps snapshotFile when it is set, otherwise loads csvFile with loadAirportTable; a
+// snapshot always has every column
+// Returns nullptr (with a message) when the snapshot or the compressed file cannot be used
+std::unique_ptr<Dataset> loadDataset(const std::string& csvFile, const std::string& snapshotFile, unsigned threads,
+                                     std::string& error, uint32_t projection = ALL_COUNTERS, bool pipelined = false);
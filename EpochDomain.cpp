@@ -0,0 +1,70 @@
+#include "EpochDomain.h"
+
+using namespace std;
+
+// Every atomic here is sequentially consistent: a reader publishes its epoch before it
+// loads the shared pointer, a writer swaps the pointer before it advances the epoch and
+// scans the slots, so a reader the scan misses is guaranteed to load the new pointer
+
+EpochDomain::~EpochDomain() {
+    for (const Retired& entry : retired) {
+        entry.destroy(entry.object);
+    }
+}
+
+int EpochDomain::registerReader() {
+    for (int i = 0; i < MAX_READERS; i++) {
+        bool expected = false;
+        if (slots[i].used.compare_exchange_strong(expected, true)) {
+            slots[i].active.store(0);
+            return i;
+        }
+    }
+    return -1;
+}
+
+void EpochDomain::unregisterReader(int slot) {
+    slots[slot].active.store(0);
+    slots[slot].used.store(false);
+}
+
+void EpochDomain::retire(void* object, void (*destroy)(void*)) {
+    uint64_t retiredAt = epoch.fetch_add(1) + 1;
+    lock_guard<mutex> lock(retiredLock);
+    retired.push_back(Retired{ object, destroy, retiredAt });
+}
+
+size_t EpochDomain::reclaim() {
+    // Readers that entered at or after an object's retire epoch never saw it
+    uint64_t oldest = UINT64_MAX;
+    for (const Slot& slot : slots) {
+        uint64_t active = slot.active.load();
+        if (active != 0 && active < oldest) {
+            oldest = active;
+        }
+    }
+    vector<Retired> ready;
+    {
+        lock_guard<mutex> lock(retiredLock);
+        auto keep = retired.begin();
+        for (const Retired& entry : retired) {
+            if (entry.epoch <= oldest) {
+                ready.push_back(entry);
+            }
+            else {
+                *keep++ = entry;
+            }
+        }
+        retired.erase(keep, retired.end());
+    }
+    for (const Retired& entry : ready) {
+        entry.destroy(entry.object);
+    }
+    reclaimedCount += ready.size();
+    return ready.size();
+}
+
+size_t EpochDomain::pending() const {
+    lock_guard<mutex> lock(retiredLock);
+    return retired.size();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Epoch-based reclamation for objects readers reach through an atomic pointer
+// Readers mark the epoch they entered in their own slot (no locks, no shared writes);
+// a writer unlinks an object, retires it, and it is deleted once every reader that
+// could still hold it has left
+class EpochDomain {
+public:
+    static const int MAX_READERS = 256;
+
+    EpochDomain() = default;
+    ~EpochDomain();
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    // A slot per reader thread, -1 when all are taken
+    int registerReader();
+    void unregisterReader(int slot);
+
+    void enter(int slot) { slots[slot].active.store(epoch.load()); }
+    void leave(int slot) { slots[slot].active.store(0); }
+
+    // Called by a writer after unlinking `object`; `destroy` runs when it is safe
+    void retire(void* object, void (*destroy)(void*));
+    // Deletes what no reader can see any more, returns how many objects went
+    size_t reclaim();
+    size_t pending() const;
+    size_t reclaimed() const { return reclaimedCount.load(); }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> active{ 0 }; // Epoch entered, 0 while outside a read section
+        std::atomic<bool> used{ false };
+    };
+    struct Retired {
+        void* object;
+        void (*destroy)(void*);
+        uint64_t epoch;
+    };
+
+    Slot slots[MAX_READERS];
+    std::atomic<uint64_t> epoch{ 1 };
+    mutable std::mutex retiredLock; // Writers only
+    std::vector<Retired> retired;
+    std::atomic<size_t> reclaimedCount{ 0 };
+};
+
+// Read-side section: the objects loaded inside it stay alive until it ends
+class EpochGuard {
+public:
+    EpochGuard(EpochDomain& domain, int slot) : domain(domain), slot(slot) { domain.enter(slot); }
+    ~EpochGuard() { domain.leave(slot); }
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+
+private:
+    EpochDomain& domain;
+    int slot;
+};
@@ -0,0 +1,104 @@
+#include "FlatIndex.h"
+#include "Metrics.h"
+
+#include <algorithm>
+
+using namespace std;
+
+void FlatAirportIndex::allocate(size_t airports) {
+    // Power of two with at least twice as many slots as airports
+    size_t size = 8;
+    shift = 29;
+    while (size < airports * 2) {
+        size *= 2;
+        shift--;
+    }
+    slots.assign(size, Slot{ 0, 0, 0 });
+}
+
+void FlatAirportIndex::insert(uint32_t key, uint32_t begin, uint32_t count) {
+    Slot entry{ key, begin, count };
+    size_t mask = slots.size() - 1;
+    size_t pos = home(key);
+    for (size_t distance = 0;; distance++, pos = (pos + 1) & mask) {
+        Slot& slot = slots[pos];
+        if (slot.key == 0) {
+            slot = entry;
+            return;
+        }
+        // Robin Hood: the entry further from home takes the slot, the other one moves on
+        size_t existing = (pos - home(slot.key)) & mask;
+        if (existing < distance) {
+            swap(slot, entry);
+            distance = existing;
+        }
+    }
+}
+
+FlatAirportIndex::FlatAirportIndex(vector<pair<string, vector<AirportData>>>&& airports) {
+    size_t rows = 0;
+    for (const auto& airport : airports) {
+        rows += airport.second.size();
+    }
+    allocate(airports.size());
+    records.reserve(rows);
+    for (auto& airport : airports) {
+        if (airport.first.empty() || airport.first.size() > 4) {
+            continue;
+        }
+        uint32_t begin = static_cast<uint32_t>(records.size());
+        records.insert(records.end(), make_move_iterator(airport.second.begin()), make_move_iterator(airport.second.end()));
+        insert(packCode(airport.first), begin, static_cast<uint32_t>(airport.second.size()));
+        codes.push_back(move(airport.first));
+    }
+    airports.clear();
+}
+
+FlatAirportIndex::FlatAirportIndex(const TableView& table) {
+    METRICS_TIMER(timer, STAGE_INSERT);
+    METRICS_ITEMS(timer, table.rows);
+    // Counting sort by airport id: count, turn the counts into span starts, then place the rows
+    vector<uint32_t> starts(table.airports + 1, 0);
+    for (size_t i = 0; i < table.rows; i++) {
+        starts[table.airport[i] + 1]++;
+    }
+    for (size_t a = 0; a < table.airports; a++) {
+        starts[a + 1] += starts[a];
+    }
+    vector<uint32_t> next(starts.begin(), starts.end() - 1);
+    records.resize(table.rows);
+    for (size_t i = 0; i < table.rows; i++) {
+        GetAirportInfo(records[next[table.airport[i]]++], table, i);
+    }
+    allocate(table.airports);
+    for (uint32_t a = 0; a < table.airports; a++) {
+        string code = table.airportCode(a);
+        if (code.empty() || starts[a + 1] == starts[a]) {
+            continue;
+        }
+        insert(table.codes[a], starts[a], starts[a + 1] - starts[a]);
+        codes.push_back(move(code));
+    }
+}
+
+AirportRecords FlatAirportIndex::find(string_view code) const {
+    if (slots.empty() || code.empty() || code.size() > 4) {
+        return AirportRecords();
+    }
+    uint32_t key = packCode(code);
+    size_t mask = slots.size() - 1;
+    size_t pos = home(key);
+    for (size_t distance = 0;; distance++, pos = (pos + 1) & mask) {
+        const Slot& slot = slots[pos];
+        if (slot.key == key) {
+            return AirportRecords{ records.data() + slot.begin, slot.count };
+        }
+        if (slot.key == 0 || ((pos - home(slot.key)) & mask) < distance) {
+            return AirportRecords();
+        }
+    }
+}
+
+size_t FlatAirportIndex::memoryUsage() const {
+    return slots.capacity() * sizeof(Slot) + records.capacity() * sizeof(AirportData) + codes.capacity() * sizeof(string);
+}
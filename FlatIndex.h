@@ -0,0 +1,48 @@
+#pragma once
+
+#include "AirportData.h"
+#include "ColumnStore.h"
+#include "CompactTrie.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Open-addressing (Robin Hood, linear probing) index keyed by the packed airport code
+// A slot holds the key and the airport's span of one shared record array, so a hit is
+// one probe into a flat array plus the records themselves; no string is hashed and no
+// pointer is chased. The table stays at most half full, and a probe stops as soon as it
+// meets a key that is closer to its home slot than the one looked for
+// Read-only once built; codes longer than 4 characters are skipped
+class FlatAirportIndex {
+public:
+    FlatAirportIndex() = default;
+    // Rows are moved in, airports in the order given
+    explicit FlatAirportIndex(std::vector<std::pair<std::string, std::vector<AirportData>>>&& airports);
+    // Rows grouped by airport id straight from loaded columns
+    explicit FlatAirportIndex(const TableView& table);
+
+    AirportRecords find(std::string_view code) const;
+    size_t airportCount() const { return codes.size(); }
+    const std::string& airportCode(size_t i) const { return codes[i]; }
+    size_t slotCount() const { return slots.size(); }
+    size_t memoryUsage() const;
+
+private:
+    struct Slot {
+        uint32_t key;   // Packed code, 0 when the slot is empty
+        uint32_t begin; // Span in records
+        uint32_t count;
+    };
+
+    size_t home(uint32_t key) const { return static_cast<size_t>((key * 0x9E3779B9u) >> shift); }
+    void allocate(size_t airports);
+    void insert(uint32_t key, uint32_t begin, uint32_t count);
+
+    std::vector<Slot> slots;
+    unsigned shift = 32;
+    std::vector<AirportData> records;
+    std::vector<std::string> codes;
+};
@@ -0,0 +1,262 @@
+#include "Generator.h"
+#include "ColumnStore.h"
+#include "RouteStore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+static const char* const CSV_HEADER =
+    "Airport.Code,Airport.Name,Time.Label,Time.Month,Time.Month Name,Time.Year,Statistics.# of Delays.Carrier,"
+    "Statistics.# of Delays.Late Aircraft,Statistics.# of Delays.National Aviation System,"
+    "Statistics.# of Delays.Security,Statistics.# of Delays.Weather,Statistics.Carriers.Total,"
+    "Statistics.Flights.Cancelled,Statistics.Flights.Delayed,Statistics.Flights.Diverted,Statistics.Flights.On Time,"
+    "Statistics.Flights.Total,Statistics.Minutes Delayed.Carrier,Statistics.Minutes Delayed.Late Aircraft,"
+    "Statistics.Minutes Delayed.National Aviation System,Statistics.Minutes Delayed.Security,"
+    "Statistics.Minutes Delayed.Total,Statistics.Minutes Delayed.Weather\n";
+
+static const char* const SYLLABLES[] = { "an", "bel", "cor", "dan", "el", "fair", "glen", "har", "is", "jas",
+                                         "ken", "lin", "mar", "nor", "or", "port", "quin", "ros", "san", "ter",
+                                         "ul", "val", "west", "york" };
+static const char* const STATES[] = { "AL", "AZ", "CA", "CO", "FL", "GA", "IL", "MA", "MI", "MN", "NC", "NJ",
+                                      "NV", "NY", "OR", "PA", "TN", "TX", "UT", "VA", "WA" };
+static const size_t SYLLABLE_COUNT = sizeof(SYLLABLES) / sizeof(SYLLABLES[0]);
+static const size_t STATE_COUNT = sizeof(STATES) / sizeof(STATES[0]);
+
+// Average minutes per delay of each cause, in the order of the CSV columns
+static const double MINUTES_PER_DELAY[5] = { 65.0, 70.0, 45.0, 30.0, 80.0 };
+
+// Per-airport constants drawn once, so an airport keeps its character across the years
+struct SyntheticAirport {
+    string code;
+    string name; // "City, ST: Name", quoted when written
+    double flights;       // Monthly flights in the first year
+    double delayRate;
+    double cancelRate;
+    double causeWeights[5]; // Carrier, late aircraft, NAS, security, weather
+    int carriers;
+};
+
+size_t generatedRowCount(const GeneratorConfig& config) {
+    return config.airports * static_cast<size_t>(max(0, config.years)) * 12;
+}
+
+string generatedAirportCode(size_t index) {
+    static const char* const LETTERS = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    static const char* const ALPHANUMERIC = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    if (index < 26 * 26 * 26) {
+        return { LETTERS[index / 676], LETTERS[index / 26 % 26], LETTERS[index % 26] };
+    }
+    index -= 26 * 26 * 26;
+    return { LETTERS[index / (36 * 36 * 36) % 26], ALPHANUMERIC[index / (36 * 36) % 36], ALPHANUMERIC[index / 36 % 36],
+             ALPHANUMERIC[index % 36] };
+}
+
+static string syntheticName(mt19937_64& rng) {
+    string city;
+    int syllables = 2 + static_cast<int>(rng() % 2);
+    for (int s = 0; s < syllables; s++) {
+        city += SYLLABLES[rng() % SYLLABLE_COUNT];
+    }
+    city[0] = static_cast<char>(toupper(city[0]));
+    static const char* const KINDS[] = { "International", "Regional", "Municipal", "Field" };
+    return city + ", " + STATES[rng() % STATE_COUNT] + ": " + city + " " + KINDS[rng() % 4];
+}
+
+static vector<SyntheticAirport> syntheticAirports(const GeneratorConfig& config, mt19937_64& rng) {
+    vector<SyntheticAirport> airports(config.airports);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    // Traffic rank is shuffled against the code order so hubs are spread over the alphabet
+    vector<size_t> rank(config.airports);
+    for (size_t i = 0; i < rank.size(); i++) {
+        rank[i] = i;
+    }
+    shuffle(rank.begin(), rank.end(), rng);
+    for (size_t i = 0; i < airports.size(); i++) {
+        SyntheticAirport& airport = airports[i];
+        airport.code = generatedAirportCode(i);
+        airport.name = syntheticName(rng);
+        airport.flights = max(30.0, 40000.0 / pow(static_cast<double>(rank[i] + 1), config.skew));
+        airport.delayRate = 0.10 + 0.20 * unit(rng);
+        airport.cancelRate = 0.005 + 0.025 * unit(rng);
+        double base[5] = { 0.30, 0.35, 0.28, 0.002, 0.05 };
+        for (int c = 0; c < 5; c++) {
+            airport.causeWeights[c] = base[c] * (0.6 + 0.8 * unit(rng));
+        }
+        airport.carriers = 3 + static_cast<int>(rng() % 18);
+    }
+    return airports;
+}
+
+size_t generateDataset(const GeneratorConfig& config, BufferedWriter& out) {
+    mt19937_64 rng(config.seed);
+    uniform_real_distribution<double> noise(0.9, 1.1);
+    vector<SyntheticAirport> airports = syntheticAirports(config, rng);
+
+    out.write(CSV_HEADER);
+    size_t rows = 0;
+    for (int y = 0; y < config.years; y++) {
+        int year = config.firstYear + y;
+        double growth = 1.0 + 0.02 * y;
+        for (int month = 1; month <= 12; month++) {
+            // Summer and December peaks in traffic and delays, winter weather cancellations
+            double season = 1.0 + 0.1 * sin((month - 4) * 3.14159265358979 / 6.0);
+            double delayPeak = month == 6 || month == 7 || month == 12 ? 1.25 : 1.0;
+            double winter = month == 1 || month == 2 || month == 12 ? 1.8 : 1.0;
+            char label[8] = { static_cast<char>('0' + year / 1000 % 10), static_cast<char>('0' + year / 100 % 10),
+                              static_cast<char>('0' + year / 10 % 10), static_cast<char>('0' + year % 10), '/',
+                              static_cast<char>('0' + month / 10), static_cast<char>('0' + month % 10), '\0' };
+            for (const SyntheticAirport& airport : airports) {
+                long long total = static_cast<long long>(airport.flights * growth * season * noise(rng));
+                long long delayed = static_cast<long long>(total * min(0.9, airport.delayRate * delayPeak * noise(rng)));
+                long long canceled = static_cast<long long>(total * min(0.5, airport.cancelRate * winter * noise(rng)));
+                long long diverted = static_cast<long long>(total * 0.002 * noise(rng));
+                long long onTime = max(0LL, total - delayed - canceled - diverted);
+
+                double weightSum = 0.0;
+                double weights[5];
+                for (int c = 0; c < 5; c++) {
+                    weights[c] = airport.causeWeights[c] * noise(rng);
+                    weightSum += weights[c];
+                }
+                long long causes[5];
+                long long minutes[5];
+                long long totalMinutes = 0;
+                for (int c = 0; c < 5; c++) {
+                    causes[c] = static_cast<long long>(delayed * weights[c] / weightSum);
+                    minutes[c] = static_cast<long long>(causes[c] * MINUTES_PER_DELAY[c] * noise(rng));
+                    totalMinutes += minutes[c];
+                }
+
+                out.write(airport.code).write(",\"").write(airport.name).write("\",").write(label).write(',');
+                out.write(static_cast<long long>(month)).write(',').write(monthName(month)).write(',');
+                out.write(static_cast<long long>(year));
+                for (int c = 0; c < 5; c++) {
+                    out.write(',').write(causes[c]);
+                }
+                out.write(',').write(static_cast<long long>(airport.carriers));
+                out.write(',').write(canceled).write(',').write(delayed).write(',').write(diverted);
+                out.write(',').write(onTime).write(',').write(total);
+                // Minutes columns: carrier, late aircraft, NAS, security, total, weather
+                for (int c = 0; c < 4; c++) {
+                    out.write(',').write(minutes[c]);
+                }
+                out.write(',').write(totalMinutes).write(',').write(minutes[4]).write('\n');
+                rows++;
+            }
+        }
+    }
+    out.flush();
+    return rows;
+}
+
+string generatedCarrierCode(size_t index) {
+    static const char* const LETTERS = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    if (index < 26 * 26) {
+        return { LETTERS[index / 26], LETTERS[index % 26] };
+    }
+    index -= 26 * 26;
+    return { LETTERS[index / 676 % 26], LETTERS[index / 26 % 26], LETTERS[index % 26] };
+}
+
+// One carrier on one route: its share of the origin's traffic
+struct SyntheticRoute {
+    size_t origin;
+    size_t dest;
+    string carrier;
+    double dailyFlights;
+};
+
+static vector<SyntheticRoute> syntheticRoutes(const RouteGeneratorConfig& config, const vector<SyntheticAirport>& airports,
+                                              mt19937_64& rng) {
+    vector<double> traffic(airports.size());
+    for (size_t a = 0; a < airports.size(); a++) {
+        traffic[a] = airports[a].flights;
+    }
+    size_t destinations = min(config.routes, airports.size() - 1);
+    vector<SyntheticRoute> routes;
+    for (size_t origin = 0; origin < airports.size(); origin++) {
+        // Destinations drawn by their traffic, without the origin or repeats
+        vector<double> weights = traffic;
+        weights[origin] = 0.0;
+        double routeFlights = airports[origin].flights / 30.0 / max<size_t>(1, destinations);
+        for (size_t r = 0; r < destinations; r++) {
+            discrete_distribution<size_t> pick(weights.begin(), weights.end());
+            size_t dest = pick(rng);
+            weights[dest] = 0.0;
+            size_t carriers = min<size_t>(config.carriers, 1 + rng() % 3);
+            size_t first = rng() % config.carriers;
+            for (size_t c = 0; c < carriers; c++) {
+                routes.push_back({ origin, dest, generatedCarrierCode((first + c) % config.carriers),
+                                   routeFlights / carriers });
+            }
+        }
+    }
+    return routes;
+}
+
+size_t generateRouteDataset(const RouteGeneratorConfig& config, BufferedWriter& out) {
+    mt19937_64 rng(config.seed);
+    GeneratorConfig airportConfig;
+    airportConfig.airports = config.airports;
+    airportConfig.skew = config.skew;
+    vector<SyntheticAirport> airports = syntheticAirports(airportConfig, rng);
+    vector<SyntheticRoute> routes =
+        config.airports < 2 || config.carriers == 0 ? vector<SyntheticRoute>() : syntheticRoutes(config, airports, rng);
+    uniform_real_distribution<double> noise(0.9, 1.1);
+
+    out.write(routeCsvHeader()).write('\n');
+    size_t rows = 0;
+    uint16_t firstDay = dayNumber(config.firstYear, 1, 1);
+    for (int d = 0; d < config.days; d++) {
+        int year, month, day;
+        civilDate(static_cast<uint16_t>(firstDay + d), year, month, day);
+        char date[11] = { static_cast<char>('0' + year / 1000 % 10), static_cast<char>('0' + year / 100 % 10),
+                          static_cast<char>('0' + year / 10 % 10),   static_cast<char>('0' + year % 10),
+                          '-', static_cast<char>('0' + month / 10),  static_cast<char>('0' + month % 10),
+                          '-', static_cast<char>('0' + day / 10),    static_cast<char>('0' + day % 10), '\0' };
+        double delayPeak = month == 6 || month == 7 || month == 12 ? 1.25 : 1.0;
+        double winter = month == 1 || month == 2 || month == 12 ? 1.8 : 1.0;
+        double growth = 1.0 + 0.02 * (year - config.firstYear);
+        for (const SyntheticRoute& route : routes) {
+            const SyntheticAirport& origin = airports[route.origin];
+            const SyntheticAirport& dest = airports[route.dest];
+            long long total = max(1LL, static_cast<long long>(route.dailyFlights * growth * noise(rng) + 0.5));
+            // Delays and cancellations follow the arrival airport, like the airport-month data
+            binomial_distribution<long long> delays(total, min(0.9, dest.delayRate * delayPeak));
+            binomial_distribution<long long> cancels(total, min(0.5, dest.cancelRate * winter));
+            long long delayed = delays(rng);
+            long long canceled = min(total - delayed, cancels(rng));
+            long long diverted = min(total - delayed - canceled, static_cast<long long>(rng() % 500 == 0));
+            long long onTime = total - delayed - canceled - diverted;
+            discrete_distribution<int> cause(dest.causeWeights, dest.causeWeights + 5);
+            long long causes[5] = {};
+            long long minutes[5] = {};
+            for (long long f = 0; f < delayed; f++) {
+                int c = cause(rng);
+                causes[c]++;
+                minutes[c] += static_cast<long long>(MINUTES_PER_DELAY[c] * noise(rng));
+            }
+            long long totalMinutes = minutes[0] + minutes[1] + minutes[2] + minutes[3] + minutes[4];
+
+            out.write(date).write(',').write(route.carrier).write(',').write(origin.code).write(",\"");
+            out.write(origin.name).write("\",").write(dest.code).write(",\"").write(dest.name).write('"');
+            // Counter columns in CounterColumn order, without carriers_total
+            for (int c = 0; c < 5; c++) {
+                out.write(',').write(causes[c]);
+            }
+            out.write(',').write(canceled).write(',').write(delayed).write(',').write(total);
+            out.write(',').write(diverted).write(',').write(onTime);
+            for (int c = 0; c < 5; c++) {
+                out.write(',').write(minutes[c]);
+            }
+            out.write(',').write(totalMinutes).write('\n');
+            rows++;
+        }
+    }
+    out.flush();
+    return rows;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "BufferedWriter.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Shape of a synthetic dataset in the airlines.csv layout (same 23 columns)
+// Traffic per airport follows a Zipf curve, so a few hubs carry most flights the way
+// the real data does; every airport reports every month of every year
+struct GeneratorConfig {
+    size_t airports = 1000;
+    int firstYear = 1970;
+    int years = 50;
+    double skew = 1.0;     // Zipf exponent of the traffic per airport rank
+    uint64_t seed = 42;
+};
+
+size_t generatedRowCount(const GeneratorConfig& config);
+// Code of the index-th generated airport: AAA..ZZZ, then four characters (A-Z, 0-9)
+std::string generatedAirportCode(size_t index);
+
+// Writes header and rows in time order (every airport for a month, then the next month)
+// Returns the number of rows written
+size_t generateDataset(const GeneratorConfig& config, BufferedWriter& out);
+
+// Shape of a synthetic route feed (see RouteStore.h): every airport flies to `routes`
+// others picked by traffic, so hubs get most of the routes, each route is served by one
+// to three of the carriers, and every route and carrier reports every day
+struct RouteGeneratorConfig {
+    size_t airports = 300;
+    size_t carriers = 12;
+    size_t routes = 8; // Destinations per airport
+    int firstYear = 2015;
+    int days = 365;
+    double skew = 1.0;
+    uint64_t seed = 42;
+};
+
+// Code of the index-th generated carrier: AA, AB, ... then three characters
+std::string generatedCarrierCode(size_t index);
+
+// Writes header and rows in time order (every route and carrier for a day, then the next day)
+// Returns the number of rows written
+size_t generateRouteDataset(const RouteGeneratorConfig& config, BufferedWriter& out);
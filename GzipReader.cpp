@@ -0,0 +1,459 @@
+#include "GzipReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+using namespace std;
+
+static const uint16_t LENGTH_BASE[29] = { 3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                          31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t DISTANCE_BASE[30] = { 1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                            193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                            6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+// Order the code length code lengths are stored in
+static const uint8_t CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+static const size_t WINDOW_MASK = (1 << 15) - 1;
+
+static uint32_t updateCrc(uint32_t crc, const char* data, size_t size) {
+    static const struct CrcTable {
+        uint32_t entries[256];
+        CrcTable() {
+            for (uint32_t n = 0; n < 256; n++) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[n] = c;
+            }
+        }
+    } table;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table.entries[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+bool isGzipFile(const string& filename) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    unsigned char magic[2] = {};
+    size_t read = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+    return read == 2 && magic[0] == 0x1F && magic[1] == 0x8B;
+}
+
+bool readGzipFile(const string& filename, string& contents, string& error) {
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        error = "Cannot open " + filename;
+        return false;
+    }
+    unique_ptr<GzipReader> gzip(new GzipReader(file));
+    contents.clear();
+    size_t size = 0;
+    for (;;) {
+        contents.resize(size + (1 << 16));
+        size_t read = gzip->read(&contents[size], contents.size() - size);
+        if (read == 0) {
+            break;
+        }
+        size += read;
+    }
+    contents.resize(size);
+    fclose(file);
+    if (!gzip->error().empty()) {
+        error = filename + ": " + gzip->error();
+        return false;
+    }
+    return true;
+}
+
+GzipReader::GzipReader(FILE* input) : input(input) {}
+
+bool GzipReader::fillInput() {
+    if (inputEnded) {
+        return false;
+    }
+    inPosition = 0;
+    inLength = fread(inBuffer, 1, sizeof(inBuffer), input);
+    if (inLength == 0) {
+        inputEnded = true;
+        if (ferror(input)) {
+            failure = "Read error in gzip input";
+        }
+        return false;
+    }
+    return true;
+}
+
+// Past the end of the input zero bits are fed in, so a code can always be peeked at;
+// truncated() tells when one of them was actually consumed
+void GzipReader::need(int count) {
+    while (bitCount < count) {
+        if (inPosition < inLength || fillInput()) {
+            bitBuffer |= static_cast<uint64_t>(inBuffer[inPosition++]) << bitCount;
+        }
+        else {
+            padBits += 8;
+        }
+        bitCount += 8;
+    }
+}
+
+uint32_t GzipReader::bits(int count) {
+    need(count);
+    uint32_t value = static_cast<uint32_t>(bitBuffer & ((1ull << count) - 1));
+    bitBuffer >>= count;
+    bitCount -= count;
+    return value;
+}
+
+void GzipReader::alignToByte() {
+    bits(bitCount & 7);
+}
+
+bool GzipReader::atEnd() {
+    return bitCount == padBits && inPosition == inLength && !fillInput();
+}
+
+bool GzipReader::fail(const string& message) {
+    if (failure.empty()) {
+        failure = message;
+    }
+    state = FAILED;
+    return false;
+}
+
+bool GzipReader::buildHuffman(Huffman& code, const uint8_t* bitLengths, int symbols) {
+    memset(code.count, 0, sizeof(code.count));
+    memset(code.fast, 0, sizeof(code.fast));
+    for (int s = 0; s < symbols; s++) {
+        code.count[bitLengths[s]]++;
+    }
+    if (code.count[0] == symbols) {
+        return true; // No codes, only valid for distances of a block without matches
+    }
+    // Over-subscribed codes are invalid; incomplete ones are accepted and fail on a missing code
+    int left = 1;
+    for (int length = 1; length <= MAX_BITS; length++) {
+        left = (left << 1) - code.count[length];
+        if (left < 0) {
+            return false;
+        }
+    }
+    uint16_t offsets[MAX_BITS + 2];
+    offsets[1] = 0;
+    for (int length = 1; length <= MAX_BITS; length++) {
+        offsets[length + 1] = static_cast<uint16_t>(offsets[length] + code.count[length]);
+    }
+    for (int s = 0; s < symbols; s++) {
+        if (bitLengths[s] != 0) {
+            code.symbol[offsets[bitLengths[s]]++] = static_cast<uint16_t>(s);
+        }
+    }
+    // Codes are sent most significant bit first, the table is indexed by the bits as they arrive
+    uint32_t next = 0;
+    int index = 0;
+    for (int length = 1; length <= FAST_BITS; length++) {
+        for (int i = 0; i < code.count[length]; i++, index++, next++) {
+            uint32_t reversed = 0;
+            for (int b = 0; b < length; b++) {
+                reversed |= ((next >> b) & 1) << (length - 1 - b);
+            }
+            for (uint32_t slot = reversed; slot < (1u << FAST_BITS); slot += 1u << length) {
+                code.fast[slot] = static_cast<uint16_t>(length << 9 | code.symbol[index]);
+            }
+        }
+        next <<= 1;
+    }
+    return true;
+}
+
+int GzipReader::decode(const Huffman& code) {
+    need(FAST_BITS);
+    uint16_t entry = code.fast[bitBuffer & ((1u << FAST_BITS) - 1)];
+    if (entry != 0) {
+        bits(entry >> 9);
+        return entry & 511;
+    }
+    // Longer code, one bit at a time through the canonical ranges of each length
+    int value = 0;
+    int first = 0;
+    int index = 0;
+    for (int length = 1; length <= MAX_BITS; length++) {
+        value |= static_cast<int>(bits(1));
+        int count = code.count[length];
+        if (value - count < first) {
+            return code.symbol[index + (value - first)];
+        }
+        index += count;
+        first = (first + count) << 1;
+        value <<= 1;
+    }
+    return -1;
+}
+
+bool GzipReader::readMemberHeader() {
+    if (bits(8) != 0x1F || bits(8) != 0x8B) {
+        return fail(anyMember ? "Unexpected data after the gzip stream" : "Not a gzip stream");
+    }
+    if (bits(8) != 8) {
+        return fail("Unsupported gzip compression method");
+    }
+    uint32_t flags = bits(8);
+    if (flags & 0xE0) {
+        return fail("Reserved gzip header flags set");
+    }
+    bits(32); // Modification time
+    bits(16); // Extra flags and OS
+    if (flags & 4) {
+        for (uint32_t extra = bits(16); extra > 0 && !truncated(); extra--) {
+            bits(8);
+        }
+    }
+    for (uint32_t flag : { 8u, 16u }) { // File name, comment
+        if (flags & flag) {
+            while (bits(8) != 0 && !truncated()) {
+            }
+        }
+    }
+    if (flags & 2) {
+        bits(16); // Header CRC
+    }
+    if (truncated()) {
+        return fail("Truncated gzip header");
+    }
+    anyMember = true;
+    lastBlock = false;
+    written = 0;
+    crc = 0;
+    return true;
+}
+
+bool GzipReader::readBlockHeader() {
+    if (lastBlock) {
+        state = MEMBER_TRAILER;
+        return true;
+    }
+    lastBlock = bits(1) != 0;
+    switch (bits(2)) {
+    case 0: {
+        alignToByte();
+        uint32_t length = bits(16);
+        if (bits(16) != (~length & 0xFFFF)) {
+            return fail("Corrupt stored block in gzip stream");
+        }
+        storedLeft = length;
+        state = STORED;
+        return true;
+    }
+    case 1: {
+        static const struct FixedCodes {
+            Huffman lengths;
+            Huffman distances;
+            FixedCodes() {
+                uint8_t bitLengths[288];
+                fill(bitLengths, bitLengths + 144, 8);
+                fill(bitLengths + 144, bitLengths + 256, 9);
+                fill(bitLengths + 256, bitLengths + 280, 7);
+                fill(bitLengths + 280, bitLengths + 288, 8);
+                buildHuffman(lengths, bitLengths, 288);
+                fill(bitLengths, bitLengths + 30, 5);
+                buildHuffman(distances, bitLengths, 30);
+            }
+        } fixed;
+        lengths = fixed.lengths;
+        distances = fixed.distances;
+        state = CODES;
+        return true;
+    }
+    case 2:
+        if (!readDynamicTables()) {
+            return false;
+        }
+        state = CODES;
+        return true;
+    default:
+        return fail("Invalid block type in gzip stream");
+    }
+}
+
+bool GzipReader::readDynamicTables() {
+    int lengthCount = static_cast<int>(bits(5)) + 257;
+    int distanceCount = static_cast<int>(bits(5)) + 1;
+    int codeCount = static_cast<int>(bits(4)) + 4;
+    if (lengthCount > 286 || distanceCount > 30) {
+        return fail("Bad code counts in gzip stream");
+    }
+    uint8_t bitLengths[286 + 30] = {};
+    for (int i = 0; i < codeCount; i++) {
+        bitLengths[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(bits(3));
+    }
+    Huffman codeLengths;
+    if (!buildHuffman(codeLengths, bitLengths, 19)) {
+        return fail("Bad code length code in gzip stream");
+    }
+    int index = 0;
+    while (index < lengthCount + distanceCount) {
+        int symbol = decode(codeLengths);
+        if (symbol < 0 || truncated()) {
+            return fail("Bad code lengths in gzip stream");
+        }
+        if (symbol < 16) {
+            bitLengths[index++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+        uint8_t repeated = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (index == 0) {
+                return fail("Bad code lengths in gzip stream");
+            }
+            repeated = bitLengths[index - 1];
+            repeat = 3 + static_cast<int>(bits(2));
+        }
+        else if (symbol == 17) {
+            repeat = 3 + static_cast<int>(bits(3));
+        }
+        else {
+            repeat = 11 + static_cast<int>(bits(7));
+        }
+        if (index + repeat > lengthCount + distanceCount) {
+            return fail("Bad code lengths in gzip stream");
+        }
+        fill(bitLengths + index, bitLengths + index + repeat, repeated);
+        index += repeat;
+    }
+    if (bitLengths[256] == 0) {
+        return fail("Missing end of block code in gzip stream");
+    }
+    if (!buildHuffman(lengths, bitLengths, lengthCount) ||
+        !buildHuffman(distances, bitLengths + lengthCount, distanceCount)) {
+        return fail("Bad Huffman code in gzip stream");
+    }
+    return true;
+}
+
+bool GzipReader::readMemberTrailer() {
+    alignToByte();
+    uint32_t expectedCrc = bits(32);
+    uint32_t expectedSize = bits(32);
+    if (truncated()) {
+        return fail("Truncated gzip trailer");
+    }
+    if (expectedCrc != crc) {
+        return fail("CRC mismatch in gzip stream");
+    }
+    if (expectedSize != static_cast<uint32_t>(written)) {
+        return fail("Length mismatch in gzip stream");
+    }
+    state = MEMBER_HEADER;
+    return true;
+}
+
+size_t GzipReader::read(char* out, size_t capacity) {
+    size_t n = 0;
+    size_t unchecked = 0; // Start of the output not yet in the CRC
+    while (n < capacity && state != DONE && state != FAILED) {
+        switch (state) {
+        case MEMBER_HEADER:
+            if (anyMember && atEnd()) {
+                state = DONE;
+            }
+            else {
+                readMemberHeader();
+                state = state == FAILED ? FAILED : BLOCK_HEADER;
+            }
+            break;
+        case BLOCK_HEADER:
+            readBlockHeader();
+            break;
+        case STORED:
+            while (storedLeft > 0 && n < capacity) {
+                unsigned char byte;
+                if (bitCount >= 8) {
+                    byte = static_cast<unsigned char>(bits(8));
+                }
+                else if (inPosition < inLength || fillInput()) {
+                    byte = inBuffer[inPosition++];
+                }
+                else {
+                    fail("Truncated gzip stream");
+                    break;
+                }
+                window[written++ & WINDOW_MASK] = byte;
+                out[n++] = static_cast<char>(byte);
+                storedLeft--;
+            }
+            if (storedLeft == 0 && state == STORED) {
+                state = BLOCK_HEADER;
+            }
+            break;
+        case CODES:
+            while (n < capacity) {
+                if (copyLength > 0) {
+                    size_t run = min(static_cast<size_t>(copyLength), capacity - n);
+                    for (size_t i = 0; i < run; i++) {
+                        unsigned char byte = window[(written - copyDistance) & WINDOW_MASK];
+                        window[written++ & WINDOW_MASK] = byte;
+                        out[n++] = static_cast<char>(byte);
+                    }
+                    copyLength -= static_cast<int>(run);
+                    continue;
+                }
+                int symbol = decode(lengths);
+                if (symbol < 256) {
+                    if (symbol < 0) {
+                        fail("Bad literal/length code in gzip stream");
+                        break;
+                    }
+                    window[written++ & WINDOW_MASK] = static_cast<unsigned char>(symbol);
+                    out[n++] = static_cast<char>(symbol);
+                    continue;
+                }
+                if (symbol == 256) {
+                    state = BLOCK_HEADER;
+                    break;
+                }
+                symbol -= 257;
+                if (symbol >= 29) {
+                    fail("Bad length code in gzip stream");
+                    break;
+                }
+                copyLength = LENGTH_BASE[symbol] + static_cast<int>(bits(LENGTH_EXTRA[symbol]));
+                int distance = decode(distances);
+                if (distance < 0 || distance >= 30) {
+                    fail("Bad distance code in gzip stream");
+                    break;
+                }
+                copyDistance = DISTANCE_BASE[distance] + static_cast<int>(bits(DISTANCE_EXTRA[distance]));
+                if (static_cast<uint64_t>(copyDistance) > written) {
+                    fail("Distance too far back in gzip stream");
+                    break;
+                }
+                if (truncated()) {
+                    break;
+                }
+            }
+            break;
+        case MEMBER_TRAILER:
+            crc = updateCrc(crc, out + unchecked, n - unchecked);
+            unchecked = n;
+            readMemberTrailer();
+            break;
+        default:
+            break;
+        }
+        if (truncated()) {
+            fail("Truncated gzip stream");
+        }
+    }
+    crc = updateCrc(crc, out + unchecked, n - unchecked);
+    return n;
+}
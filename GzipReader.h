@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// True when the file starts with the gzip magic bytes
+bool isGzipFile(const std::string& filename);
+// Inflates a whole gzip file into memory, for inputs small enough to hold (monthly deltas)
+// Returns false with a message when it cannot be opened or is corrupt
+bool readGzipFile(const std::string& filename, std::string& contents, std::string& error);
+
+// Streaming gzip decoder with its own inflate (RFC 1951/1952), so no zlib is needed
+// Compressed bytes are pulled from the stream as needed; concatenated members read as one
+// stream, and every member's CRC-32 and length are checked
+class GzipReader {
+public:
+    // Reads from an already open stream, which is not closed
+    explicit GzipReader(FILE* input);
+    GzipReader(const GzipReader&) = delete;
+    GzipReader& operator=(const GzipReader&) = delete;
+
+    // Decompresses up to `capacity` bytes into out and returns how many
+    // 0 means the end of the stream, or an error when error() is not empty
+    size_t read(char* out, size_t capacity);
+    const std::string& error() const { return failure; }
+
+private:
+    // Canonical Huffman code: codes of up to FAST_BITS bits are decoded with one table
+    // lookup, longer ones bit by bit from the count/symbol lists
+    static constexpr int MAX_BITS = 15;
+    static constexpr int FAST_BITS = 10;
+    struct Huffman {
+        uint16_t count[MAX_BITS + 1];
+        uint16_t symbol[288];
+        uint16_t fast[1 << FAST_BITS]; // Bit length << 9 | symbol, 0 for longer codes
+    };
+
+    static bool buildHuffman(Huffman& code, const uint8_t* bitLengths, int symbols);
+
+    enum State { MEMBER_HEADER, BLOCK_HEADER, STORED, CODES, MEMBER_TRAILER, DONE, FAILED };
+
+    bool fillInput();
+    void need(int count);
+    uint32_t bits(int count);
+    void alignToByte();
+    bool truncated() const { return bitCount < padBits; }
+    bool atEnd();
+    bool fail(const std::string& message);
+    bool readMemberHeader();
+    bool readBlockHeader();
+    bool readDynamicTables();
+    bool readMemberTrailer();
+    int decode(const Huffman& code);
+
+    FILE* input;
+    unsigned char inBuffer[1 << 16];
+    size_t inPosition = 0;
+    size_t inLength = 0;
+    bool inputEnded = false;
+    uint64_t bitBuffer = 0;
+    int bitCount = 0;
+    int padBits = 0; // Zero bits fed in after the end of the input, consuming one is an error
+
+    State state = MEMBER_HEADER;
+    bool lastBlock = false;
+    bool anyMember = false;
+    size_t storedLeft = 0;
+    int copyLength = 0;
+    int copyDistance = 0;
+    Huffman lengths;
+    Huffman distances;
+
+    unsigned char window[1 << 15];
+    uint64_t written = 0; // Bytes of the current member so far
+    uint32_t crc = 0;
+    std::string failure;
+};
@@ -0,0 +1,271 @@
+#include "IncrementalLoader.h"
+#include "CsvLoader.h"
+#include "GzipReader.h"
+#include "Metrics.h"
+#include "ParallelLoader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+using namespace std;
+
+static void ownTable(Dataset& dataset) {
+    if (dataset.snapshot.isOpen() && dataset.owned.rowCount() == 0 && dataset.table.rows > 0) {
+        dataset.owned = buildAirportTable(dataset.table);
+        dataset.cube.ownCells();
+        dataset.snapshot = Snapshot();
+    }
+}
+
+size_t appendRows(string_view contents, bool skipHeader, AppendTargets& targets) {
+    METRICS_TIMER(timer, STAGE_INSERT);
+    if (targets.dataset != nullptr) {
+        ownTable(*targets.dataset);
+    }
+    size_t rows = 0;
+    AirportData data;
+    forEachCsvRow(contents, [&](const CsvRow& columns) {
+        if (targets.dataset != nullptr) {
+            AirportTable& table = targets.dataset->owned;
+            table.appendRow(columns);
+            size_t row = table.rowCount() - 1;
+            int32_t values[COUNTER_COUNT];
+            table.rowValues(row, values);
+            targets.dataset->cube.addRow(table.airport[row], table.period[row], values);
+            if (targets.ranker != nullptr) {
+                targets.ranker->update(static_cast<int>(table.airport[row]));
+            }
+        }
+        if (targets.hashTable != nullptr || targets.trie != nullptr) {
+            GetAirportInfo(data, columns);
+            if (targets.hashTable != nullptr) {
+                (*targets.hashTable)[data.code].push_back(data);
+            }
+            if (targets.trie != nullptr) {
+                insertTrie(targets.trie, data);
+            }
+        }
+        rows++;
+    }, skipHeader);
+    if (targets.dataset != nullptr) {
+        // Columns may have been reallocated
+        targets.dataset->table = targets.dataset->owned.view();
+    }
+    METRICS_ITEMS(timer, rows);
+    return rows;
+}
+
+// Contents of a delta file: mapped, or inflated into `inflated` when it is gzip-compressed
+static bool readDelta(const string& filename, MappedFile& mapped, string& inflated, string_view& contents,
+                      string& error) {
+    if (isGzipFile(filename)) {
+        if (!readGzipFile(filename, inflated, error)) {
+            return false;
+        }
+        contents = inflated;
+        return true;
+    }
+    mapped = MappedFile(filename);
+    if (!mapped.isOpen()) {
+        error = "Cannot open " + filename;
+        return false;
+    }
+    contents = mapped.contents();
+    return true;
+}
+
+bool appendCsvFile(const string& filename, AppendTargets& targets, size_t& rows, string& error) {
+    MappedFile mapped;
+    string inflated;
+    string_view contents;
+    if (!readDelta(filename, mapped, inflated, contents, error)) {
+        return false;
+    }
+    rows = appendRows(contents, true, targets);
+    return true;
+}
+
+static bool sameRows(const vector<AirportData>& a, const vector<AirportData>& b) {
+    return equal(a.begin(), a.end(), b.begin(), b.end(), [](const AirportData& x, const AirportData& y) {
+        return x.code == y.code && x.name == y.name && x.month == y.month && x.year == y.year &&
+               x.carrier == y.carrier && x.late == y.late && x.navis == y.navis && x.security == y.security &&
+               x.weather == y.weather && x.canceled == y.canceled && x.delayed == y.delayed &&
+               x.total_flights == y.total_flights;
+    });
+}
+
+static bool sameHashTables(const unordered_map<string, vector<AirportData>>& a,
+                           const unordered_map<string, vector<AirportData>>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (const auto& entry : a) {
+        auto it = b.find(entry.first);
+        if (it == b.end() || !sameRows(entry.second, it->second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool sameTries(TrieNode* a, TrieNode* b) {
+    vector<pair<string, vector<AirportData>>> left, right;
+    traverseTrie(a, left);
+    traverseTrie(b, right);
+    map<string, const vector<AirportData>*> byCode;
+    for (const auto& airport : right) {
+        byCode[airport.first] = &airport.second;
+    }
+    if (left.size() != byCode.size()) {
+        return false;
+    }
+    for (const auto& airport : left) {
+        auto it = byCode.find(airport.first);
+        if (it == byCode.end() || !sameRows(airport.second, *it->second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool sameTables(const AirportTable& a, const AirportTable& b) {
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (a.counters[c] != b.counters[c]) {
+            return false;
+        }
+    }
+    return a.airport == b.airport && a.period == b.period && a.codes == b.codes && a.nameOffsets == b.nameOffsets &&
+           a.nameBlob == b.nameBlob &&
+           equal(a.codeIndex.begin(), a.codeIndex.end(), b.codeIndex.begin(), b.codeIndex.end(),
+                 [](const CodeIndexEntry& x, const CodeIndexEntry& y) { return x.code == y.code && x.airport == y.airport; });
+}
+
+// Every cell including the roll-ups, so the top-5 ranking read from them matches too
+static bool sameCubes(const AggregateCube& a, const AggregateCube& b) {
+    if (a.airportCount() != b.airportCount() || a.firstYear() != b.firstYear() || a.lastYear() != b.lastYear()) {
+        return false;
+    }
+    for (int airport = AggregateCube::ALL_AIRPORTS; airport < static_cast<int>(a.airportCount()); airport++) {
+        for (int year = a.firstYear() - 1; year <= a.lastYear(); year++) {
+            int key = year < a.firstYear() ? AggregateCube::ALL_YEARS : year;
+            for (int month = 0; month <= 12; month++) {
+                const CubeCell& x = a.cell(airport, key, month);
+                const CubeCell& y = b.cell(airport, key, month);
+                if (x.rows != y.rows || !equal(begin(x.totals.sums), end(x.totals.sums), begin(y.totals.sums))) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool verifyAppend(const string& baseCsv, const string& deltaCsv, unsigned threads, string& report) {
+    report.clear();
+    MappedFile base(baseCsv);
+    if (!base.isOpen()) {
+        report = "Cannot open " + baseCsv;
+        return false;
+    }
+    MappedFile mappedDelta;
+    string inflatedDelta;
+    string_view delta;
+    if (!readDelta(deltaCsv, mappedDelta, inflatedDelta, delta, report)) {
+        return false;
+    }
+
+    // Full rebuild input: the base file followed by the delta rows (its header dropped)
+    string combinedFile = deltaCsv + ".rebuild.tmp";
+    {
+        string_view rows = delta;
+        rows.remove_prefix(min(rows.size(), rows.find('\n') + 1));
+        ofstream out(combinedFile, ios::binary | ios::trunc);
+        out << base.contents();
+        if (!base.contents().empty() && base.contents().back() != '\n') {
+            out << '\n';
+        }
+        out << rows;
+        if (!out) {
+            report = "Cannot write " + combinedFile;
+            return false;
+        }
+    }
+    Dataset rebuilt;
+    rebuilt.owned = buildAirportTableParallel(combinedFile, threads);
+    rebuilt.table = rebuilt.owned.view();
+    rebuilt.cube = AggregateCube(rebuilt.table);
+    unordered_map<string, vector<AirportData>> rebuiltHash = buildHashTableParallel(combinedFile, threads);
+    Trie rebuiltTrie = buildTrieParallel(combinedFile, threads);
+    remove(combinedFile.c_str());
+
+    Dataset appended;
+    appended.owned = buildAirportTableParallel(baseCsv, threads);
+    appended.table = appended.owned.view();
+    appended.cube = AggregateCube(appended.table);
+    unordered_map<string, vector<AirportData>> appendedHash = buildHashTableParallel(baseCsv, threads);
+    Trie appendedTrie = buildTrieParallel(baseCsv, threads);
+    AppendTargets targets;
+    targets.dataset = &appended;
+    targets.hashTable = &appendedHash;
+    targets.trie = appendedTrie.root();
+    size_t rows = appendRows(delta, true, targets);
+
+    report = "Appended " + to_string(rows) + " rows\n";
+    bool ok = true;
+    auto check = [&](bool same, const char* what) {
+        report += string(what) + (same ? ": matches full rebuild\n" : ": DIFFERS from full rebuild\n");
+        ok = ok && same;
+    };
+    check(sameTables(appended.owned, rebuilt.owned), "Columnar table");
+    check(sameCubes(appended.cube, rebuilt.cube), "Aggregate cube");
+    check(sameHashTables(appendedHash, rebuiltHash), "Hash table");
+    check(sameTries(appendedTrie.root(), rebuiltTrie.root()), "Trie");
+    return ok;
+}
+
+TailReader::TailReader(const string& filename, bool fromEnd) : filename(filename), skipHeader(!fromEnd) {
+    if (fromEnd) {
+        ifstream in(filename, ios::binary | ios::ate);
+        offset = in ? static_cast<uint64_t>(in.tellg()) : 0;
+    }
+}
+
+bool TailReader::poll(string& lines) {
+    lines.clear();
+    ifstream in(filename, ios::binary);
+    if (!in) {
+        return false;
+    }
+    in.seekg(0, ios::end);
+    uint64_t size = static_cast<uint64_t>(in.tellg());
+    if (size < offset) {
+        // Truncated or replaced by a new file: start over from its header
+        offset = 0;
+        pending.clear();
+        skipHeader = true;
+    }
+    if (size <= offset) {
+        return false;
+    }
+    size_t added = pending.size();
+    pending.resize(added + (size - offset));
+    in.seekg(offset);
+    in.read(&pending[added], size - offset);
+    pending.resize(added + static_cast<size_t>(in.gcount()));
+    offset += in.gcount();
+
+    size_t end = pending.rfind('\n');
+    if (end == string::npos) {
+        return false;
+    }
+    size_t begin = 0;
+    if (skipHeader) {
+        begin = pending.find('\n') + 1;
+        skipHeader = false;
+    }
+    lines.assign(pending, begin, end + 1 - begin);
+    pending.erase(0, end + 1);
+    return !lines.empty();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "AirportData.h"
+#include "Dataset.h"
+#include "TopKRanker.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Structures a delta is appended to; a null member is left alone
+struct AppendTargets {
+    Dataset* dataset = nullptr;
+    std::unordered_map<std::string, std::vector<AirportData>>* hashTable = nullptr;
+    TrieNode* trie = nullptr;
+    TopKRanker* ranker = nullptr; // Ranking over the dataset's cube, told about every changed airport
+};
+
+// Appends the rows of a delta in airlines.csv layout to every target, touching only
+// the cells/buckets the new rows land in, so the cost follows the delta size
+// A snapshot-backed dataset is copied into its own table on the first append
+// (the mapping is read-only); after that appends are as cheap as for a CSV load
+size_t appendRows(std::string_view contents, bool skipHeader, AppendTargets& targets);
+// Same for a delta file with a header row, gzip-compressed or not; returns false (with a
+// message) if it cannot be read
+bool appendCsvFile(const std::string& filename, AppendTargets& targets, size_t& rows, std::string& error);
+
+// Self-check: loads baseCsv, appends deltaCsv (gzip-compressed or not) to every structure
+// and compares the result with a full rebuild from the two files concatenated. Differences are listed in `report`
+bool verifyAppend(const std::string& baseCsv, const std::string& deltaCsv, unsigned threads, std::string& report);
+
+// Follows a growing CSV: every poll() hands back the complete lines written since
+// the previous one, a half-written last line waits for the next poll
+// A file that shrinks (truncated or rotated) is read again from its start, header skipped
+class TailReader {
+public:
+    // Starting from the end only rows written from now on are returned,
+    // otherwise the whole file (without its header) comes back on the first poll
+    TailReader(const std::string& filename, bool fromEnd);
+
+    // Returns false when there is nothing new
+    bool poll(std::string& lines);
+    uint64_t position() const { return offset; }
+
+private:
+    std::string filename;
+    uint64_t offset = 0;
+    bool skipHeader;
+    std::string pending;
+};
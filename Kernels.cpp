@@ -0,0 +1,271 @@
+#include "Kernels.h"
+
+#include <bitset>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KERNELS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC lets intrinsics be used without /arch:AVX2, GCC and Clang need the target attribute
+#if defined(KERNELS_X86) && (defined(__GNUC__) || defined(__clang__))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+using namespace std;
+
+double delayRate(const CounterTotals& totals) {
+    if (totals[TOTAL_FLIGHTS] == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(totals[DELAYED_FLIGHTS] + totals[CANCELED_FLIGHTS]) / totals[TOTAL_FLIGHTS] * 100.0;
+}
+
+double averageDelayMinutes(const CounterTotals& totals) {
+    if (totals[DELAYED_FLIGHTS] == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(totals[DELAY_MINUTES]) / totals[DELAYED_FLIGHTS];
+}
+
+double minuteShare(const CounterTotals& totals, CounterColumn cause) {
+    if (totals[DELAY_MINUTES] == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(totals[cause]) / totals[DELAY_MINUTES] * 100.0;
+}
+
+static bool rowMatches(const TableView& table, const RowFilter& filter, size_t i) {
+    if (filter.airport >= 0 && table.airport[i] != static_cast<uint32_t>(filter.airport)) {
+        return false;
+    }
+    uint16_t period = table.period[i];
+    int year = periodYear(period);
+    return (filter.monthMask >> periodMonth(period) & 1) && year >= filter.firstYear && year <= filter.lastYear;
+}
+
+static void addRow(const TableView& table, size_t i, RowTotals& totals) {
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (table.counters[c] != nullptr) {
+            totals.totals.sums[c] += table.counters[c][i];
+        }
+    }
+    totals.rows++;
+}
+
+RowTotals sumCountersScalar(const TableView& table, const RowFilter& filter) {
+    RowTotals totals;
+    for (size_t i = 0; i < table.rows; i++) {
+        if (rowMatches(table, filter, i)) {
+            addRow(table, i, totals);
+        }
+    }
+    return totals;
+}
+
+vector<RowTotals> sumCountersByAirportScalar(const TableView& table, const RowFilter& filter) {
+    vector<RowTotals> totals(table.airports);
+    for (size_t i = 0; i < table.rows; i++) {
+        if (rowMatches(table, filter, i)) {
+            addRow(table, i, totals[table.airport[i]]);
+        }
+    }
+    return totals;
+}
+
+#ifdef KERNELS_X86
+
+// Lane mask (all ones / zero) for 8 rows starting at i
+AVX2_TARGET static inline __m256i filterMask8(const TableView& table, const RowFilter& filter, size_t i,
+                                              __m256i monthMask, __m256i yearLow, __m256i yearHigh, __m256i airport) {
+    __m256i period = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table.period + i)));
+    __m256i month = _mm256_and_si256(period, _mm256_set1_epi32(15));
+    __m256i year = _mm256_srli_epi32(period, 4);
+    __m256i monthBit = _mm256_sllv_epi32(_mm256_set1_epi32(1), month);
+    __m256i monthMiss = _mm256_cmpeq_epi32(_mm256_and_si256(monthBit, monthMask), _mm256_setzero_si256());
+    __m256i inYears = _mm256_and_si256(_mm256_cmpgt_epi32(year, yearLow), _mm256_cmpgt_epi32(yearHigh, year));
+    __m256i mask = _mm256_andnot_si256(monthMiss, inYears);
+    if (filter.airport >= 0) {
+        __m256i ids = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(table.airport + i));
+        mask = _mm256_and_si256(mask, _mm256_cmpeq_epi32(ids, airport));
+    }
+    return mask;
+}
+
+// Widens 8 int32 lanes to int64 so the running sums cannot overflow
+AVX2_TARGET static inline __m256i addWide(__m256i sum, __m256i values) {
+    sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(values)));
+    return _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(values, 1)));
+}
+
+AVX2_TARGET static inline long long horizontalSum(__m256i sum) {
+    alignas(32) long long lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sum);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+// Rows set in a filter mask
+AVX2_TARGET static inline int maskRows(__m256i mask) {
+    return static_cast<int>(bitset<8>(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(mask)))).count());
+}
+
+AVX2_TARGET RowTotals sumCountersAvx2(const TableView& table, const RowFilter& filter) {
+    __m256i monthMask = _mm256_set1_epi32(filter.monthMask);
+    __m256i yearLow = _mm256_set1_epi32(filter.firstYear - 1);
+    __m256i yearHigh = _mm256_set1_epi32(filter.lastYear + 1);
+    __m256i airport = _mm256_set1_epi32(filter.airport);
+    __m256i sums[COUNTER_COUNT];
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        sums[c] = _mm256_setzero_si256();
+    }
+    RowTotals totals;
+    size_t i = 0;
+    for (; i + 8 <= table.rows; i += 8) {
+        __m256i mask = filterMask8(table, filter, i, monthMask, yearLow, yearHigh, airport);
+        if (_mm256_testz_si256(mask, mask)) {
+            continue;
+        }
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (table.counters[c] != nullptr) {
+                __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(table.counters[c] + i));
+                sums[c] = addWide(sums[c], _mm256_and_si256(values, mask));
+            }
+        }
+        totals.rows += maskRows(mask);
+    }
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        totals.totals.sums[c] = horizontalSum(sums[c]);
+    }
+    for (; i < table.rows; i++) {
+        if (rowMatches(table, filter, i)) {
+            addRow(table, i, totals);
+        }
+    }
+    return totals;
+}
+
+// Moves the register sums of a run of rows into its airport's totals
+AVX2_TARGET static void flushRun(__m256i sums[COUNTER_COUNT], RowTotals& run, long long& runRows) {
+    if (runRows == 0) {
+        return;
+    }
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        run.totals.sums[c] += horizontalSum(sums[c]);
+        sums[c] = _mm256_setzero_si256();
+    }
+    run.rows += runRows;
+    runRows = 0;
+}
+
+// Rows come grouped by airport, so most 8-row steps belong to one airport: those are
+// summed in registers until the airport changes, the mixed steps go lane by lane
+AVX2_TARGET vector<RowTotals> sumCountersByAirportAvx2(const TableView& table, const RowFilter& filter) {
+    vector<RowTotals> totals(table.airports);
+    if (table.rows == 0) {
+        return totals;
+    }
+    __m256i monthMask = _mm256_set1_epi32(filter.monthMask);
+    __m256i yearLow = _mm256_set1_epi32(filter.firstYear - 1);
+    __m256i yearHigh = _mm256_set1_epi32(filter.lastYear + 1);
+    __m256i airport = _mm256_set1_epi32(filter.airport);
+    __m256i sums[COUNTER_COUNT];
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        sums[c] = _mm256_setzero_si256();
+    }
+    uint32_t runAirport = 0;
+    long long runRows = 0;
+    alignas(32) int32_t lanes[8];
+    size_t i = 0;
+    for (; i + 8 <= table.rows; i += 8) {
+        __m256i mask = filterMask8(table, filter, i, monthMask, yearLow, yearHigh, airport);
+        if (_mm256_testz_si256(mask, mask)) {
+            continue;
+        }
+        uint32_t first = table.airport[i];
+        __m256i ids = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(table.airport + i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(ids, _mm256_set1_epi32(static_cast<int>(first)))) == -1) {
+            if (first != runAirport) {
+                flushRun(sums, totals[runAirport], runRows);
+                runAirport = first;
+            }
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                if (table.counters[c] != nullptr) {
+                    __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(table.counters[c] + i));
+                    sums[c] = addWide(sums[c], _mm256_and_si256(values, mask));
+                }
+            }
+            runRows += maskRows(mask);
+            continue;
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), mask);
+        for (int lane = 0; lane < 8; lane++) {
+            if (lanes[lane] != 0) {
+                addRow(table, i + lane, totals[table.airport[i + lane]]);
+            }
+        }
+    }
+    flushRun(sums, totals[runAirport], runRows);
+    for (; i < table.rows; i++) {
+        if (rowMatches(table, filter, i)) {
+            addRow(table, i, totals[table.airport[i]]);
+        }
+    }
+    return totals;
+}
+
+bool cpuHasAvx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init(); // Needed when called before main, e.g. from a static initializer
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#else
+
+// Non-x86 builds only have the scalar kernels
+RowTotals sumCountersAvx2(const TableView& table, const RowFilter& filter) {
+    return sumCountersScalar(table, filter);
+}
+
+vector<RowTotals> sumCountersByAirportAvx2(const TableView& table, const RowFilter& filter) {
+    return sumCountersByAirportScalar(table, filter);
+}
+
+bool cpuHasAvx2() {
+    return false;
+}
+
+#endif
+
+static const bool useAvx2 = cpuHasAvx2();
+
+RowTotals sumCounters(const TableView& table, const RowFilter& filter) {
+    return useAvx2 ? sumCountersAvx2(table, filter) : sumCountersScalar(table, filter);
+}
+
+vector<RowTotals> sumCountersByAirport(const TableView& table, const RowFilter& filter) {
+    return useAvx2 ? sumCountersByAirportAvx2(table, filter) : sumCountersByAirportScalar(table, filter);
+}
+
+const char* kernelName() {
+    return useAvx2 ? "avx2" : "scalar";
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ColumnStore.h"
+
+#include <cstdint>
+#include <vector>
+
+// Sums of every counter column over the rows that passed a filter
+struct CounterTotals {
+    long long sums[COUNTER_COUNT] = {};
+
+    long long operator[](int counter) const { return sums[counter]; }
+    CounterTotals& operator+=(const CounterTotals& other) {
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            sums[c] += other.sums[c];
+        }
+        return *this;
+    }
+};
+
+// Counter sums plus how many rows went into them
+struct RowTotals {
+    CounterTotals totals;
+    long long rows = 0;
+};
+
+// Which rows a kernel looks at: one airport (or all), a set of months and a year range
+const uint16_t ALL_MONTHS = 0x1FFE; // Bits 1-12
+struct RowFilter {
+    int airport = -1; // -1 for every airport
+    uint16_t monthMask = ALL_MONTHS;
+    int firstYear = 0;
+    int lastYear = 4095;
+};
+
+// Delayed + canceled over total flights, as a percentage
+double delayRate(const CounterTotals& totals);
+// Minutes delayed per delayed flight
+double averageDelayMinutes(const CounterTotals& totals);
+// One *_MINUTES column over all minutes delayed, as a percentage
+double minuteShare(const CounterTotals& totals, CounterColumn cause);
+
+// Sums every counter column in one pass (all cause breakdowns together)
+// Uses AVX2 when the CPU supports it, the scalar loop otherwise
+RowTotals sumCounters(const TableView& table, const RowFilter& filter);
+// Same sums for every airport id in one pass over the table, indexed by id
+// Delay rates of every airport are delayRate() of each entry
+std::vector<RowTotals> sumCountersByAirport(const TableView& table, const RowFilter& filter);
+
+// Explicit versions, used by the benchmark to compare the two
+RowTotals sumCountersScalar(const TableView& table, const RowFilter& filter);
+RowTotals sumCountersAvx2(const TableView& table, const RowFilter& filter);
+std::vector<RowTotals> sumCountersByAirportScalar(const TableView& table, const RowFilter& filter);
+std::vector<RowTotals> sumCountersByAirportAvx2(const TableView& table, const RowFilter& filter);
+
+// Runtime CPU check that picks the kernels above
+bool cpuHasAvx2();
+const char* kernelName();
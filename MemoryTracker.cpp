@@ -0,0 +1,130 @@
+#include "MemoryTracker.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#include <malloc.h>
+#pragma comment(lib, "psapi.lib")
+#define usableSize _msize
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#include <sys/resource.h>
+#define usableSize malloc_size
+#else
+#include <malloc.h>
+#include <sys/resource.h>
+#define usableSize malloc_usable_size
+#endif
+
+using namespace std;
+
+#if TRACK_ALLOCATIONS
+// Relaxed atomics: the counters are statistics, nothing is ordered by them
+static atomic<size_t> allocatedBytes{ 0 };
+static atomic<size_t> allocationCount{ 0 };
+static atomic<size_t> liveBytes{ 0 };
+static atomic<size_t> peakLiveBytes{ 0 };
+
+static void* trackedAlloc(size_t size) {
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        return nullptr;
+    }
+    size_t bytes = usableSize(p);
+    allocatedBytes.fetch_add(bytes, memory_order_relaxed);
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    size_t live = liveBytes.fetch_add(bytes, memory_order_relaxed) + bytes;
+    size_t peak = peakLiveBytes.load(memory_order_relaxed);
+    while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, memory_order_relaxed)) {
+    }
+    return p;
+}
+
+static void trackedFree(void* p) {
+    if (p != nullptr) {
+        liveBytes.fetch_sub(usableSize(p), memory_order_relaxed);
+        free(p);
+    }
+}
+
+void* operator new(size_t size) {
+    void* p = trackedAlloc(size);
+    if (p == nullptr) {
+        throw bad_alloc();
+    }
+    return p;
+}
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    return trackedAlloc(size);
+}
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    return trackedAlloc(size);
+}
+void operator delete(void* p) noexcept {
+    trackedFree(p);
+}
+void operator delete[](void* p) noexcept {
+    trackedFree(p);
+}
+void operator delete(void* p, size_t) noexcept {
+    trackedFree(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+    trackedFree(p);
+}
+void operator delete(void* p, const nothrow_t&) noexcept {
+    trackedFree(p);
+}
+void operator delete[](void* p, const nothrow_t&) noexcept {
+    trackedFree(p);
+}
+
+AllocationStats allocationStats() {
+    AllocationStats stats;
+    stats.allocatedBytes = allocatedBytes.load(memory_order_relaxed);
+    stats.allocations = allocationCount.load(memory_order_relaxed);
+    stats.liveBytes = liveBytes.load(memory_order_relaxed);
+    stats.peakLiveBytes = peakLiveBytes.load(memory_order_relaxed);
+    return stats;
+}
+
+void resetPeakLiveBytes() {
+    peakLiveBytes.store(liveBytes.load(memory_order_relaxed), memory_order_relaxed);
+}
+#else
+AllocationStats allocationStats() {
+    return AllocationStats();
+}
+
+void resetPeakLiveBytes() {}
+#endif
+
+size_t peakRssBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss); // Already bytes on macOS
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+// Heap accounting from replacement global operator new/delete (MemoryTracker.cpp)
+// Sizes are what the allocator actually handed out, so string buffers, hash buckets
+// and node overhead are all counted, unlike sizeof-based estimates
+// Every allocation of the process pays for the shared counters, so the hooks are only
+// compiled in with TRACK_ALLOCATIONS=1 (for the memory columns of the benchmarks and the
+// menu); otherwise every count below stays 0
+#ifndef TRACK_ALLOCATIONS
+#define TRACK_ALLOCATIONS 0
+#endif
+const bool ALLOCATION_TRACKING = TRACK_ALLOCATIONS != 0;
+
+struct AllocationStats {
+    size_t allocatedBytes = 0; // Every allocation since start, freed or not
+    size_t allocations = 0;
+    size_t liveBytes = 0;      // Allocated and not yet freed
+    size_t peakLiveBytes = 0;
+};
+
+AllocationStats allocationStats();
+// Starts a new peak measurement from the current live bytes
+void resetPeakLiveBytes();
+// Peak resident set size of the process, 0 where the platform does not report it
+size_t peakRssBytes();
+
+// Allocation counters over a scope: live() is what the scope kept, allocated() everything it asked for
+class AllocationScope {
+public:
+    AllocationScope() : start(allocationStats()) {}
+
+    long long live() const { return static_cast<long long>(allocationStats().liveBytes) - static_cast<long long>(start.liveBytes); }
+    size_t allocated() const { return allocationStats().allocatedBytes - start.allocatedBytes; }
+    size_t allocations() const { return allocationStats().allocations - start.allocations; }
+
+private:
+    AllocationStats start;
+};
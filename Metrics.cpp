@@ -0,0 +1,293 @@
+#include "Metrics.h"
+#include "BufferedWriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+static const char* const STAGE_NAMES[STAGE_COUNT] = { "read", "split", "parse", "insert", "aggregate", "rank", "format" };
+
+const char* stageName(int stage) {
+    return stage >= 0 && stage < STAGE_COUNT ? STAGE_NAMES[stage] : "unknown";
+}
+
+int histogramBucket(uint64_t nanoseconds) {
+    if (nanoseconds < static_cast<uint64_t>(HISTOGRAM_SUB_BUCKETS)) {
+        return static_cast<int>(nanoseconds);
+    }
+    int exponent = 63;
+    while ((nanoseconds >> exponent) == 0) {
+        exponent--;
+    }
+    if (exponent > HISTOGRAM_MAX_EXPONENT) {
+        return HISTOGRAM_BUCKETS - 1;
+    }
+    int sub = static_cast<int>((nanoseconds >> (exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1));
+    return (exponent - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+uint64_t histogramLowerBound(int bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS) {
+        return static_cast<uint64_t>(bucket);
+    }
+    int exponent = bucket / HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BITS - 1;
+    uint64_t sub = static_cast<uint64_t>(bucket % HISTOGRAM_SUB_BUCKETS);
+    return (HISTOGRAM_SUB_BUCKETS + sub) << (exponent - HISTOGRAM_SUB_BITS);
+}
+
+struct StageCounters {
+    atomic<uint64_t> calls;
+    atomic<uint64_t> items;
+    atomic<uint64_t> nanoseconds;
+    atomic<uint64_t> maxNanoseconds;
+    atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+};
+
+// One thread's counters, aligned so two threads never write the same cache line
+// A slot is claimed by a thread on its first record and freed when the thread exits; the
+// next thread keeps adding to it, so nothing is lost when worker pools come and go
+struct alignas(64) ThreadSlot {
+    atomic<bool> claimed;
+    StageCounters stages[STAGE_COUNT];
+};
+
+// Static storage, so recording never allocates (and never shows up in heap measurements)
+// Threads beyond the last slot share it
+constexpr int THREAD_SLOTS = 64;
+static ThreadSlot slots[THREAD_SLOTS];
+
+struct SlotHandle {
+    int index = -1;
+    ~SlotHandle() {
+        if (index >= 0 && index < THREAD_SLOTS - 1) {
+            slots[index].claimed.store(false, memory_order_release);
+        }
+    }
+};
+
+static ThreadSlot& currentSlot() {
+    thread_local SlotHandle handle;
+    if (handle.index < 0) {
+        handle.index = THREAD_SLOTS - 1;
+        for (int i = 0; i < THREAD_SLOTS - 1; i++) {
+            bool expected = false;
+            if (slots[i].claimed.compare_exchange_strong(expected, true, memory_order_acquire)) {
+                handle.index = i;
+                break;
+            }
+        }
+    }
+    return slots[handle.index];
+}
+
+// Relaxed: the counters are statistics, nothing is ordered by them
+void recordStage(PipelineStage stage, uint64_t items, uint64_t nanoseconds) {
+    StageCounters& counters = currentSlot().stages[stage];
+    counters.calls.fetch_add(1, memory_order_relaxed);
+    counters.items.fetch_add(items, memory_order_relaxed);
+    counters.nanoseconds.fetch_add(nanoseconds, memory_order_relaxed);
+    counters.buckets[histogramBucket(nanoseconds)].fetch_add(1, memory_order_relaxed);
+    uint64_t seen = counters.maxNanoseconds.load(memory_order_relaxed);
+    while (nanoseconds > seen && !counters.maxNanoseconds.compare_exchange_weak(seen, nanoseconds, memory_order_relaxed)) {
+    }
+}
+
+// One stage summed over every slot
+struct StageTotals {
+    uint64_t calls = 0;
+    uint64_t items = 0;
+    uint64_t nanoseconds = 0;
+    uint64_t maxNanoseconds = 0;
+    uint64_t buckets[HISTOGRAM_BUCKETS] = {};
+};
+
+static void collect(int stage, StageTotals& totals) {
+    for (const ThreadSlot& slot : slots) {
+        const StageCounters& counters = slot.stages[stage];
+        if (counters.calls.load(memory_order_relaxed) == 0) {
+            continue;
+        }
+        totals.calls += counters.calls.load(memory_order_relaxed);
+        totals.items += counters.items.load(memory_order_relaxed);
+        totals.nanoseconds += counters.nanoseconds.load(memory_order_relaxed);
+        totals.maxNanoseconds = max(totals.maxNanoseconds, counters.maxNanoseconds.load(memory_order_relaxed));
+        for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+            totals.buckets[b] += counters.buckets[b].load(memory_order_relaxed);
+        }
+    }
+}
+
+// Upper end of the bucket holding the given quantile, capped by the largest value seen
+static uint64_t quantile(const StageTotals& totals, double q) {
+    uint64_t rank = static_cast<uint64_t>(q * totals.calls);
+    uint64_t seen = 0;
+    for (int b = 0; b < HISTOGRAM_BUCKETS - 1; b++) {
+        seen += totals.buckets[b];
+        if (seen > rank) {
+            return min(histogramLowerBound(b + 1) - 1, totals.maxNanoseconds);
+        }
+    }
+    return totals.maxNanoseconds;
+}
+
+static void append(string& out, uint64_t value) {
+    out += to_string(value);
+}
+
+static void appendSeconds(string& out, uint64_t nanoseconds) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.9f", nanoseconds / 1e9);
+    out += text;
+}
+
+string metricsJson() {
+    unique_ptr<StageTotals> totals(new StageTotals());
+    string out = "{\"stages\":[";
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        *totals = StageTotals();
+        collect(stage, *totals);
+        out += stage == 0 ? "{\"stage\":\"" : ",{\"stage\":\"";
+        out += stageName(stage);
+        out += "\",\"calls\":";
+        append(out, totals->calls);
+        out += ",\"items\":";
+        append(out, totals->items);
+        out += ",\"total_ns\":";
+        append(out, totals->nanoseconds);
+        out += ",\"p50_ns\":";
+        append(out, quantile(*totals, 0.50));
+        out += ",\"p90_ns\":";
+        append(out, quantile(*totals, 0.90));
+        out += ",\"p99_ns\":";
+        append(out, quantile(*totals, 0.99));
+        out += ",\"max_ns\":";
+        append(out, totals->maxNanoseconds);
+        out += ",\"threads\":[";
+        bool first = true;
+        for (int t = 0; t < THREAD_SLOTS; t++) {
+            const StageCounters& counters = slots[t].stages[stage];
+            if (counters.calls.load(memory_order_relaxed) == 0) {
+                continue;
+            }
+            out += first ? "{\"thread\":" : ",{\"thread\":";
+            append(out, static_cast<uint64_t>(t));
+            out += ",\"calls\":";
+            append(out, counters.calls.load(memory_order_relaxed));
+            out += ",\"items\":";
+            append(out, counters.items.load(memory_order_relaxed));
+            out += ",\"total_ns\":";
+            append(out, counters.nanoseconds.load(memory_order_relaxed));
+            out += '}';
+            first = false;
+        }
+        out += "]}";
+    }
+    out += "]}";
+    return out;
+}
+
+static void appendHeader(string& out, const char* name, const char* type, const char* help) {
+    out += string("# HELP ") + name + ' ' + help + '\n';
+    out += string("# TYPE ") + name + ' ' + type + '\n';
+}
+
+static void appendSample(string& out, const char* name, int stage, const char* extraLabel = nullptr,
+                         const string& extraValue = string()) {
+    out += name;
+    out += "{stage=\"";
+    out += stageName(stage);
+    out += '"';
+    if (extraLabel != nullptr) {
+        out += string(",") + extraLabel + "=\"" + extraValue + '"';
+    }
+    out += "} ";
+}
+
+string metricsPrometheus() {
+    unique_ptr<StageTotals[]> totals(new StageTotals[STAGE_COUNT]);
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        collect(stage, totals[stage]);
+    }
+    string out;
+    appendHeader(out, "pipeline_stage_calls_total", "counter", "Timed calls per pipeline stage");
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        appendSample(out, "pipeline_stage_calls_total", stage);
+        append(out, totals[stage].calls);
+        out += '\n';
+    }
+    appendHeader(out, "pipeline_stage_items_total", "counter",
+                 "Items (bytes, chunks, rows, airports or output rows) per pipeline stage");
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        appendSample(out, "pipeline_stage_items_total", stage);
+        append(out, totals[stage].items);
+        out += '\n';
+    }
+
+    appendHeader(out, "pipeline_stage_latency_seconds", "histogram", "Latency of one call per pipeline stage");
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        const StageTotals& t = totals[stage];
+        uint64_t cumulative = 0;
+        for (int b = 0; b < HISTOGRAM_BUCKETS - 1; b++) {
+            if (t.buckets[b] == 0) {
+                continue;
+            }
+            cumulative += t.buckets[b];
+            string bound;
+            appendSeconds(bound, histogramLowerBound(b + 1));
+            appendSample(out, "pipeline_stage_latency_seconds_bucket", stage, "le", bound);
+            append(out, cumulative);
+            out += '\n';
+        }
+        appendSample(out, "pipeline_stage_latency_seconds_bucket", stage, "le", "+Inf");
+        append(out, t.calls);
+        out += '\n';
+        appendSample(out, "pipeline_stage_latency_seconds_sum", stage);
+        appendSeconds(out, t.nanoseconds);
+        out += '\n';
+        appendSample(out, "pipeline_stage_latency_seconds_count", stage);
+        append(out, t.calls);
+        out += '\n';
+    }
+
+    appendHeader(out, "pipeline_thread_stage_seconds_total", "counter", "Time spent per pipeline stage and thread slot");
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        for (int t = 0; t < THREAD_SLOTS; t++) {
+            const StageCounters& counters = slots[t].stages[stage];
+            if (counters.calls.load(memory_order_relaxed) == 0) {
+                continue;
+            }
+            appendSample(out, "pipeline_thread_stage_seconds_total", stage, "thread", to_string(t));
+            appendSeconds(out, counters.nanoseconds.load(memory_order_relaxed));
+            out += '\n';
+        }
+    }
+    return out;
+}
+
+bool dumpMetrics(const string& filename) {
+    unique_ptr<BufferedWriter> out(filename == "-" ? new BufferedWriter(stderr) : new BufferedWriter(filename));
+    if (!out->isOpen()) {
+        return false;
+    }
+    bool prometheus = filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".prom") == 0;
+    out->write(prometheus ? metricsPrometheus() : metricsJson() + '\n');
+    return true;
+}
+
+static string exitDumpFile;
+
+static void dumpAtExit() {
+    dumpMetrics(exitDumpFile);
+}
+
+void dumpMetricsAtExit(const string& filename) {
+    if (exitDumpFile.empty()) {
+        atexit(dumpAtExit);
+    }
+    exitDumpFile = filename;
+}
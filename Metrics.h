@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Per-stage pipeline instrumentation: call, item and time counters plus a latency histogram
+// per stage, kept per thread (no shared cache lines on the hot path) and merged when dumped
+// Build with PIPELINE_METRICS=0 and every METRICS_* macro compiles to nothing
+#ifndef PIPELINE_METRICS
+#define PIPELINE_METRICS 1
+#endif
+
+enum PipelineStage {
+    STAGE_READ,      // Opening / mapping input files, items are bytes
+    STAGE_SPLIT,     // Cutting input into chunks for the workers, items are chunks
+    STAGE_PARSE,     // CSV rows into rows or columns, items are rows
+    STAGE_INSERT,    // Rows into a lookup structure or table, items are rows
+    STAGE_AGGREGATE, // Cube, trends and slices over the columns, items are rows
+    STAGE_RANK,      // Top-k selection, items are airports
+    STAGE_FORMAT,    // Reports and CSV/JSON output, items are output rows
+    STAGE_COUNT
+};
+
+const char* stageName(int stage);
+
+// Log-linear buckets in the HDR style: exact below 16 ns, then 16 buckets per power of two,
+// so a value is never more than 1/16 above its bucket's lower bound; the last bucket
+// (2^40 ns, about 18 minutes) takes everything above
+constexpr int HISTOGRAM_SUB_BITS = 4;
+constexpr int HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BITS;
+constexpr int HISTOGRAM_MAX_EXPONENT = 40;
+constexpr int HISTOGRAM_BUCKETS = (HISTOGRAM_MAX_EXPONENT - HISTOGRAM_SUB_BITS + 2) * HISTOGRAM_SUB_BUCKETS;
+
+int histogramBucket(uint64_t nanoseconds);
+uint64_t histogramLowerBound(int bucket);
+
+// Adds one timed call of `stage` to the calling thread's counters
+void recordStage(PipelineStage stage, uint64_t items, uint64_t nanoseconds);
+
+// Times its scope as one call of a stage
+class StageTimer {
+public:
+    explicit StageTimer(PipelineStage stage, uint64_t items = 0)
+        : stage(stage), items(items), start(std::chrono::steady_clock::now()) {}
+    ~StageTimer() {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        recordStage(stage, items, static_cast<uint64_t>(elapsed.count()));
+    }
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    void addItems(uint64_t count) { items += count; }
+
+private:
+    PipelineStage stage;
+    uint64_t items;
+    std::chrono::steady_clock::time_point start;
+};
+
+#if PIPELINE_METRICS
+#define METRICS_TIMER(timer, stage) StageTimer timer(stage)
+#define METRICS_ITEMS(timer, count) timer.addItems(static_cast<uint64_t>(count))
+#else
+#define METRICS_TIMER(timer, stage) ((void)0)
+#define METRICS_ITEMS(timer, count) ((void)0)
+#endif
+
+// Every thread's counters merged, as one line of JSON: per stage the totals, p50/p90/p99/max
+// latency and a per-thread breakdown
+std::string metricsJson();
+// Same counters in the Prometheus text format; the histogram lists only non-empty buckets
+std::string metricsPrometheus();
+// Writes JSON, or Prometheus text when the name ends in .prom; "-" is stderr
+bool dumpMetrics(const std::string& filename);
+// Dumps to `filename` when the program exits
+void dumpMetricsAtExit(const std::string& filename);
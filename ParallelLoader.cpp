@@ -0,0 +1,165 @@
+#include "ParallelLoader.h"
+#include "CsvLoader.h"
+#include "Metrics.h"
+
+#include <iterator>
+
+using namespace std;
+
+// Airports of one chunk in the order they first appear, so merging chunk by chunk
+// inserts keys in the same order as the serial loader
+struct PartialAirports {
+    unordered_map<string, size_t> index;
+    vector<pair<string, vector<AirportData>>> airports;
+};
+
+unsigned defaultThreadCount() {
+    unsigned threads = thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
+
+// More chunks than threads so one slow chunk does not hold up the other workers
+static vector<string_view> chunksFor(string_view contents, unsigned threads) {
+    if (threads == 0) {
+        threads = defaultThreadCount();
+    }
+    return splitChunks(contents, threads == 1 ? 1 : threads * 4);
+}
+
+static vector<PartialAirports> parsePartials(string_view contents, unsigned threads) {
+    vector<string_view> chunks = chunksFor(contents, threads);
+    vector<PartialAirports> partials(chunks.size());
+    runOnWorkers(chunks.size(), threads, [&](size_t c) {
+        METRICS_TIMER(timer, STAGE_PARSE);
+        PartialAirports& partial = partials[c];
+        AirportData data;
+        forEachCsvRow(chunks[c], [&](const CsvRow& columns) {
+            METRICS_ITEMS(timer, 1);
+            GetAirportInfo(data, columns);
+            auto it = partial.index.find(data.code);
+            if (it == partial.index.end()) {
+                it = partial.index.emplace(data.code, partial.airports.size()).first;
+                partial.airports.emplace_back(data.code, vector<AirportData>());
+            }
+            partial.airports[it->second].second.push_back(data);
+        }, c == 0);
+    });
+    return partials;
+}
+
+unordered_map<string, vector<AirportData>> buildHashTableParallel(const string& filename, unsigned threads) {
+    unordered_map<string, vector<AirportData>> dataMap;
+    MappedFile file(filename);
+    vector<PartialAirports> partials = parsePartials(file.contents(), threads);
+    METRICS_TIMER(timer, STAGE_INSERT);
+    for (auto& partial : partials) {
+        for (auto& airport : partial.airports) {
+            METRICS_ITEMS(timer, airport.second.size());
+            vector<AirportData>& rows = dataMap[airport.first];
+            if (rows.empty()) {
+                rows = move(airport.second);
+            }
+            else {
+                rows.insert(rows.end(), make_move_iterator(airport.second.begin()), make_move_iterator(airport.second.end()));
+            }
+        }
+    }
+    return dataMap;
+}
+
+Trie buildTrieParallel(const string& filename, unsigned threads) {
+    Trie trie;
+    TrieNode* root = trie.root();
+    pmr::memory_resource* memory = root->children.get_allocator().resource();
+    MappedFile file(filename);
+    vector<PartialAirports> partials = parsePartials(file.contents(), threads);
+    METRICS_TIMER(timer, STAGE_INSERT);
+    // Nodes first, with each airport's row count, so every row array is sized once; in the
+    // arena an outgrown array is dead space until the trie is dropped
+    unordered_map<TrieNode*, size_t> rowCounts;
+    vector<vector<TrieNode*>> leaves(partials.size());
+    for (size_t p = 0; p < partials.size(); p++) {
+        for (auto& airport : partials[p].airports) {
+            TrieNode* current = root;
+            for (char c : airport.first) {
+                TrieNode*& child = current->children[c];
+                if (child == nullptr) {
+                    child = Trie::newNode(memory);
+                }
+                current = child;
+            }
+            rowCounts[current] += airport.second.size();
+            METRICS_ITEMS(timer, airport.second.size());
+            leaves[p].push_back(current);
+        }
+    }
+    for (const auto& leaf : rowCounts) {
+        leaf.first->airport_data.reserve(leaf.second);
+    }
+    for (size_t p = 0; p < partials.size(); p++) {
+        for (size_t a = 0; a < partials[p].airports.size(); a++) {
+            vector<AirportData>& rows = partials[p].airports[a].second;
+            pmr::vector<AirportData>& target = leaves[p][a]->airport_data;
+            target.insert(target.end(), make_move_iterator(rows.begin()), make_move_iterator(rows.end()));
+        }
+    }
+    return trie;
+}
+
+FlatAirportIndex buildFlatIndexParallel(const string& filename, unsigned threads) {
+    MappedFile file(filename);
+    vector<PartialAirports> partials = parsePartials(file.contents(), threads);
+    if (partials.empty()) {
+        return FlatAirportIndex();
+    }
+    METRICS_TIMER(timer, STAGE_INSERT);
+    // Same first-seen order as the serial loader
+    PartialAirports merged = move(partials[0]);
+    for (size_t a = 0; a < merged.airports.size(); a++) {
+        METRICS_ITEMS(timer, merged.airports[a].second.size());
+    }
+    for (size_t p = 1; p < partials.size(); p++) {
+        for (auto& airport : partials[p].airports) {
+            METRICS_ITEMS(timer, airport.second.size());
+            auto it = merged.index.find(airport.first);
+            if (it == merged.index.end()) {
+                merged.index.emplace(airport.first, merged.airports.size());
+                merged.airports.push_back(move(airport));
+                continue;
+            }
+            vector<AirportData>& rows = merged.airports[it->second].second;
+            rows.insert(rows.end(), make_move_iterator(airport.second.begin()), make_move_iterator(airport.second.end()));
+        }
+    }
+    return FlatAirportIndex(move(merged.airports));
+}
+
+AirportTable buildAirportTableParallel(const string& filename, unsigned threads, uint32_t projection) {
+    MappedFile file(filename);
+    vector<string_view> chunks = chunksFor(file.contents(), threads);
+    vector<AirportTable> partials(chunks.size());
+    size_t columns = csvColumnsFor(projection);
+    runOnWorkers(chunks.size(), threads, [&](size_t c) {
+        METRICS_TIMER(timer, STAGE_PARSE);
+        partials[c].projection = projection;
+        partials[c].reserve(countLines(chunks[c]));
+        forEachCsvRow(chunks[c], [&](const CsvRow& columns) {
+            partials[c].appendRow(columns);
+        }, c == 0, columns);
+        METRICS_ITEMS(timer, partials[c].rowCount());
+    });
+
+    METRICS_TIMER(timer, STAGE_INSERT);
+    AirportTable table;
+    table.projection = projection;
+    size_t rows = 0;
+    for (const auto& partial : partials) {
+        rows += partial.rowCount();
+    }
+    table.reserve(rows);
+    METRICS_ITEMS(timer, rows);
+    for (const auto& partial : partials) {
+        table.appendTable(partial);
+    }
+    return table;
+}
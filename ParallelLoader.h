@@ -0,0 +1,45 @@
+#pragma once
+
+#include "AirportData.h"
+#include "ColumnStore.h"
+#include "FlatIndex.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Worker count used when a caller passes 0 threads
+unsigned defaultThreadCount();
+
+// Parallel versions of buildHashTable / buildTrie / buildAirportTable
+// The mapped file is split at newlines, the chunks are parsed on `threads` workers into
+// partial tables and merged back in file order, so the result is identical to the serial build
+std::unordered_map<std::string, std::vector<AirportData>> buildHashTableParallel(const std::string& filename, unsigned threads);
+Trie buildTrieParallel(const std::string& filename, unsigned threads);
+FlatAirportIndex buildFlatIndexParallel(const std::string& filename, unsigned threads);
+AirportTable buildAirportTableParallel(const std::string& filename, unsigned threads,
+                                       uint32_t projection = ALL_COUNTERS);
+
+// Runs work(index) for index 0..count-1 on `threads` workers (the caller is one of them)
+template <typename Work>
+void runOnWorkers(size_t count, unsigned threads, Work&& work) {
+    if (threads == 0) {
+        threads = defaultThreadCount();
+    }
+    std::atomic<size_t> next{ 0 };
+    auto worker = [&]() {
+        for (size_t index = next++; index < count; index = next++) {
+            work(index);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads && t < count; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
@@ -0,0 +1,280 @@
+#include "PipelinedLoader.h"
+#include "CsvLoader.h"
+#include "GzipReader.h"
+#include "Metrics.h"
+#include "RouteStore.h"
+#include "SpscQueue.h"
+
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <thread>
+
+using namespace std;
+
+// Page aligned, so unbuffered reads can go straight into the buffer
+const size_t BUFFER_ALIGNMENT = 4096;
+
+struct AlignedBuffer {
+    AlignedBuffer() : data(static_cast<char*>(::operator new(PIPELINE_BUFFER_SIZE, align_val_t(BUFFER_ALIGNMENT)))) {}
+    ~AlignedBuffer() { ::operator delete(data, align_val_t(BUFFER_ALIGNMENT)); }
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+
+    char* data;
+};
+
+// A buffer handed from the reader to the parser; buffer -1 ends the stream
+struct FilledBuffer {
+    int buffer = -1;
+    size_t size = 0;
+};
+
+// Room for every buffer plus the end marker
+using BufferQueue = SpscQueue<int, PIPELINE_BUFFERS>;
+using FilledQueue = SpscQueue<FilledBuffer, PIPELINE_BUFFERS * 2>;
+template <typename Batch>
+using BatchQueue = SpscQueue<unique_ptr<Batch>, PIPELINE_BUFFERS * 2>;
+
+static inline size_t batchRows(const vector<AirportData>& batch) {
+    return batch.size();
+}
+
+static inline size_t batchRows(const AirportTable& batch) {
+    return batch.rowCount();
+}
+
+static inline size_t batchRows(const RouteTable& batch) {
+    return batch.rowCount();
+}
+
+static void readStage(const string& filename, AlignedBuffer* buffers, BufferQueue& freeBuffers, FilledQueue& filled,
+                      string& error) {
+    bool compressed = isGzipFile(filename);
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        error = "Cannot open " + filename;
+        filled.push(FilledBuffer());
+        return;
+    }
+    // The buffers are large already, stdio's own one would only add a copy
+    setvbuf(file, nullptr, _IONBF, 0);
+    unique_ptr<GzipReader> gzip(compressed ? new GzipReader(file) : nullptr);
+    for (;;) {
+        int b;
+        freeBuffers.pop(b);
+        METRICS_TIMER(timer, STAGE_READ);
+        char* data = buffers[b].data;
+        size_t size = 0;
+        // Whole buffers only, a short read from a pipe or network file is not the end
+        while (size < PIPELINE_BUFFER_SIZE) {
+            size_t read = gzip ? gzip->read(data + size, PIPELINE_BUFFER_SIZE - size)
+                               : fread(data + size, 1, PIPELINE_BUFFER_SIZE - size, file);
+            if (read == 0) {
+                break;
+            }
+            size += read;
+        }
+        METRICS_ITEMS(timer, size);
+        if (gzip && !gzip->error().empty()) {
+            error = filename + ": " + gzip->error();
+        }
+        else if (ferror(file)) {
+            error = "Read error in " + filename;
+        }
+        if (size > 0 && error.empty()) {
+            filled.push(FilledBuffer{ b, size });
+        }
+        if (size < PIPELINE_BUFFER_SIZE || !error.empty()) {
+            break;
+        }
+    }
+    fclose(file);
+    filled.push(FilledBuffer());
+}
+
+// Cuts the buffers into whole lines; a row split across two buffers is put back together
+// in `carry`. Each buffer becomes one batch and goes back to the reader right away
+template <typename Batch, typename Parse>
+static void parseStage(AlignedBuffer* buffers, BufferQueue& freeBuffers, FilledQueue& filled,
+                       BatchQueue<Batch>& batches, Parse& parse) {
+    string carry;
+    bool header = true;
+    unique_ptr<Batch> batch;
+    auto parseLines = [&](string_view lines) {
+        if (!lines.empty()) {
+            parse(lines, header, *batch);
+            header = false;
+        }
+    };
+    for (;;) {
+        FilledBuffer next;
+        filled.pop(next);
+        METRICS_TIMER(timer, STAGE_PARSE);
+        batch.reset(new Batch());
+        if (next.buffer < 0) {
+            // The last row may have no newline
+            parseLines(carry);
+            METRICS_ITEMS(timer, batchRows(*batch));
+            batches.push(move(batch));
+            break;
+        }
+        string_view text(buffers[next.buffer].data, next.size);
+        size_t first = carry.empty() ? 0 : text.find('\n');
+        if (first == string_view::npos) {
+            carry.append(text);
+        }
+        else {
+            if (!carry.empty()) {
+                carry.append(text.substr(0, first + 1));
+                parseLines(carry);
+                text.remove_prefix(first + 1);
+            }
+            size_t last = text.rfind('\n');
+            // npos + 1 is 0: no complete line, all of it is carried
+            parseLines(text.substr(0, last + 1));
+            carry.assign(text.substr(last + 1));
+        }
+        freeBuffers.push(next.buffer);
+        METRICS_ITEMS(timer, batchRows(*batch));
+        batches.push(move(batch));
+    }
+    batches.push(nullptr);
+}
+
+// Runs the reader and parser threads and inserts every batch on the calling thread
+template <typename Batch, typename Parse, typename Insert>
+static bool runPipeline(const string& filename, string& error, Parse parse, Insert insert) {
+    unique_ptr<AlignedBuffer[]> buffers(new AlignedBuffer[PIPELINE_BUFFERS]);
+    unique_ptr<BufferQueue> freeBuffers(new BufferQueue());
+    unique_ptr<FilledQueue> filled(new FilledQueue());
+    unique_ptr<BatchQueue<Batch>> batches(new BatchQueue<Batch>());
+    for (size_t b = 0; b < PIPELINE_BUFFERS; b++) {
+        freeBuffers->push(static_cast<int>(b));
+    }
+    error.clear();
+    thread reader(readStage, cref(filename), buffers.get(), ref(*freeBuffers), ref(*filled), ref(error));
+    thread parser([&]() { parseStage<Batch>(buffers.get(), *freeBuffers, *filled, *batches, parse); });
+    for (;;) {
+        unique_ptr<Batch> batch;
+        batches->pop(batch);
+        if (!batch) {
+            break;
+        }
+        METRICS_TIMER(timer, STAGE_INSERT);
+        METRICS_ITEMS(timer, batchRows(*batch));
+        insert(*batch);
+    }
+    reader.join();
+    parser.join();
+    return error.empty();
+}
+
+static void parseRecords(string_view lines, bool header, vector<AirportData>& batch) {
+    forEachCsvRow(lines, [&](const CsvRow& columns) {
+        batch.emplace_back();
+        GetAirportInfo(batch.back(), columns);
+    }, header);
+}
+
+unordered_map<string, vector<AirportData>> buildHashTablePipelined(const string& filename, string& error) {
+    unordered_map<string, vector<AirportData>> dataMap;
+    bool loaded = runPipeline<vector<AirportData>>(filename, error, parseRecords, [&](vector<AirportData>& batch) {
+        for (AirportData& data : batch) {
+            dataMap[data.code].push_back(move(data));
+        }
+    });
+    return loaded ? move(dataMap) : unordered_map<string, vector<AirportData>>();
+}
+
+// Rows grouped by airport, airports in the order they first appear like the serial loader
+static bool collectAirports(const string& filename, string& error, vector<pair<string, vector<AirportData>>>& airports) {
+    unordered_map<string, size_t> index;
+    return runPipeline<vector<AirportData>>(filename, error, parseRecords, [&](vector<AirportData>& batch) {
+        for (AirportData& data : batch) {
+            auto it = index.find(data.code);
+            if (it == index.end()) {
+                it = index.emplace(data.code, airports.size()).first;
+                airports.emplace_back(data.code, vector<AirportData>());
+            }
+            airports[it->second].second.push_back(move(data));
+        }
+    });
+}
+
+Trie buildTriePipelined(const string& filename, string& error) {
+    vector<pair<string, vector<AirportData>>> airports;
+    if (!collectAirports(filename, error, airports)) {
+        return Trie();
+    }
+    // Every airport's rows are known before its node is made, so each row array is sized once
+    Trie trie;
+    TrieNode* root = trie.root();
+    pmr::memory_resource* memory = root->children.get_allocator().resource();
+    for (auto& airport : airports) {
+        TrieNode* current = root;
+        for (char c : airport.first) {
+            TrieNode*& child = current->children[c];
+            if (child == nullptr) {
+                child = Trie::newNode(memory);
+            }
+            current = child;
+        }
+        current->airport_data.assign(make_move_iterator(airport.second.begin()), make_move_iterator(airport.second.end()));
+    }
+    return trie;
+}
+
+FlatAirportIndex buildFlatIndexPipelined(const string& filename, string& error) {
+    vector<pair<string, vector<AirportData>>> airports;
+    if (!collectAirports(filename, error, airports)) {
+        return FlatAirportIndex();
+    }
+    return FlatAirportIndex(move(airports));
+}
+
+AirportTable buildAirportTablePipelined(const string& filename, string& error, uint32_t projection) {
+    AirportTable table;
+    table.projection = projection;
+    size_t columns = csvColumnsFor(projection);
+    auto parse = [&](string_view lines, bool header, AirportTable& batch) {
+        batch.projection = projection;
+        batch.reserve(batch.rowCount() + countLines(lines));
+        forEachCsvRow(lines, [&](const CsvRow& row) { batch.appendRow(row); }, header, columns);
+    };
+    bool loaded = runPipeline<AirportTable>(filename, error, parse, [&](AirportTable& batch) {
+        table.appendTable(batch);
+    });
+    if (!loaded) {
+        AirportTable empty;
+        empty.projection = projection;
+        return empty;
+    }
+    return table;
+}
+
+bool buildRouteTablePipelined(const string& filename, string& error, uint32_t projection, RouteTable& routes) {
+    routes = RouteTable();
+    routes.projection = projection & ~(1u << CARRIERS_TOTAL);
+    size_t columns = routeColumnsFor(routes.projection);
+    // One flag per thread, read once both are done
+    bool parsed = true;
+    bool merged = true;
+    auto parse = [&](string_view lines, bool header, RouteTable& batch) {
+        batch.projection = routes.projection;
+        batch.reserve(batch.rowCount() + countLines(lines));
+        forEachCsvRow(lines, [&](const CsvRow& row) { parsed = batch.appendRow(row) && parsed; }, header, columns);
+    };
+    bool loaded = runPipeline<RouteTable>(filename, error, parse, [&](RouteTable& batch) {
+        merged = routes.appendTable(batch) && merged;
+    });
+    if (loaded && !(parsed && merged)) {
+        error = filename + ": a row has an invalid date, or there are more than 65535 airports or carriers";
+    }
+    if (!error.empty()) {
+        routes = RouteTable();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "AirportData.h"
+#include "ColumnStore.h"
+#include "FlatIndex.h"
+#include "RouteStore.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Pipelined versions of buildHashTable / buildTrie / buildAirportTable, for input that is
+// slow to read or cannot be mapped (network mounts, gzip). Three stages overlap:
+// - a reader thread fills large aligned buffers ahead of the parser, inflating gzip input
+// - a parser thread cuts the buffers into rows and parses each one into a batch
+// - the calling thread inserts the batches into the structure
+// The stages pass buffers and batches through bounded lock-free queues, so a slow stage holds
+// the ones before it back instead of letting memory pile up, and a load takes about as long
+// as its slowest stage instead of the sum of them
+// Results are identical to the serial builds; on a read or gzip error they are empty and
+// `error` says what went wrong (it is cleared on success)
+const size_t PIPELINE_BUFFER_SIZE = 1 << 20;
+const size_t PIPELINE_BUFFERS = 4;
+
+std::unordered_map<std::string, std::vector<AirportData>> buildHashTablePipelined(const std::string& filename,
+                                                                                   std::string& error);
+Trie buildTriePipelined(const std::string& filename, std::string& error);
+FlatAirportIndex buildFlatIndexPipelined(const std::string& filename, std::string& error);
+AirportTable buildAirportTablePipelined(const std::string& filename, std::string& error,
+                                        uint32_t projection = ALL_COUNTERS);
+// Route feed (see RouteStore.h); false when `error` is set
+bool buildRouteTablePipelined(const std::string& filename, std::string& error, uint32_t projection,
+                              RouteTable& routes);
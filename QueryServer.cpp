@@ -0,0 +1,391 @@
+#include "QueryServer.h"
+#include "BenchHarness.h"
+#include "IncrementalLoader.h"
+#include "Metrics.h"
+#include "TopKRanker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+using namespace std;
+
+static void destroySnapshot(void* snapshot) {
+    delete static_cast<ServingSnapshot*>(snapshot);
+}
+
+QueryEngine::QueryEngine(const string& csvFile, const string& snapshotFile, unsigned threads, uint32_t projection)
+    : csvFile(csvFile), snapshotFile(snapshotFile), threads(threads), projection(projection) {}
+
+QueryEngine::~QueryEngine() {
+    {
+        lock_guard<mutex> lock(jobsLock);
+        stopping = true;
+    }
+    jobsReady.notify_all();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    // No sessions are left, so the current snapshot can go directly; the domain deletes the retired ones
+    delete current.exchange(nullptr);
+}
+
+bool QueryEngine::start(string& error) {
+    unique_ptr<Dataset> dataset = loadDataset(csvFile, snapshotFile, threads, error, projection);
+    if (!dataset) {
+        return false;
+    }
+    publish(makeSnapshot(move(dataset)));
+    writer = thread(&QueryEngine::writerLoop, this);
+    return true;
+}
+
+unique_ptr<ServingSnapshot> QueryEngine::makeSnapshot(unique_ptr<Dataset> dataset) {
+    unique_ptr<ServingSnapshot> snapshot(new ServingSnapshot());
+    snapshot->search = AirportSearch(dataset->table, dataset->cube);
+    snapshot->dataset = move(dataset);
+    return snapshot;
+}
+
+unique_ptr<Dataset> QueryEngine::copyCurrent() {
+    const Dataset& from = *current.load()->dataset;
+    unique_ptr<Dataset> copy(new Dataset());
+    copy->owned = buildAirportTable(from.table);
+    copy->table = copy->owned.view();
+    copy->cube = from.cube;
+    copy->source = from.source;
+    return copy;
+}
+
+void QueryEngine::publish(unique_ptr<ServingSnapshot> next) {
+    lock_guard<mutex> lock(publishLock);
+    publishLocked(move(next));
+}
+
+void QueryEngine::publishLocked(unique_ptr<ServingSnapshot> next) {
+    next->version = publishedVersion.load() + 1;
+    uint64_t version = next->version;
+    ServingSnapshot* old = current.exchange(next.release());
+    publishedVersion.store(version);
+    if (old != nullptr) {
+        swapCount++;
+        domain.retire(old, destroySnapshot);
+    }
+    domain.reclaim();
+}
+
+void QueryEngine::republish() {
+    lock_guard<mutex> lock(publishLock);
+    publishLocked(makeSnapshot(copyCurrent()));
+}
+
+void QueryEngine::requestReload() {
+    {
+        lock_guard<mutex> lock(jobsLock);
+        jobs.push_back(string());
+    }
+    jobsReady.notify_one();
+}
+
+void QueryEngine::requestAppend(const string& deltaFile) {
+    {
+        lock_guard<mutex> lock(jobsLock);
+        jobs.push_back(deltaFile);
+    }
+    jobsReady.notify_one();
+}
+
+void QueryEngine::writerLoop() {
+    while (true) {
+        string job;
+        {
+            unique_lock<mutex> lock(jobsLock);
+            jobsReady.wait(lock, [&] { return stopping || !jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = jobs.front();
+            jobs.pop_front();
+        }
+        string error;
+        if (job.empty()) {
+            // Full reload, built without holding anything the readers or other writers need
+            unique_ptr<Dataset> dataset = loadDataset(csvFile, snapshotFile, threads, error, projection);
+            if (dataset) {
+                publish(makeSnapshot(move(dataset)));
+            }
+        }
+        else {
+            lock_guard<mutex> lock(publishLock);
+            unique_ptr<Dataset> dataset = copyCurrent();
+            AppendTargets targets;
+            targets.dataset = dataset.get();
+            size_t rows;
+            if (appendCsvFile(job, targets, rows, error)) {
+                publishLocked(makeSnapshot(move(dataset)));
+            }
+        }
+        lock_guard<mutex> lock(jobsLock);
+        lastError = error;
+    }
+}
+
+QueryEngine::Session::Session(QueryEngine& engine) : engine(engine), slot(engine.domain.registerReader()) {}
+
+QueryEngine::Session::~Session() {
+    if (slot >= 0) {
+        engine.domain.unregisterReader(slot);
+    }
+}
+
+static vector<string_view> splitWords(string_view line) {
+    vector<string_view> words;
+    size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && isspace(static_cast<unsigned char>(line[i]))) {
+            i++;
+        }
+        size_t start = i;
+        while (i < line.size() && !isspace(static_cast<unsigned char>(line[i]))) {
+            i++;
+        }
+        if (i > start) {
+            words.push_back(line.substr(start, i - start));
+        }
+    }
+    return words;
+}
+
+static string upper(string_view text) {
+    string result(text);
+    transform(result.begin(), result.end(), result.begin(), [](char c) { return static_cast<char>(toupper(static_cast<unsigned char>(c))); });
+    return result;
+}
+
+double QueryEngine::Session::delayRate(string_view code, int month) {
+    if (slot < 0) {
+        return -1.0;
+    }
+    EpochGuard guard(engine.domain, slot);
+    const ServingSnapshot* snapshot = engine.current.load();
+    int airport = snapshot->dataset->table.findAirport(code);
+    if (airport < 0) {
+        return -1.0;
+    }
+    return ::delayRate(snapshot->dataset->cube.cell(airport, AggregateCube::ALL_YEARS, month).totals);
+}
+
+vector<string> QueryEngine::Session::codesByTraffic() {
+    if (slot < 0) {
+        return {};
+    }
+    EpochGuard guard(engine.domain, slot);
+    const Dataset& dataset = *engine.current.load()->dataset;
+    vector<pair<long long, uint32_t>> traffic;
+    for (uint32_t a = 0; a < dataset.table.airports; a++) {
+        long long flights = dataset.cube.cell(static_cast<int>(a), AggregateCube::ALL_YEARS, AggregateCube::WHOLE_YEAR).totals[TOTAL_FLIGHTS];
+        traffic.emplace_back(-flights, a);
+    }
+    sort(traffic.begin(), traffic.end());
+    vector<string> codes;
+    for (const auto& entry : traffic) {
+        codes.push_back(dataset.table.airportCode(entry.second));
+    }
+    return codes;
+}
+
+string QueryEngine::Session::execute(string_view line) {
+    if (slot < 0) {
+        return "ERR too many sessions";
+    }
+    vector<string_view> words = splitWords(line);
+    if (words.empty()) {
+        return "ERR empty command";
+    }
+    string command = upper(words[0]);
+    if (command == "RELOAD") {
+        engine.requestReload();
+        return "OK reload queued";
+    }
+    if (command == "APPEND") {
+        if (words.size() < 2) {
+            return "ERR usage: APPEND <delta.csv>";
+        }
+        engine.requestAppend(string(words[1]));
+        return "OK append queued";
+    }
+    if (command == "METRICS") {
+        return "OK " + metricsJson();
+    }
+
+    // Everything below reads one snapshot, which stays valid until the guard ends
+    EpochGuard guard(engine.domain, slot);
+    const ServingSnapshot& snapshot = *engine.current.load();
+    const TableView& table = snapshot.dataset->table;
+    const AggregateCube& cube = snapshot.dataset->cube;
+    ostringstream response;
+    response << fixed << setprecision(2);
+    if (command == "Q") {
+        if (words.size() < 3) {
+            return "ERR usage: Q <code> <month|all> [year]";
+        }
+        int airport = words[1].size() <= 4 ? table.findAirport(upper(words[1])) : -1;
+        if (airport < 0) {
+            return "ERR unknown airport";
+        }
+        int month = AggregateCube::WHOLE_YEAR;
+        if (upper(words[2]) != "ALL") {
+            month = atoi(string(words[2]).c_str());
+            if (month < 1 || month > 12) {
+                month = monthNumber(words[2]);
+            }
+            if (month == 0) {
+                return "ERR unknown month";
+            }
+        }
+        int year = words.size() > 3 ? atoi(string(words[3]).c_str()) : AggregateCube::ALL_YEARS;
+        if (year != AggregateCube::ALL_YEARS && !cube.hasYear(year)) {
+            return "ERR unknown year";
+        }
+        const CubeCell& cell = cube.cell(airport, year, month);
+        response << "OK " << table.airportCode(airport) << " rows=" << cell.rows << " flights=" << cell.totals[TOTAL_FLIGHTS]
+                 << " delayed=" << cell.totals[DELAYED_FLIGHTS] << " canceled=" << cell.totals[CANCELED_FLIGHTS]
+                 << " rate=" << ::delayRate(cell.totals);
+    }
+    else if (command == "TOP") {
+        size_t k = words.size() > 1 ? strtoul(string(words[1]).c_str(), nullptr, 10) : 5;
+        RankMetric metric = words.size() > 2 ? parseRankMetric(words[2]) : RANK_DELAY_RATE;
+        if (metric == RANK_METRIC_COUNT) {
+            return "ERR unknown metric";
+        }
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (((rankMetricColumns(metric) >> c) & 1) && table.counters[c] == nullptr) {
+                return string("ERR column not loaded: ") + counterName(c);
+            }
+        }
+        response << "OK";
+        for (const RankedAirport& ranked : topK(cube, k, metric)) {
+            response << " " << table.airportCode(ranked.airport) << "=" << ranked.value;
+        }
+    }
+    else if (command == "SEARCH") {
+        size_t start = line.find_first_not_of(" \t", line.find_first_of(" \t"));
+        string_view text = start == string_view::npos ? string_view() : line.substr(start);
+        response << "OK";
+        for (const SearchHit& hit : snapshot.search.suggest(text, 10)) {
+            response << " " << table.airportCode(hit.airport) << "|" << table.airportName(hit.airport) << ";";
+        }
+    }
+    else if (command == "STATS") {
+        string error;
+        {
+            lock_guard<mutex> lock(engine.jobsLock);
+            error = engine.lastError;
+        }
+        response << "OK version=" << snapshot.version << " rows=" << table.rows << " airports=" << table.airports
+                 << " swaps=" << engine.swaps() << " retired=" << engine.domain.pending()
+                 << " reclaimed=" << engine.domain.reclaimed();
+        if (!error.empty()) {
+            response << " last_error=\"" << error << "\"";
+        }
+    }
+    else {
+        return "ERR unknown command " + command;
+    }
+    return response.str();
+}
+
+static bool readLine(FILE* in, string& line) {
+    line.clear();
+    char buffer[4096];
+    while (fgets(buffer, sizeof(buffer), in) != nullptr) {
+        line += buffer;
+        if (!line.empty() && line.back() == '\n') {
+            break;
+        }
+    }
+    if (line.empty()) {
+        return false;
+    }
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+        line.pop_back();
+    }
+    return true;
+}
+
+void runServer(QueryEngine& engine, FILE* in, BufferedWriter& out) {
+    QueryEngine::Session session(engine);
+    string line;
+    while (readLine(in, line)) {
+        if (upper(line) == "QUIT") {
+            break;
+        }
+        if (line.empty()) {
+            continue;
+        }
+        out.write(session.execute(line)).write('\n');
+        out.flush(); // A client waits for each reply
+    }
+}
+
+void runServeBenchmark(QueryEngine& engine, const vector<unsigned>& readerCounts, double seconds, int swapMilliseconds) {
+    // Codes to query, the busy airports first so the skewed pick below favours them
+    vector<string> codes = QueryEngine::Session(engine).codesByTraffic();
+    if (codes.empty()) {
+        cout << "No airports loaded" << endl;
+        return;
+    }
+    cout << "Serve benchmark: " << codes.size() << " airports, " << seconds << " s per run, snapshot swap every "
+         << swapMilliseconds << " ms" << endl;
+    cout << setw(8) << "readers" << setw(14) << "queries" << setw(14) << "QPS" << setw(16) << "QPS/reader" << setw(8)
+         << "swaps" << setw(11) << "reclaimed" << endl;
+    for (unsigned readers : readerCounts) {
+        atomic<bool> stop{ false };
+        atomic<unsigned long long> total{ 0 };
+        size_t swapsBefore = engine.swaps();
+        size_t reclaimedBefore = engine.epochs().reclaimed();
+        thread swapper([&] {
+            while (!stop.load(memory_order_relaxed) && swapMilliseconds > 0) {
+                this_thread::sleep_for(chrono::milliseconds(swapMilliseconds));
+                if (!stop.load(memory_order_relaxed)) {
+                    engine.republish();
+                }
+            }
+        });
+        vector<thread> pool;
+        for (unsigned r = 0; r < readers; r++) {
+            pool.emplace_back([&, r] {
+                QueryEngine::Session session(engine);
+                if (!session.isValid()) {
+                    return;
+                }
+                mt19937 rng(1234 + r);
+                unsigned long long count = 0;
+                while (!stop.load(memory_order_relaxed)) {
+                    // Squaring a uniform pick skews towards the start of the list (the busiest airports)
+                    double u = (rng() & 0xFFFF) / 65536.0;
+                    doNotOptimize(session.delayRate(codes[static_cast<size_t>(u * u * codes.size())], 1 + rng() % 12));
+                    count++;
+                }
+                total += count;
+            });
+        }
+        auto start_time = chrono::steady_clock::now();
+        this_thread::sleep_for(chrono::duration<double>(seconds));
+        stop = true;
+        for (auto& worker : pool) {
+            worker.join();
+        }
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+        swapper.join();
+        engine.republish(); // Lets the last retired snapshots go now that no reader is left
+        double qps = total / elapsed;
+        cout << setw(8) << readers << setw(14) << total.load() << setw(14) << fixed << setprecision(0) << qps << setw(16)
+             << qps / readers << setw(8) << engine.swaps() - swapsBefore << setw(11)
+             << engine.epochs().reclaimed() - reclaimedBefore << endl;
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "AirportSearch.h"
+#include "BufferedWriter.h"
+#include "Dataset.h"
+#include "EpochDomain.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Everything one published version of the data needs to answer queries; never modified
+// once published, a reload or append builds a new one next to it
+struct ServingSnapshot {
+    std::unique_ptr<Dataset> dataset;
+    AirportSearch search;
+    uint64_t version = 0;
+};
+
+// Multi-reader query engine over RCU-style published snapshots
+// Readers (Sessions) load the current snapshot without locks; reloads and appends run on
+// one writer thread, which builds a new snapshot, swaps it in and retires the old one
+// through the epoch domain
+class QueryEngine {
+public:
+    QueryEngine(const std::string& csvFile, const std::string& snapshotFile, unsigned threads,
+                uint32_t projection = ALL_COUNTERS);
+    ~QueryEngine();
+    QueryEngine(const QueryEngine&) = delete;
+    QueryEngine& operator=(const QueryEngine&) = delete;
+
+    // Loads and publishes the first snapshot and starts the writer thread
+    bool start(std::string& error);
+
+    // One per reader thread
+    class Session {
+    public:
+        explicit Session(QueryEngine& engine);
+        ~Session();
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+
+        bool isValid() const { return slot >= 0; }
+        // Runs one protocol command and returns the response line (without newline)
+        std::string execute(std::string_view line);
+        // Cheapest read: delay rate of one airport/month from the current snapshot
+        double delayRate(std::string_view code, int month);
+        // Airport codes of the current snapshot, busiest first
+        std::vector<std::string> codesByTraffic();
+
+    private:
+        QueryEngine& engine;
+        int slot;
+    };
+
+    // Writer side, queued for the writer thread; replies come from later STATS
+    void requestReload();
+    void requestAppend(const std::string& deltaFile);
+    // Rebuilds a copy of the current data and publishes it (used by the load generator)
+    void republish();
+    void publish(std::unique_ptr<ServingSnapshot> next);
+
+    uint64_t version() const { return publishedVersion.load(); }
+    size_t swaps() const { return swapCount.load(); }
+    const EpochDomain& epochs() const { return domain; }
+
+private:
+    std::unique_ptr<ServingSnapshot> makeSnapshot(std::unique_ptr<Dataset> dataset);
+    // Copy of the current dataset that can be appended to; caller holds publishLock
+    std::unique_ptr<Dataset> copyCurrent();
+    void publishLocked(std::unique_ptr<ServingSnapshot> next);
+    void writerLoop();
+
+    std::string csvFile;
+    std::string snapshotFile;
+    unsigned threads;
+    uint32_t projection;
+
+    std::atomic<ServingSnapshot*> current{ nullptr };
+    EpochDomain domain;
+    std::mutex publishLock; // Serializes writers; only they retire snapshots, so it also keeps current alive for them
+    std::atomic<uint64_t> publishedVersion{ 0 };
+    std::atomic<size_t> swapCount{ 0 };
+    std::string lastError; // Writer thread only, reported through STATS under jobsLock
+
+    std::mutex jobsLock;
+    std::condition_variable jobsReady;
+    std::deque<std::string> jobs; // "" reloads, anything else is a delta file to append
+    bool stopping = false;
+    std::thread writer;
+};
+
+// Line protocol on in/out until QUIT or end of input:
+//   Q <code> <month|all> [year]   counters and delay rate of one cube cell
+//   TOP [k] [metric]              ranking, metric as for --top
+//   SEARCH <text>                 autocomplete
+//   RELOAD | APPEND <delta.csv>   queue a rebuild, queries keep running meanwhile
+//   STATS                         snapshot version, rows, swaps, reclamation
+//   METRICS                       pipeline stage counters as one line of JSON
+void runServer(QueryEngine& engine, FILE* in, BufferedWriter& out);
+
+// Load generator: `readers` threads run random Q commands for `seconds` while the
+// writer republishes the snapshot every swapMilliseconds; prints QPS per reader count
+void runServeBenchmark(QueryEngine& engine, const std::vector<unsigned>& readerCounts, double seconds,
+                       int swapMilliseconds);
@@ -0,0 +1,173 @@
+#include "RouteIndex.h"
+#include "Metrics.h"
+#include "ParallelLoader.h"
+
+#include <algorithm>
+
+using namespace std;
+
+void RouteIndex::insert(Shard& shard, Slot entry) {
+    size_t mask = shard.slots.size() - 1;
+    size_t pos = mixRouteKey(entry.key) & mask;
+    for (size_t distance = 0;; distance++, pos = (pos + 1) & mask) {
+        Slot& slot = shard.slots[pos];
+        if (slot.key == NO_ROUTE_KEY) {
+            slot = entry;
+            shard.maxProbe = max(shard.maxProbe, distance);
+            return;
+        }
+        // Robin Hood: the entry further from home takes the slot, the other one moves on
+        size_t existing = (pos - mixRouteKey(slot.key)) & mask;
+        if (existing < distance) {
+            shard.maxProbe = max(shard.maxProbe, distance);
+            swap(slot, entry);
+            distance = existing;
+        }
+    }
+}
+
+RouteIndex::RouteIndex(const RouteTable& routes, unsigned threads, unsigned shardCount) {
+    METRICS_TIMER(timer, STAGE_INSERT);
+    METRICS_ITEMS(timer, routes.rowCount());
+    if (threads == 0) {
+        threads = defaultThreadCount();
+    }
+    if (shardCount == 0) {
+        shardCount = threads * 4;
+    }
+    size_t count = 1;
+    shardShift = 64;
+    while (count < shardCount) {
+        count *= 2;
+        shardShift--;
+    }
+    shards.resize(count);
+    const vector<uint64_t>& keyColumn = routes.keys;
+    size_t rowCount = routes.rowCount();
+
+    // Partition the row ids by shard: each chunk counts its rows per shard, the counts
+    // become offsets, then each chunk places its rows, so a shard's rows stay in row order
+    size_t chunkCount = max<size_t>(1, min<size_t>(threads, rowCount / 65536 + 1));
+    vector<vector<size_t>> offsets(chunkCount, vector<size_t>(count + 1, 0));
+    runOnWorkers(chunkCount, threads, [&](size_t c) {
+        for (size_t i = rowCount * c / chunkCount; i < rowCount * (c + 1) / chunkCount; i++) {
+            offsets[c][shardOf(mixRouteKey(keyColumn[i]))]++;
+        }
+    });
+    vector<size_t> shardStarts(count + 1, 0);
+    size_t position = 0;
+    for (size_t s = 0; s < count; s++) {
+        shardStarts[s] = position;
+        for (size_t c = 0; c < chunkCount; c++) {
+            size_t rowsHere = offsets[c][s];
+            offsets[c][s] = position;
+            position += rowsHere;
+        }
+    }
+    shardStarts[count] = position;
+    rows.resize(rowCount);
+    runOnWorkers(chunkCount, threads, [&](size_t c) {
+        vector<size_t>& next = offsets[c];
+        for (size_t i = rowCount * c / chunkCount; i < rowCount * (c + 1) / chunkCount; i++) {
+            rows[next[shardOf(mixRouteKey(keyColumn[i]))]++] = static_cast<uint32_t>(i);
+        }
+    });
+
+    // Every shard groups its rows by key and fills its own table
+    runOnWorkers(count, threads, [&](size_t s) {
+        uint32_t* begin = rows.data() + shardStarts[s];
+        uint32_t* end = rows.data() + shardStarts[s + 1];
+        stable_sort(begin, end, [&](uint32_t a, uint32_t b) { return keyColumn[a] < keyColumn[b]; });
+        size_t distinct = 0;
+        for (uint32_t* it = begin; it != end; it++) {
+            distinct += it == begin || keyColumn[*it] != keyColumn[*(it - 1)];
+        }
+        Shard& shard = shards[s];
+        size_t size = 8;
+        while (size * 3 < distinct * 4) {
+            size *= 2;
+        }
+        shard.slots.assign(size, Slot{ NO_ROUTE_KEY, 0, 0 });
+        shard.keys = distinct;
+        for (uint32_t* it = begin; it != end;) {
+            uint64_t key = keyColumn[*it];
+            uint32_t* spanEnd = it + 1;
+            while (spanEnd != end && keyColumn[*spanEnd] == key) {
+                spanEnd++;
+            }
+            insert(shard, Slot{ key, static_cast<uint32_t>(it - rows.data()), static_cast<uint32_t>(spanEnd - it) });
+            it = spanEnd;
+        }
+    });
+    for (const Shard& shard : shards) {
+        keys += shard.keys;
+    }
+}
+
+RouteRows RouteIndex::find(uint64_t key) const {
+    RouteRows found;
+    if (shards.empty() || key == NO_ROUTE_KEY) {
+        return found;
+    }
+    uint64_t hash = mixRouteKey(key);
+    const Shard& shard = shards[shardOf(hash)];
+    size_t mask = shard.slots.size() - 1;
+    size_t pos = hash & mask;
+    for (size_t distance = 0;; distance++, pos = (pos + 1) & mask) {
+        const Slot& slot = shard.slots[pos];
+        if (slot.key == key) {
+            found.rows = rows.data() + slot.begin;
+            found.count = slot.count;
+            return found;
+        }
+        // An empty slot, or a key closer to home than we are, means the key is not there
+        if (slot.key == NO_ROUTE_KEY || ((pos - mixRouteKey(slot.key)) & mask) < distance) {
+            return found;
+        }
+    }
+}
+
+size_t RouteIndex::slotCount() const {
+    size_t slots = 0;
+    for (const Shard& shard : shards) {
+        slots += shard.slots.size();
+    }
+    return slots;
+}
+
+size_t RouteIndex::maxProbeLength() const {
+    size_t longest = 0;
+    for (const Shard& shard : shards) {
+        longest = max(longest, shard.maxProbe);
+    }
+    return longest;
+}
+
+size_t RouteIndex::largestShard() const {
+    size_t largest = 0;
+    for (const Shard& shard : shards) {
+        largest = max(largest, shard.keys);
+    }
+    return largest;
+}
+
+size_t RouteIndex::memoryUsage() const {
+    size_t bytes = shards.capacity() * sizeof(Shard) + rows.capacity() * sizeof(uint32_t);
+    for (const Shard& shard : shards) {
+        bytes += shard.slots.capacity() * sizeof(Slot);
+    }
+    return bytes;
+}
+
+CounterTotals sumRouteRows(const RouteTable& routes, RouteRows found) {
+    CounterTotals totals;
+    for (size_t r = 0; r < found.count; r++) {
+        uint32_t row = found.rows[r];
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (routes.hasColumn(c)) {
+                totals.sums[c] += routes.counters[c][row];
+            }
+        }
+    }
+    return totals;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Kernels.h"
+#include "RouteStore.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Rows of one composite key, ids into the RouteTable the index was built from
+struct RouteRows {
+    const uint32_t* rows = nullptr;
+    size_t count = 0;
+
+    bool empty() const { return count == 0; }
+};
+
+// Hash index from the composite route key to its rows, split into shards
+// A key's mixed hash picks the shard with its top bits and the home slot with its low bits.
+// Every shard is its own Robin Hood table (linear probing, at most 3/4 full), so the shards
+// are built at the same time on separate workers and a lookup touches one shard only
+// A slot holds the key and a span of one shared row id array; a key the feed repeats (two
+// files with the same day) has all of its rows in the span
+// Read-only once built; at most 2^32 rows
+class RouteIndex {
+public:
+    RouteIndex() = default;
+    // `shards` is rounded up to a power of two; 0 picks four per worker
+    RouteIndex(const RouteTable& routes, unsigned threads, unsigned shards = 0);
+
+    RouteRows find(uint64_t key) const;
+    size_t keyCount() const { return keys; }
+    size_t shardCount() const { return shards.size(); }
+    size_t slotCount() const;
+    // Longest distance of a key from its home slot, the worst case of a lookup
+    size_t maxProbeLength() const;
+    // Keys in the fullest shard
+    size_t largestShard() const;
+    size_t memoryUsage() const;
+
+private:
+    struct Slot {
+        uint64_t key; // NO_ROUTE_KEY when the slot is empty
+        uint32_t begin; // Span in rows
+        uint32_t count;
+    };
+
+    struct Shard {
+        std::vector<Slot> slots;
+        size_t keys = 0;
+        size_t maxProbe = 0;
+    };
+
+    size_t shardOf(uint64_t hash) const { return shardShift == 64 ? 0 : static_cast<size_t>(hash >> shardShift); }
+    static void insert(Shard& shard, Slot entry);
+
+    std::vector<Shard> shards;
+    unsigned shardShift = 64;
+    std::vector<uint32_t> rows; // Row ids grouped by shard, then by key
+    size_t keys = 0;
+};
+
+// Splitmix64 finalizer, spreads the packed ids and day over all 64 bits
+inline uint64_t mixRouteKey(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ull;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBull;
+    return key ^ (key >> 31);
+}
+
+// Sums the counters of the rows found for a key
+CounterTotals sumRouteRows(const RouteTable& routes, RouteRows rows);
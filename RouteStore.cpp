@@ -0,0 +1,394 @@
+#include "RouteStore.h"
+#include "CsvLoader.h"
+#include "GzipReader.h"
+#include "Kernels.h"
+#include "Metrics.h"
+#include "ParallelLoader.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <memory>
+#include <unordered_map>
+
+using namespace std;
+
+static const char* const ROUTE_HEADER_PREFIX = "date,carrier,origin,";
+
+// Feed column every counter is parsed from; carriers_total has none
+static size_t routeColumnOf(int counter) {
+    return ROUTE_COL_COUNTERS + counter - (counter > CARRIERS_TOTAL ? 1 : 0);
+}
+
+string routeCsvHeader() {
+    string header = "date,carrier,origin,origin_name,dest,dest_name";
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (c != CARRIERS_TOTAL) {
+            header += ',';
+            header += counterName(c);
+        }
+    }
+    return header;
+}
+
+bool isRouteFeed(const string& filename) {
+    bool compressed = isGzipFile(filename);
+    FILE* file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    char start[32] = {};
+    size_t read = 0;
+    if (compressed) {
+        GzipReader gzip(file);
+        while (read < sizeof(start)) {
+            size_t got = gzip.read(start + read, sizeof(start) - read);
+            if (got == 0) {
+                break;
+            }
+            read += got;
+        }
+    }
+    else {
+        read = fread(start, 1, sizeof(start), file);
+    }
+    fclose(file);
+    string_view prefix = ROUTE_HEADER_PREFIX;
+    return string_view(start, read).substr(0, prefix.size()) == prefix;
+}
+
+// Days from civil and back (proleptic Gregorian, eras of 400 years)
+uint16_t dayNumber(int year, int month, int day) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return static_cast<uint16_t>(era * 146097 + dayOfEra - 719468);
+}
+
+void civilDate(uint16_t number, int& year, int& month, int& day) {
+    int days = number + 719468;
+    int era = days / 146097;
+    int dayOfEra = days - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int shifted = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * shifted + 2) / 5 + 1;
+    month = shifted < 10 ? shifted + 3 : shifted - 9;
+    year = yearOfEra + era * 400 + (month <= 2);
+}
+
+// Leading digits of text, false when there are none or too many
+static bool takeNumber(string_view& text, size_t maxDigits, int& value) {
+    size_t digits = 0;
+    value = 0;
+    while (digits < text.size() && text[digits] >= '0' && text[digits] <= '9') {
+        if (digits == maxDigits) {
+            return false; // Too long, and more digits could overflow `value`
+        }
+        value = value * 10 + (text[digits] - '0');
+        digits++;
+    }
+    text.remove_prefix(digits);
+    return digits > 0;
+}
+
+static bool takeSeparator(string_view& text, char separator) {
+    if (text.empty() || text[0] != separator) {
+        return false;
+    }
+    text.remove_prefix(1);
+    return true;
+}
+
+bool parseRouteDate(string_view text, uint16_t& number) {
+    int year, month, day;
+    if (text.size() >= 5 && text[4] == '-') {
+        if (!takeNumber(text, 4, year) || !takeSeparator(text, '-') || !takeNumber(text, 2, month) ||
+            !takeSeparator(text, '-') || !takeNumber(text, 2, day)) {
+            return false;
+        }
+    }
+    else if (!takeNumber(text, 2, month) || !takeSeparator(text, '/') || !takeNumber(text, 2, day) ||
+             !takeSeparator(text, '/') || !takeNumber(text, 4, year)) {
+        return false;
+    }
+    static const int DAYS_IN_MONTH[13] = { 0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    if (year < 1970 || month < 1 || month > 12 || day < 1 || day > DAYS_IN_MONTH[month] ||
+        (month == 2 && day == 29 && !leap)) {
+        return false;
+    }
+    // 2149-06-06 is the last day that fits
+    if (year > 2149 || (year == 2149 && (month > 6 || (month == 6 && day > 6)))) {
+        return false;
+    }
+    number = dayNumber(year, month, day);
+    return true;
+}
+
+void RouteTable::reserve(size_t rows) {
+    keys.reserve(rows);
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (hasColumn(c)) {
+            counters[c].reserve(rows);
+        }
+    }
+}
+
+uint32_t RouteTable::internCarrier(string_view code) {
+    uint32_t packed = packCode(code);
+    auto it = lower_bound(carrierIndex.begin(), carrierIndex.end(), packed,
+                          [](const CodeIndexEntry& entry, uint32_t key) { return entry.code < key; });
+    if (it != carrierIndex.end() && it->code == packed) {
+        return it->airport;
+    }
+    uint32_t id = static_cast<uint32_t>(carrierCodes.size());
+    carrierCodes.push_back(packed);
+    carrierIndex.insert(it, CodeIndexEntry{ packed, id });
+    return id;
+}
+
+int RouteTable::findCarrier(string_view code) const {
+    if (code.size() > 4) {
+        return -1;
+    }
+    uint32_t packed = packCode(code);
+    auto it = lower_bound(carrierIndex.begin(), carrierIndex.end(), packed,
+                          [](const CodeIndexEntry& entry, uint32_t key) { return entry.code < key; });
+    if (it == carrierIndex.end() || it->code != packed) {
+        return -1;
+    }
+    return static_cast<int>(it->airport);
+}
+
+bool RouteTable::appendRow(const CsvRow& columns) {
+    uint16_t day;
+    if (!parseRouteDate(columns[ROUTE_COL_DATE], day)) {
+        return false;
+    }
+    uint32_t origin = airports.internAirport(columns[ROUTE_COL_ORIGIN], AirportName(columns[ROUTE_COL_ORIGIN_NAME]));
+    uint32_t dest = airports.internAirport(columns[ROUTE_COL_DEST], AirportName(columns[ROUTE_COL_DEST_NAME]));
+    uint32_t carrier = internCarrier(columns[ROUTE_COL_CARRIER]);
+    if (origin > MAX_ROUTE_ID || dest > MAX_ROUTE_ID || carrier > MAX_ROUTE_ID) {
+        return false;
+    }
+    keys.push_back(routeKey(origin, dest, carrier, day));
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (hasColumn(c)) {
+            counters[c].push_back(parseInt(columns[routeColumnOf(c)]));
+        }
+    }
+    return true;
+}
+
+bool RouteTable::appendTable(const RouteTable& other) {
+    // Same id order as one pass over both tables, see AirportTable::appendTable
+    TableView local = other.airports.view();
+    vector<uint32_t> airportRemap(local.airports);
+    for (uint32_t id = 0; id < local.airports; id++) {
+        airportRemap[id] = airports.internAirport(local.airportCode(id), local.airportName(id));
+    }
+    vector<uint32_t> carrierRemap(other.carrierCodes.size());
+    for (uint32_t id = 0; id < other.carrierCodes.size(); id++) {
+        carrierRemap[id] = internCarrier(unpackCode(other.carrierCodes[id]));
+    }
+    if (airports.airportCount() > MAX_ROUTE_ID + 1 || carrierCodes.size() > MAX_ROUTE_ID + 1) {
+        return false;
+    }
+    for (uint64_t key : other.keys) {
+        keys.push_back(routeKey(airportRemap[routeOrigin(key)], airportRemap[routeDest(key)],
+                                carrierRemap[routeCarrier(key)], routeDay(key)));
+    }
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        counters[c].insert(counters[c].end(), other.counters[c].begin(), other.counters[c].end());
+    }
+    return true;
+}
+
+size_t RouteTable::memoryUsage() const {
+    size_t bytes = keys.capacity() * sizeof(uint64_t);
+    for (const auto& column : counters) {
+        bytes += column.capacity() * sizeof(int32_t);
+    }
+    bytes += airports.memoryUsage();
+    bytes += carrierCodes.capacity() * sizeof(uint32_t) + carrierIndex.capacity() * sizeof(CodeIndexEntry);
+    return bytes;
+}
+
+size_t routeColumnsFor(uint32_t projection) {
+    size_t columns = ROUTE_COL_DEST_NAME + 1;
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        if (c != CARRIERS_TOTAL && ((projection >> c) & 1)) {
+            columns = max(columns, routeColumnOf(c) + 1);
+        }
+    }
+    return columns;
+}
+
+bool buildRouteTableParallel(const string& filename, unsigned threads, uint32_t projection, RouteTable& routes,
+                             string& error) {
+    routes = RouteTable();
+    routes.projection = projection & ~(1u << CARRIERS_TOTAL);
+    MappedFile file(filename);
+    if (!file.isOpen()) {
+        error = "Cannot open " + filename;
+        return false;
+    }
+    if (threads == 0) {
+        threads = defaultThreadCount();
+    }
+    // More chunks than threads so one slow chunk does not hold up the other workers
+    vector<string_view> chunks = splitChunks(file.contents(), threads == 1 ? 1 : threads * 4);
+    vector<RouteTable> partials(chunks.size());
+    unique_ptr<bool[]> valid(new bool[chunks.size()]);
+    size_t columns = routeColumnsFor(routes.projection);
+    runOnWorkers(chunks.size(), threads, [&](size_t c) {
+        METRICS_TIMER(timer, STAGE_PARSE);
+        RouteTable& partial = partials[c];
+        partial.projection = routes.projection;
+        partial.reserve(countLines(chunks[c]));
+        valid[c] = true;
+        forEachCsvRow(chunks[c], [&](const CsvRow& row) {
+            valid[c] = partial.appendRow(row) && valid[c];
+        }, c == 0, columns);
+        METRICS_ITEMS(timer, partial.rowCount());
+    });
+
+    METRICS_TIMER(timer, STAGE_INSERT);
+    size_t rows = 0;
+    for (const auto& partial : partials) {
+        rows += partial.rowCount();
+    }
+    routes.reserve(rows);
+    METRICS_ITEMS(timer, rows);
+    for (size_t c = 0; c < partials.size(); c++) {
+        if (!valid[c] || !routes.appendTable(partials[c])) {
+            error = filename + ": a row has an invalid date, or there are more than 65535 airports or carriers";
+            routes = RouteTable();
+            return false;
+        }
+        partials[c] = RouteTable();
+    }
+    error.clear();
+    return true;
+}
+
+// Month of every day number, so a roll-up does not redo the calendar math per row
+static const uint16_t* periodOfDay() {
+    static const vector<uint16_t> periods = [] {
+        vector<uint16_t> table(1 << 16);
+        for (uint32_t d = 0; d < table.size(); d++) {
+            int year, month, day;
+            civilDate(static_cast<uint16_t>(d), year, month, day);
+            table[d] = periodKey(year, month);
+        }
+        return table;
+    }();
+    return periods.data();
+}
+
+// Airport-month cells of some rows: key is period << 16 | dest airport id
+struct MonthCells {
+    unordered_map<uint32_t, size_t> index;
+    vector<uint32_t> cells;
+    vector<CounterTotals> totals;
+    // cell << 16 | carrier, deduplicated whenever it doubles so it stays near the distinct count
+    vector<uint64_t> carriers;
+    size_t carriersKept = 0;
+
+    size_t cell(uint32_t key) {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            it = index.emplace(key, cells.size()).first;
+            cells.push_back(key);
+            totals.emplace_back();
+        }
+        return it->second;
+    }
+
+    void compactCarriers() {
+        sort(carriers.begin(), carriers.end());
+        carriers.erase(unique(carriers.begin(), carriers.end()), carriers.end());
+        carriersKept = carriers.size();
+    }
+};
+
+AirportTable rollUpAirportMonths(const RouteTable& routes, unsigned threads) {
+    METRICS_TIMER(timer, STAGE_AGGREGATE);
+    METRICS_ITEMS(timer, routes.rowCount());
+    if (threads == 0) {
+        threads = defaultThreadCount();
+    }
+    const uint16_t* periods = periodOfDay();
+    size_t rows = routes.rowCount();
+    size_t chunkCount = max<size_t>(1, min<size_t>(threads, rows / 65536 + 1));
+    vector<MonthCells> partials(chunkCount);
+    runOnWorkers(chunkCount, threads, [&](size_t c) {
+        MonthCells& partial = partials[c];
+        size_t begin = rows * c / chunkCount;
+        size_t end = rows * (c + 1) / chunkCount;
+        for (size_t i = begin; i < end; i++) {
+            uint64_t key = routes.keys[i];
+            uint32_t cellKey = static_cast<uint32_t>(periods[routeDay(key)]) << 16 | routeDest(key);
+            CounterTotals& totals = partial.totals[partial.cell(cellKey)];
+            for (int col = 0; col < COUNTER_COUNT; col++) {
+                if (routes.hasColumn(col)) {
+                    totals.sums[col] += routes.counters[col][i];
+                }
+            }
+            partial.carriers.push_back(static_cast<uint64_t>(cellKey) << 16 | routeCarrier(key));
+            if (partial.carriers.size() >= 2 * partial.carriersKept + 4096) {
+                partial.compactCarriers();
+            }
+        }
+        partial.compactCarriers();
+    });
+
+    // Merge the chunks, then order the cells by month and within a month by airport code
+    MonthCells merged = move(partials[0]);
+    for (size_t c = 1; c < partials.size(); c++) {
+        for (size_t i = 0; i < partials[c].cells.size(); i++) {
+            merged.totals[merged.cell(partials[c].cells[i])] += partials[c].totals[i];
+        }
+        merged.carriers.insert(merged.carriers.end(), partials[c].carriers.begin(), partials[c].carriers.end());
+        partials[c] = MonthCells();
+    }
+    merged.compactCarriers();
+    vector<size_t> carrierCounts(merged.cells.size(), 0);
+    for (uint64_t carrier : merged.carriers) {
+        carrierCounts[merged.index[static_cast<uint32_t>(carrier >> 16)]]++;
+    }
+    const vector<uint32_t>& codes = routes.airports.codes;
+    vector<size_t> order(merged.cells.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        uint32_t left = merged.cells[a];
+        uint32_t right = merged.cells[b];
+        if (left >> 16 != right >> 16) {
+            return left >> 16 < right >> 16;
+        }
+        return codes[left & 0xFFFF] < codes[right & 0xFFFF];
+    });
+
+    AirportTable table;
+    table.projection = routes.projection | (1u << CARRIERS_TOTAL);
+    table.reserve(order.size());
+    TableView dictionary = routes.airports.view();
+    for (size_t i : order) {
+        uint32_t cellKey = merged.cells[i];
+        uint32_t dest = cellKey & 0xFFFF;
+        int32_t values[COUNTER_COUNT];
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            // A month of an airport is far below the int32 limit in practice, clamp rather than wrap
+            values[c] = static_cast<int32_t>(min<long long>(merged.totals[i][c], INT_MAX));
+        }
+        values[CARRIERS_TOTAL] = static_cast<int32_t>(carrierCounts[i]);
+        uint32_t id = table.internAirport(dictionary.airportCode(dest), dictionary.airportName(dest));
+        table.appendRow(id, static_cast<uint16_t>(cellKey >> 16), values);
+    }
+    return table;
+}
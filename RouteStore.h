@@ -0,0 +1,92 @@
+#pragma once
+
+#include "ColumnStore.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct CsvRow;
+
+// Route-level feed: one row per carrier, origin-destination pair and day, e.g. the BTS
+// on-time data summed per day. Columns: date (YYYY-MM-DD or M/D/YYYY), carrier, origin,
+// origin_name, dest, dest_name ("City, ST: Name" like airlines.csv), then the counters in
+// CounterColumn order without carriers_total, which only exists per airport and month
+// The header names the counters like --columns does ("carrier_delays", ...)
+enum RouteCsvColumn {
+    ROUTE_COL_DATE,
+    ROUTE_COL_CARRIER,
+    ROUTE_COL_ORIGIN,
+    ROUTE_COL_ORIGIN_NAME,
+    ROUTE_COL_DEST,
+    ROUTE_COL_DEST_NAME,
+    ROUTE_COL_COUNTERS, // CARRIER_DELAYS, the others follow
+    ROUTE_COLUMN_COUNT = ROUTE_COL_COUNTERS + COUNTER_COUNT - 1
+};
+
+// Header line of a route feed, without the newline
+std::string routeCsvHeader();
+// True when the file starts with a route feed header
+bool isRouteFeed(const std::string& filename);
+
+// Days since 1970-01-01 and back; 16 bits cover 1970 to 2149
+uint16_t dayNumber(int year, int month, int day);
+void civilDate(uint16_t dayNumber, int& year, int& month, int& day);
+// "2015-06-30" or "6/30/2015" (anything after the date is ignored), false when invalid
+bool parseRouteDate(std::string_view text, uint16_t& dayNumber);
+
+// Composite key of a route row: origin, dest and carrier dictionary ids and the day,
+// 16 bits each, so a key is one integer that hashes and compares in one step
+// Ids stop at MAX_ROUTE_ID; all ones is never a valid key
+const uint32_t MAX_ROUTE_ID = 0xFFFE;
+const uint64_t NO_ROUTE_KEY = ~0ull;
+inline uint64_t routeKey(uint32_t origin, uint32_t dest, uint32_t carrier, uint16_t day) {
+    return static_cast<uint64_t>(origin) << 48 | static_cast<uint64_t>(dest) << 32 | static_cast<uint64_t>(carrier) << 16 |
+           day;
+}
+inline uint32_t routeOrigin(uint64_t key) { return static_cast<uint32_t>(key >> 48); }
+inline uint32_t routeDest(uint64_t key) { return static_cast<uint32_t>(key >> 32) & 0xFFFF; }
+inline uint32_t routeCarrier(uint64_t key) { return static_cast<uint32_t>(key >> 16) & 0xFFFF; }
+inline uint16_t routeDay(uint64_t key) { return static_cast<uint16_t>(key); }
+
+// Columnar route rows: the composite key and the projected counters of every row
+// Airports (origins and destinations share one dictionary) and carriers are interned
+struct RouteTable {
+    uint32_t projection = ALL_COUNTERS & ~(1u << CARRIERS_TOTAL);
+    std::vector<uint64_t> keys;
+    std::vector<int32_t> counters[COUNTER_COUNT];
+
+    AirportTable airports; // Dictionary only, it holds no rows
+    std::vector<uint32_t> carrierCodes;
+    std::vector<CodeIndexEntry> carrierIndex; // Sorted by code
+
+    size_t rowCount() const { return keys.size(); }
+    bool hasColumn(int column) const { return (projection >> column) & 1; }
+    void reserve(size_t rows);
+    // Returns the carrier id, adding it the first time
+    uint32_t internCarrier(std::string_view code);
+    // -1 when unknown
+    int findCarrier(std::string_view code) const;
+    // Parses one route feed row; false when a dictionary is full or the date is invalid
+    bool appendRow(const CsvRow& columns);
+    // Appends every row of a table with the same projection, re-keyed to this one's ids
+    bool appendTable(const RouteTable& other);
+    // Bytes held by the keys, the counters and the dictionaries
+    size_t memoryUsage() const;
+};
+
+// Number of leading route feed columns a row must be split into to load the projection
+size_t routeColumnsFor(uint32_t projection);
+
+// Parses the feed on `threads` workers; rows stay in file order
+// carriers_total is never loaded; false (with a message) when the feed has too many airports
+// or carriers for 16-bit ids or a row has a bad date
+bool buildRouteTableParallel(const std::string& filename, unsigned threads, uint32_t projection, RouteTable& routes,
+                             std::string& error);
+
+// Rolls the routes up to one row per destination airport and month, the airlines.csv view
+// (like the BTS delay cause data, an airport's flights are its arrivals)
+// carriers_total becomes the number of distinct carriers flying in that month
+// Rows come out in time order, every airport of a month and then the next month
+AirportTable rollUpAirportMonths(const RouteTable& routes, unsigned threads);
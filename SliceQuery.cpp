@@ -0,0 +1,494 @@
+#include "SliceQuery.h"
+#include "ColumnFile.h"
+#include "CsvLoader.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <tuple>
+
+using namespace std;
+
+static const char* const CAUSE_NAMES[WEATHER_DELAYS + 1] = { "carrier", "late", "navis", "security", "weather" };
+
+static bool startsWith(string_view text, string_view prefix) {
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+static bool airportMatches(const SliceQuery& query, string_view code) {
+    if (!startsWith(code, query.prefix)) {
+        return false;
+    }
+    return query.airports.empty() || find(query.airports.begin(), query.airports.end(), code) != query.airports.end();
+}
+
+static bool periodMatches(const SliceQuery& query, int year, int month) {
+    return year >= query.firstYear && year <= query.lastYear && ((query.monthMask >> month) & 1);
+}
+
+static bool groupLess(const SliceGroup& a, const SliceGroup& b) {
+    return tie(a.code, a.year, a.month, a.cause) < tie(b.code, b.year, b.month, b.cause);
+}
+
+// Splits every group into one per cause when asked to, then puts them in key order
+static SliceResult finish(SliceResult groups, unsigned groupBy) {
+    if (groupBy & GROUP_CAUSE) {
+        SliceResult expanded;
+        expanded.reserve(groups.size() * (WEATHER_DELAYS + 1));
+        for (const SliceGroup& group : groups) {
+            for (int cause = CARRIER_DELAYS; cause <= WEATHER_DELAYS; cause++) {
+                expanded.push_back(group);
+                expanded.back().cause = cause;
+            }
+        }
+        groups.swap(expanded);
+    }
+    sort(groups.begin(), groups.end(), groupLess);
+    return groups;
+}
+
+uint32_t sliceColumns(unsigned groupBy) {
+    uint32_t columns = REQUIRED_COUNTERS | (1u << DIVERTED_FLIGHTS) | (1u << DELAY_MINUTES);
+    if (groupBy & GROUP_CAUSE) {
+        for (int cause = CARRIER_DELAYS; cause <= WEATHER_DELAYS; cause++) {
+            columns |= (1u << cause) | (1u << (CARRIER_MINUTES + cause));
+        }
+    }
+    return columns;
+}
+
+const size_t SLICE_BLOCK = 1024;
+
+// Dense group slots: airport x year x month, each axis collapsed to one slot when not grouped on
+// Filled a block of at most SLICE_BLOCK rows at a time
+class SliceSlots {
+public:
+    // lowestYear / highestYear bound the years in the data, they narrow the year axis
+    SliceSlots(const TableView& dictionary, const SliceQuery& query, int lowestYear, int highestYear)
+        : query(query), selected(dictionary.airports) {
+        for (uint32_t id = 0; id < dictionary.airports; id++) {
+            selected[id] = airportMatches(query, dictionary.airportCode(id));
+        }
+        firstYear = query.firstYear;
+        lastYear = query.lastYear;
+        if (query.groupBy & GROUP_YEAR) {
+            firstYear = max(firstYear, lowestYear);
+            lastYear = min(lastYear, highestYear);
+        }
+        if (firstYear > lastYear) {
+            return;
+        }
+        airportSlots = (query.groupBy & GROUP_AIRPORT) ? max<size_t>(dictionary.airports, 1) : 1;
+        yearSlots = (query.groupBy & GROUP_YEAR) ? static_cast<size_t>(lastYear - firstYear + 1) : 1;
+        monthSlots = (query.groupBy & GROUP_MONTH) ? 12 : 1;
+        sums.resize(airportSlots * yearSlots * monthSlots);
+        rows.resize(sums.size());
+    }
+
+    bool empty() const { return sums.empty(); }
+    bool isSelected(uint32_t airport) const { return selected[airport] != 0; }
+
+    // Adds rows [begin, end) of the table; counters that are null in the view are skipped
+    void addBlock(const TableView& table, size_t begin, size_t end) {
+        const int32_t* total = table.counters[TOTAL_FLIGHTS];
+        uint32_t selection[SLICE_BLOCK];
+        uint32_t slot[SLICE_BLOCK];
+        size_t count = 0;
+        for (size_t i = begin; i < end; i++) {
+            uint32_t airport = table.airport[i];
+            int year = periodYear(table.period[i]);
+            int month = periodMonth(table.period[i]);
+            // The slot range, already narrowed to the query's years, also keeps a period the
+            // zone maps did not account for out of the slots
+            if (!selected[airport] || year < firstYear || year > lastYear || !((query.monthMask >> month) & 1) ||
+                total[i] < query.minFlights) {
+                continue;
+            }
+            size_t a = airportSlots > 1 ? airport : 0;
+            size_t y = yearSlots > 1 ? static_cast<size_t>(year - firstYear) : 0;
+            size_t m = monthSlots > 1 ? static_cast<size_t>(month - 1) : 0;
+            selection[count] = static_cast<uint32_t>(i);
+            slot[count] = static_cast<uint32_t>((a * yearSlots + y) * monthSlots + m);
+            count++;
+        }
+        // Column at a time over the selection, so each inner loop touches one array
+        // Runs of rows going to the same group (the usual case, rows come grouped by
+        // airport and time) are summed in a register before touching the group
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            const int32_t* column = table.counters[c];
+            if (column == nullptr) {
+                continue;
+            }
+            for (size_t k = 0; k < count;) {
+                uint32_t target = slot[k];
+                long long sum = 0;
+                do {
+                    sum += column[selection[k]];
+                    k++;
+                } while (k < count && slot[k] == target);
+                sums[target].sums[c] += sum;
+            }
+        }
+        for (size_t k = 0; k < count; k++) {
+            rows[slot[k]]++;
+        }
+    }
+
+    SliceResult groups(const TableView& dictionary) const {
+        SliceResult groups;
+        for (size_t s = 0; s < sums.size(); s++) {
+            if (rows[s] == 0) {
+                continue;
+            }
+            SliceGroup group;
+            size_t a = s / (yearSlots * monthSlots);
+            if (query.groupBy & GROUP_AIRPORT) {
+                group.code = dictionary.airportCode(static_cast<uint32_t>(a));
+            }
+            if (query.groupBy & GROUP_YEAR) {
+                group.year = firstYear + static_cast<int>(s / monthSlots % yearSlots);
+            }
+            if (query.groupBy & GROUP_MONTH) {
+                group.month = static_cast<int>(s % monthSlots) + 1;
+            }
+            group.totals = sums[s];
+            group.rows = rows[s];
+            groups.push_back(move(group));
+        }
+        return finish(move(groups), query.groupBy);
+    }
+
+private:
+    const SliceQuery& query;
+    vector<char> selected;
+    int firstYear = 0;
+    int lastYear = 0;
+    size_t airportSlots = 1;
+    size_t yearSlots = 1;
+    size_t monthSlots = 1;
+    vector<CounterTotals> sums;
+    vector<long long> rows;
+};
+
+// Slices not grouped by time and without a flight floor are per-airport sums under a month
+// and year filter, which is what the counter kernels compute; `selected` flags the airports
+static SliceResult sliceWithKernels(const TableView& table, const SliceQuery& query, const vector<char>& selected) {
+    RowFilter filter;
+    filter.monthMask = query.monthMask;
+    filter.firstYear = query.firstYear;
+    filter.lastYear = query.lastYear;
+    SliceResult groups;
+    size_t selectedCount = static_cast<size_t>(count(selected.begin(), selected.end(), 1));
+    if (!(query.groupBy & GROUP_AIRPORT) && (selectedCount == table.airports || selectedCount == 1)) {
+        if (selectedCount == 1) {
+            filter.airport = static_cast<int>(find(selected.begin(), selected.end(), 1) - selected.begin());
+        }
+        RowTotals totals = sumCounters(table, filter);
+        if (totals.rows > 0) {
+            groups.push_back(SliceGroup());
+            groups.back().totals = totals.totals;
+            groups.back().rows = totals.rows;
+        }
+        return finish(move(groups), query.groupBy);
+    }
+    vector<RowTotals> perAirport = sumCountersByAirport(table, filter);
+    SliceGroup all;
+    for (uint32_t id = 0; id < table.airports; id++) {
+        if (!selected[id] || perAirport[id].rows == 0) {
+            continue;
+        }
+        SliceGroup* group = &all;
+        if (query.groupBy & GROUP_AIRPORT) {
+            group = &groups.emplace_back();
+            group->code = table.airportCode(id);
+        }
+        group->totals += perAirport[id].totals;
+        group->rows += perAirport[id].rows;
+    }
+    if (all.rows > 0) {
+        groups.push_back(move(all));
+    }
+    return finish(move(groups), query.groupBy);
+}
+
+SliceResult runSlice(const TableView& table, const SliceQuery& query) {
+    METRICS_TIMER(timer, STAGE_AGGREGATE);
+    METRICS_ITEMS(timer, table.rows);
+    if (!(query.groupBy & (GROUP_YEAR | GROUP_MONTH)) && query.minFlights <= 0) {
+        vector<char> selected(table.airports);
+        for (uint32_t id = 0; id < table.airports; id++) {
+            selected[id] = airportMatches(query, table.airportCode(id));
+        }
+        return sliceWithKernels(table, query, selected);
+    }
+    int lowest = 4095;
+    int highest = 0;
+    if (query.groupBy & GROUP_YEAR) {
+        for (size_t i = 0; i < table.rows; i++) {
+            lowest = min(lowest, periodYear(table.period[i]));
+            highest = max(highest, periodYear(table.period[i]));
+        }
+    }
+    SliceSlots slots(table, query, lowest, highest);
+    if (slots.empty()) {
+        return SliceResult();
+    }
+    for (size_t begin = 0; begin < table.rows; begin += SLICE_BLOCK) {
+        slots.addBlock(table, begin, min(begin + SLICE_BLOCK, table.rows));
+    }
+    return slots.groups(table);
+}
+
+SliceResult runSlice(const ColumnFile& file, const SliceQuery& query, size_t* scannedBlocks) {
+    METRICS_TIMER(timer, STAGE_AGGREGATE);
+    const TableView& dictionary = file.dictionary();
+    int lowest = 4095;
+    int highest = 0;
+    for (size_t b = 0; b < file.blockCount(); b++) {
+        lowest = min(lowest, periodYear(file.block(b).minPeriod));
+        highest = max(highest, periodYear(file.block(b).maxPeriod));
+    }
+    SliceSlots slots(dictionary, query, lowest, highest);
+    if (scannedBlocks != nullptr) {
+        *scannedBlocks = 0;
+    }
+    if (slots.empty()) {
+        return SliceResult();
+    }
+    // Codes of the selected airports, ascending since the file's ids are in code order
+    vector<uint32_t> codes;
+    for (uint32_t id = 0; id < dictionary.airports; id++) {
+        if (slots.isSelected(id)) {
+            codes.push_back(dictionary.codes[id]);
+        }
+    }
+
+    uint32_t projection = sliceColumns(query.groupBy);
+    ColumnBlockData data;
+    for (size_t b = 0; b < file.blockCount(); b++) {
+        // Zone map checks: a block is only decoded when some row in it can match
+        const ColumnBlockInfo& info = file.block(b);
+        if (periodYear(info.maxPeriod) < query.firstYear || periodYear(info.minPeriod) > query.lastYear ||
+            (info.monthMask & query.monthMask) == 0 || info.maxTotal < query.minFlights) {
+            continue;
+        }
+        auto code = lower_bound(codes.begin(), codes.end(), info.minCode);
+        if (code == codes.end() || *code > info.maxCode) {
+            continue;
+        }
+        TableView block = file.decodeBlock(b, projection, data);
+        slots.addBlock(block, 0, block.rows);
+        METRICS_ITEMS(timer, block.rows);
+        if (scannedBlocks != nullptr) {
+            (*scannedBlocks)++;
+        }
+    }
+    return slots.groups(dictionary);
+}
+
+// Shared by the row-based backends; forEachAirport(visit) calls visit(code, records)
+// at least for every airport the query can match
+template <typename ForEachAirport>
+static SliceResult sliceRecords(const SliceQuery& query, ForEachAirport&& forEachAirport) {
+    METRICS_TIMER(timer, STAGE_AGGREGATE);
+    map<tuple<string, int, int>, SliceGroup> groups;
+    forEachAirport([&](const string& code, AirportRecords records) {
+        METRICS_ITEMS(timer, records.count);
+        if (!airportMatches(query, code)) {
+            return;
+        }
+        for (const AirportData& data : records) {
+            int year = parseInt(data.year);
+            int month = monthNumber(data.month);
+            if (!periodMatches(query, year, month) || data.total_flights < query.minFlights) {
+                continue;
+            }
+            tuple<string, int, int> key((query.groupBy & GROUP_AIRPORT) ? code : string(),
+                                        (query.groupBy & GROUP_YEAR) ? year : 0, (query.groupBy & GROUP_MONTH) ? month : 0);
+            SliceGroup& group = groups[key];
+            long long* sums = group.totals.sums;
+            sums[CARRIER_DELAYS] += data.carrier;
+            sums[LATE_DELAYS] += data.late;
+            sums[NAVIS_DELAYS] += data.navis;
+            sums[SECURITY_DELAYS] += data.security;
+            sums[WEATHER_DELAYS] += data.weather;
+            sums[CANCELED_FLIGHTS] += data.canceled;
+            sums[DELAYED_FLIGHTS] += data.delayed;
+            sums[TOTAL_FLIGHTS] += data.total_flights;
+            group.rows++;
+        }
+    });
+    SliceResult result;
+    for (auto& entry : groups) {
+        entry.second.code = get<0>(entry.first);
+        entry.second.year = get<1>(entry.first);
+        entry.second.month = get<2>(entry.first);
+        result.push_back(move(entry.second));
+    }
+    return finish(move(result), query.groupBy);
+}
+
+SliceResult runSlice(const unordered_map<string, vector<AirportData>>& data, const SliceQuery& query) {
+    return sliceRecords(query, [&](auto&& visit) {
+        if (!query.airports.empty()) {
+            for (const string& code : query.airports) {
+                auto it = data.find(code);
+                if (it != data.end()) {
+                    visit(it->first, AirportRecords{ it->second.data(), it->second.size() });
+                }
+            }
+            return;
+        }
+        for (const auto& airport : data) {
+            visit(airport.first, AirportRecords{ airport.second.data(), airport.second.size() });
+        }
+    });
+}
+
+// Every code stored under the node, `code` being the path to it
+template <typename Visit>
+static void visitSubtree(TrieNode* node, string& code, Visit& visit) {
+    if (!node->airport_data.empty()) {
+        visit(code, AirportRecords{ node->airport_data.data(), node->airport_data.size() });
+    }
+    for (const auto& child : node->children) {
+        code.push_back(child.first);
+        visitSubtree(child.second, code, visit);
+        code.pop_back();
+    }
+}
+
+SliceResult runSlice(TrieNode* root, const SliceQuery& query) {
+    return sliceRecords(query, [&](auto&& visit) {
+        if (!query.airports.empty()) {
+            for (const string& code : query.airports) {
+                visit(code, findTrie(root, code));
+            }
+            return;
+        }
+        // Only the subtree under the prefix can match
+        TrieNode* node = root;
+        for (char c : query.prefix) {
+            auto it = node->children.find(c);
+            if (it == node->children.end()) {
+                return;
+            }
+            node = it->second;
+        }
+        string code = query.prefix;
+        visitSubtree(node, code, visit);
+    });
+}
+
+// Calls onItem for every comma separated item, stops at the first one it rejects
+template <typename OnItem>
+static bool forEachItem(string_view list, OnItem&& onItem) {
+    while (!list.empty()) {
+        size_t comma = min(list.find(','), list.size());
+        if (!onItem(list.substr(0, comma))) {
+            return false;
+        }
+        list.remove_prefix(min(comma + 1, list.size()));
+    }
+    return true;
+}
+
+bool parseSliceGroups(string_view list, unsigned& groupBy) {
+    groupBy = 0;
+    return forEachItem(list, [&](string_view name) {
+        if (name == "airport") {
+            groupBy |= GROUP_AIRPORT;
+        }
+        else if (name == "year") {
+            groupBy |= GROUP_YEAR;
+        }
+        else if (name == "month") {
+            groupBy |= GROUP_MONTH;
+        }
+        else if (name == "cause") {
+            groupBy |= GROUP_CAUSE;
+        }
+        else {
+            return false;
+        }
+        return true;
+    });
+}
+
+bool parseMonthSet(string_view list, uint16_t& monthMask) {
+    monthMask = 0;
+    return forEachItem(list, [&](string_view name) {
+        int month = isdigit(static_cast<unsigned char>(name.empty() ? 'x' : name[0])) ? parseInt(name) : monthNumber(name);
+        if (month < 1 || month > 12) {
+            return false;
+        }
+        monthMask |= static_cast<uint16_t>(1 << month);
+        return true;
+    });
+}
+
+bool parseYearRange(string_view text, int& firstYear, int& lastYear) {
+    size_t dash = text.find('-');
+    firstYear = parseInt(text.substr(0, dash));
+    lastYear = dash == string_view::npos ? firstYear : parseInt(text.substr(dash + 1));
+    return firstYear > 0 && firstYear <= lastYear;
+}
+
+void writeSliceCsv(const SliceResult& result, unsigned groupBy, uint32_t columns, BufferedWriter& out) {
+    METRICS_TIMER(timer, STAGE_FORMAT);
+    METRICS_ITEMS(timer, result.size() + 1);
+    if (groupBy & GROUP_AIRPORT) {
+        out.write("code,");
+    }
+    if (groupBy & GROUP_YEAR) {
+        out.write("year,");
+    }
+    if (groupBy & GROUP_MONTH) {
+        out.write("month,");
+    }
+    if (groupBy & GROUP_CAUSE) {
+        out.write("cause,delays,share_of_delays,minutes,share_of_minutes,");
+    }
+    out.write("rows,total_flights,delayed_flights,canceled_flights,diverted_flights,delay_rate,avg_delay_minutes\n");
+    for (const SliceGroup& group : result) {
+        const CounterTotals& totals = group.totals;
+        if (groupBy & GROUP_AIRPORT) {
+            out.write(group.code).write(',');
+        }
+        if (groupBy & GROUP_YEAR) {
+            out.write(static_cast<long long>(group.year)).write(',');
+        }
+        if (groupBy & GROUP_MONTH) {
+            out.write(monthName(group.month)).write(',');
+        }
+        if (groupBy & GROUP_CAUSE) {
+            long long causes = 0;
+            for (int c = CARRIER_DELAYS; c <= WEATHER_DELAYS; c++) {
+                causes += totals[c];
+            }
+            CounterColumn minutes = static_cast<CounterColumn>(CARRIER_MINUTES + group.cause);
+            out.write(CAUSE_NAMES[group.cause]).write(',').write(totals[group.cause]).write(',');
+            out.write(causes == 0 ? 0.0 : static_cast<double>(totals[group.cause]) / causes * 100.0, 4).write(',');
+            bool hasMinutes = (columns >> minutes) & 1;
+            if (hasMinutes) {
+                out.write(totals[minutes]);
+            }
+            out.write(',');
+            if (hasMinutes && ((columns >> DELAY_MINUTES) & 1)) {
+                out.write(minuteShare(totals, minutes), 4);
+            }
+            out.write(',');
+        }
+        out.write(group.rows).write(',').write(totals[TOTAL_FLIGHTS]).write(',').write(totals[DELAYED_FLIGHTS]).write(',');
+        out.write(totals[CANCELED_FLIGHTS]).write(',');
+        if ((columns >> DIVERTED_FLIGHTS) & 1) {
+            out.write(totals[DIVERTED_FLIGHTS]);
+        }
+        out.write(',').write(delayRate(totals), 4).write(',');
+        if ((columns >> DELAY_MINUTES) & 1) {
+            out.write(averageDelayMinutes(totals), 2);
+        }
+        out.write('\n');
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "AirportData.h"
+#include "BufferedWriter.h"
+#include "CompactTrie.h"
+#include "Kernels.h"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Keys a slice can be grouped by, combined as a bit set
+enum SliceGroupKey {
+    GROUP_AIRPORT = 1,
+    GROUP_YEAR = 2,
+    GROUP_MONTH = 4,
+    GROUP_CAUSE = 8 // One result per delay cause instead of one per group
+};
+
+class ColumnFile;
+
+// Ad-hoc slice of the data: which rows to keep and how to group them
+// Every predicate must hold for a row to be counted
+struct SliceQuery {
+    std::vector<std::string> airports; // Codes to keep, empty for every airport
+    std::string prefix;                // Code prefix to keep, empty for every airport
+    int firstYear = 0;
+    int lastYear = 4095;
+    uint16_t monthMask = ALL_MONTHS;   // Bits 1-12
+    long long minFlights = 0;          // Rows with fewer total flights are dropped
+    unsigned groupBy = 0;
+};
+
+// One output row; keys that are not grouped on are "" / 0 / -1
+struct SliceGroup {
+    std::string code;
+    int year = 0;
+    int month = 0;
+    int cause = -1; // CARRIER_DELAYS..WEATHER_DELAYS
+    CounterTotals totals;
+    long long rows = 0;
+};
+
+// Groups sorted by code, year, month, cause
+using SliceResult = std::vector<SliceGroup>;
+
+// The same query over each backend, with the same result
+// The columnar one is a single fused scan: each block of rows is filtered into a
+// selection of (row, group) pairs, then every counter column is summed over that
+// selection in a tight loop. Slices not grouped by year or month and without a flight
+// floor come from the counter kernels (Kernels.h) instead. The row-based ones only count
+// the eight counters of AirportData (DELAY_COUNTERS), the other sums stay 0 there
+SliceResult runSlice(const TableView& table, const SliceQuery& query);
+SliceResult runSlice(const std::unordered_map<std::string, std::vector<AirportData>>& data, const SliceQuery& query);
+SliceResult runSlice(TrieNode* root, const SliceQuery& query);
+// Same scan over a column file: blocks whose zone map rules out the year, month, airport
+// and flight filters are skipped, the others have only sliceColumns() decoded
+// scannedBlocks (when given) gets the number of blocks decoded
+SliceResult runSlice(const ColumnFile& file, const SliceQuery& query, size_t* scannedBlocks = nullptr);
+
+// Counter columns a result grouped by groupBy needs for writeSliceCsv
+uint32_t sliceColumns(unsigned groupBy);
+
+// Parsers for the command line, false on bad input
+// Group keys: "airport,year,month,cause"; months: names or 1-12; years: "2005" or "2005-2010"
+bool parseSliceGroups(std::string_view list, unsigned& groupBy);
+bool parseMonthSet(std::string_view list, uint16_t& monthMask);
+bool parseYearRange(std::string_view text, int& firstYear, int& lastYear);
+
+// CSV with a column for each grouped key followed by the sums and rates
+// `columns` are the counters the backend summed; a field that needs any other is left empty
+void writeSliceCsv(const SliceResult& result, unsigned groupBy, uint32_t columns, BufferedWriter& out);
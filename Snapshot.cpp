@@ -0,0 +1,290 @@
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+using namespace std;
+
+static const char SNAPSHOT_MAGIC[8] = { 'A', 'I', 'R', 'S', 'N', 'A', 'P', '\0' };
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+static const uint64_t SECTION_ALIGNMENT = 64;
+
+// Section order in the file
+enum SnapshotSection {
+    SECTION_AIRPORT,
+    SECTION_PERIOD,
+    SECTION_CODES,
+    SECTION_NAME_OFFSETS,
+    SECTION_NAME_BLOB,
+    SECTION_CODE_INDEX,
+    SECTION_CUBE,
+    SECTION_COUNTERS // One per counter column from here on
+};
+
+// FNV-1a over 64-bit words (the tail is zero padded), fast enough to run over the whole file
+static uint64_t checksum(const char* data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0x100000001B3ull;
+    }
+    if (i < size) {
+        uint64_t word = 0;
+        memcpy(&word, data + i, size - i);
+        hash = (hash ^ word) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// Streams the payload to disk while folding it into the same checksum as above,
+// so writing a large table does not need a second copy of it in memory
+class ChecksumWriter {
+public:
+    explicit ChecksumWriter(ofstream& out) : out(out) {}
+
+    void write(const char* data, size_t size) {
+        out.write(data, size);
+        while (size > 0) {
+            size_t take = min(size, sizeof(carry) - carried);
+            memcpy(carry + carried, data, take);
+            carried += take;
+            data += take;
+            size -= take;
+            if (carried == sizeof(carry)) {
+                uint64_t word;
+                memcpy(&word, carry, 8);
+                hash = (hash ^ word) * 0x100000001B3ull;
+                carried = 0;
+            }
+        }
+    }
+    void pad(size_t size) {
+        static const char zeros[SECTION_PAD_CHUNK] = {};
+        while (size > 0) {
+            size_t take = min(size, sizeof(zeros));
+            write(zeros, take);
+            size -= take;
+        }
+    }
+    uint64_t finish() {
+        if (carried > 0) {
+            memset(carry + carried, 0, sizeof(carry) - carried);
+            uint64_t word;
+            memcpy(&word, carry, 8);
+            hash = (hash ^ word) * 0x100000001B3ull;
+            carried = 0;
+        }
+        return hash;
+    }
+
+private:
+    static const size_t SECTION_PAD_CHUNK = 64;
+    ofstream& out;
+    uint64_t hash = 0xCBF29CE484222325ull;
+    char carry[8];
+    size_t carried = 0;
+};
+
+static uint64_t alignUp(uint64_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+// Byte size of every section for a table and cube of the given shape
+static void sectionSizes(uint64_t rows, uint64_t airports, uint64_t nameBytes, uint64_t cubeYearStride,
+                         uint64_t sizes[SNAPSHOT_SECTIONS]) {
+    sizes[SECTION_AIRPORT] = rows * sizeof(uint32_t);
+    sizes[SECTION_PERIOD] = rows * sizeof(uint16_t);
+    sizes[SECTION_CODES] = airports * sizeof(uint32_t);
+    sizes[SECTION_NAME_OFFSETS] = (airports + 1) * sizeof(uint32_t);
+    sizes[SECTION_NAME_BLOB] = nameBytes;
+    sizes[SECTION_CODE_INDEX] = airports * sizeof(CodeIndexEntry);
+    sizes[SECTION_CUBE] = (airports + 1) * cubeYearStride * 13 * sizeof(CubeCell);
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        sizes[SECTION_COUNTERS + c] = rows * sizeof(int32_t);
+    }
+}
+
+bool writeSnapshot(const TableView& table, const AggregateCube& cube, const string& filename, string& error) {
+    if (cube.airportCount() != table.airports) {
+        error = "Cannot write a snapshot with a cube of another table";
+        return false;
+    }
+    uint64_t nameBytes = table.nameOffsets == nullptr ? 0 : table.nameOffsets[table.airports];
+    const void* sources[SNAPSHOT_SECTIONS];
+    sources[SECTION_AIRPORT] = table.airport;
+    sources[SECTION_PERIOD] = table.period;
+    sources[SECTION_CODES] = table.codes;
+    sources[SECTION_NAME_OFFSETS] = table.nameOffsets;
+    sources[SECTION_NAME_BLOB] = table.nameBlob;
+    sources[SECTION_CODE_INDEX] = table.codeIndex;
+    sources[SECTION_CUBE] = cube.cellData();
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        sources[SECTION_COUNTERS + c] = table.counters[c];
+        if (table.counters[c] == nullptr && table.rows > 0) {
+            error = "Cannot write a snapshot of a table with missing columns";
+            return false;
+        }
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.rows = table.rows;
+    header.airports = table.airports;
+    header.nameBytes = nameBytes;
+    header.cubeMinYear = cube.firstYear();
+    header.cubeMaxYear = cube.lastYear();
+    header.cubeYearStride = cube.yearCapacity();
+
+    // Lay the sections out
+    uint64_t sizes[SNAPSHOT_SECTIONS];
+    sectionSizes(header.rows, header.airports, header.nameBytes, header.cubeYearStride, sizes);
+    uint64_t offset = alignUp(sizeof(SnapshotHeader));
+    for (int s = 0; s < SNAPSHOT_SECTIONS; s++) {
+        header.sections[s] = offset;
+        offset = alignUp(offset + sizes[s]);
+    }
+    header.fileSize = offset;
+
+    ofstream out(filename, ios::binary | ios::trunc);
+    if (!out) {
+        error = "Cannot open " + filename + " for writing";
+        return false;
+    }
+    // Placeholder header first, the real one (with the checksums) is written at the end
+    vector<char> headerBlock(header.sections[0], 0);
+    out.write(headerBlock.data(), headerBlock.size());
+    ChecksumWriter payload(out);
+    for (int s = 0; s < SNAPSHOT_SECTIONS; s++) {
+        if (sizes[s] > 0) {
+            payload.write(static_cast<const char*>(sources[s]), sizes[s]);
+        }
+        uint64_t end = s + 1 < SNAPSHOT_SECTIONS ? header.sections[s + 1] : header.fileSize;
+        payload.pad(end - header.sections[s] - sizes[s]);
+    }
+    header.payloadChecksum = payload.finish();
+    header.headerChecksum = checksum(reinterpret_cast<const char*>(&header), offsetof(SnapshotHeader, headerChecksum));
+    memcpy(headerBlock.data(), &header, sizeof(header));
+    out.seekp(0);
+    out.write(headerBlock.data(), headerBlock.size());
+    out.flush();
+    if (!out) {
+        error = "Failed writing " + filename;
+        return false;
+    }
+    return true;
+}
+
+// Ids and offsets other code indexes with, without bounds checks of its own
+static bool validIndexes(const TableView& table, uint64_t nameBytes) {
+    for (size_t i = 0; i < table.rows; i++) {
+        if (table.airport[i] >= table.airports) {
+            return false;
+        }
+    }
+    return table.validDictionary(nameBytes);
+}
+
+// Years fit the 12 bits of a period; an empty cube has the year range 1..0 and one slot
+static bool validCubeShape(const SnapshotHeader& header) {
+    if (header.cubeMinYear > header.cubeMaxYear) {
+        return header.cubeMinYear == 1 && header.cubeMaxYear == 0 && header.cubeYearStride >= 1 &&
+               header.cubeYearStride <= 4097;
+    }
+    return header.cubeMinYear >= 0 && header.cubeMaxYear <= 4095 &&
+           header.cubeYearStride >= static_cast<uint64_t>(header.cubeMaxYear - header.cubeMinYear + 2) &&
+           header.cubeYearStride <= 4097;
+}
+
+bool Snapshot::open(const string& filename, bool verifyPayload, string& error) {
+    file = MappedFile(filename);
+    table = TableView();
+    cubeCells = nullptr;
+    error.clear();
+    string_view contents = file.contents();
+    if (!file.isOpen()) {
+        error = "Cannot open snapshot " + filename;
+        return false;
+    }
+    SnapshotHeader header;
+    if (contents.size() < sizeof(header)) {
+        error = filename + " is too small to be a snapshot";
+        file = MappedFile();
+        return false;
+    }
+    memcpy(&header, contents.data(), sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        error = filename + " is not a snapshot file";
+    }
+    else if (header.byteOrder != BYTE_ORDER_MARK) {
+        error = filename + " was written on a machine with a different byte order";
+    }
+    else if (header.version != SNAPSHOT_VERSION) {
+        error = filename + " is snapshot version " + to_string(header.version) + ", expected " + to_string(SNAPSHOT_VERSION) +
+                " (rebuild it with --build-snapshot)";
+    }
+    else if (header.headerChecksum != checksum(contents.data(), offsetof(SnapshotHeader, headerChecksum))) {
+        error = filename + " has a corrupt header";
+    }
+    else if (header.fileSize != contents.size()) {
+        error = filename + " is truncated";
+    }
+    else if (!validCubeShape(header)) {
+        error = filename + " has a bad cube shape";
+    }
+    else {
+        uint64_t sizes[SNAPSHOT_SECTIONS];
+        sectionSizes(header.rows, header.airports, header.nameBytes, header.cubeYearStride, sizes);
+        for (int s = 0; s < SNAPSHOT_SECTIONS && error.empty(); s++) {
+            if (header.sections[s] % SECTION_ALIGNMENT != 0 || header.sections[s] + sizes[s] > header.fileSize) {
+                error = filename + " has a bad section table";
+            }
+        }
+        if (error.empty() && verifyPayload) {
+            uint64_t start = header.sections[0];
+            if (header.payloadChecksum != checksum(contents.data() + start, contents.size() - start)) {
+                error = filename + " failed its checksum";
+            }
+        }
+    }
+    if (!error.empty()) {
+        file = MappedFile();
+        return false;
+    }
+
+    const char* base = contents.data();
+    table.rows = header.rows;
+    table.airports = header.airports;
+    table.airport = reinterpret_cast<const uint32_t*>(base + header.sections[SECTION_AIRPORT]);
+    table.period = reinterpret_cast<const uint16_t*>(base + header.sections[SECTION_PERIOD]);
+    table.codes = reinterpret_cast<const uint32_t*>(base + header.sections[SECTION_CODES]);
+    table.nameOffsets = reinterpret_cast<const uint32_t*>(base + header.sections[SECTION_NAME_OFFSETS]);
+    table.nameBlob = base + header.sections[SECTION_NAME_BLOB];
+    table.codeIndex = reinterpret_cast<const CodeIndexEntry*>(base + header.sections[SECTION_CODE_INDEX]);
+    cubeCells = reinterpret_cast<const CubeCell*>(base + header.sections[SECTION_CUBE]);
+    cubeMinYear = header.cubeMinYear;
+    cubeMaxYear = header.cubeMaxYear;
+    cubeYearStride = static_cast<size_t>(header.cubeYearStride);
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        table.counters[c] = reinterpret_cast<const int32_t*>(base + header.sections[SECTION_COUNTERS + c]);
+    }
+    if (!validIndexes(table, header.nameBytes)) {
+        error = filename + " has a corrupt payload";
+        table = TableView();
+        cubeCells = nullptr;
+        file = MappedFile();
+        return false;
+    }
+    return true;
+}
+
+AggregateCube Snapshot::cube() const {
+    return AggregateCube(cubeCells, table.airports, cubeMinYear, cubeMaxYear, cubeYearStride);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "AggregateCube.h"
+#include "ColumnStore.h"
+#include "CsvLoader.h"
+
+#include <cstdint>
+#include <string>
+
+// Binary snapshot of a parsed dataset: the counter columns, the airport dictionary, the
+// code index and the aggregate cube cells, each section 64-byte aligned so the mapped file
+// is used in place, the cube included
+// Sections are stored in native byte order; a file written on a machine with the other
+// byte order is rejected rather than converted
+const uint32_t SNAPSHOT_VERSION = 3;
+const int SNAPSHOT_SECTIONS = 7 + COUNTER_COUNT;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t rows;
+    uint64_t airports;
+    uint64_t nameBytes;
+    int32_t cubeMinYear;
+    int32_t cubeMaxYear;
+    uint64_t cubeYearStride;
+    uint64_t fileSize;
+    uint64_t payloadChecksum;           // Over every byte after the header
+    uint64_t sections[SNAPSHOT_SECTIONS]; // File offset of each section
+    uint64_t headerChecksum;            // Over the header fields above
+};
+
+// Function to write the table and its cube as a snapshot, returns false (with a message) on failure
+bool writeSnapshot(const TableView& table, const AggregateCube& cube, const std::string& filename, std::string& error);
+
+// A mapped snapshot; view() points straight into the mapping, nothing is deserialized
+class Snapshot {
+public:
+    // The header is always validated, and so is everything used as an index (row airport
+    // ids, name offsets, the code index), so a corrupt payload cannot make a reader go out
+    // of bounds; the payload checksum reads the whole file, so it is only checked when asked for
+    bool open(const std::string& filename, bool verifyPayload, std::string& error);
+    bool isOpen() const { return file.isOpen(); }
+    const TableView& view() const { return table; }
+    // The stored cube over the mapped cells; valid while the snapshot stays open
+    AggregateCube cube() const;
+    size_t fileSize() const { return file.contents().size(); }
+    // Bytes of the file that are not cube cells
+    size_t tableBytes() const {
+        return fileSize() - (cubeCells == nullptr ? 0 : (table.airports + 1) * cubeYearStride * 13 * sizeof(CubeCell));
+    }
+
+private:
+    MappedFile file;
+    TableView table;
+    const CubeCell* cubeCells = nullptr;
+    int cubeMinYear = 1;
+    int cubeMaxYear = 0;
+    size_t cubeYearStride = 1;
+};
@@ -1,137 +1,202 @@
 #include <iostream>
 #include <vector>
-#include <fstream>
-#include <sstream>
 #include <unordered_map>
 #include <string>
 #include <iomanip>
 #include <algorithm>
 #include <set>
 #include <map>
+#include <charconv>
 #include <chrono>
+#include <cmath>
 #include <cstdlib>
-#include <queue>
+#include <string_view>
+#include <memory>
+#include <thread>
+#include <sstream>
+
+#include "AirportData.h"
+#include "AggregateCube.h"
+#include "AirportSearch.h"
+#include "BatchQuery.h"
+#include "BenchHarness.h"
+#include "Benchmark.h"
+#include "BufferedWriter.h"
+#include "ColumnFile.h"
+#include "ColumnStore.h"
+#include "CompactTrie.h"
+#include "CsvLoader.h"
+#include "Dataset.h"
+#include "FlatIndex.h"
+#include "Generator.h"
+#include "GzipReader.h"
+#include "IncrementalLoader.h"
+#include "MemoryTracker.h"
+#include "Metrics.h"
+#include "ParallelLoader.h"
+#include "PipelinedLoader.h"
+#include "QueryServer.h"
+#include "RouteIndex.h"
+#include "RouteStore.h"
+#include "SliceQuery.h"
+#include "Snapshot.h"
+#include "TopKRanker.h"
+#include "TrendEngine.h"
 
 using namespace std;
 
-struct AirportData {
-    string code; //Airport 3-letter Code
-    string name; //Airport Name
-    string month; //Travel Month
-    string year; //Year Stats
-    int carrier; //Number of delays due to carrier
-    int late; //Number of delays due to late arrival of aircraft
-    int navis; //Number of delays due to National Aviation System
-    int security; //Number of delays due to security
-    int weather; //Number of delays due to weather
-    int canceled; //Number of canceled flights
-    int delayed; //Number of delayed flights
-    int total_flights; //Number of Total Flights
-};
-
-// Structure for Trie Node
-struct TrieNode {
-    unordered_map<char, TrieNode*> children;
-    vector<AirportData> airport_data;
-};
-// Function to extract airport name from full name
-string AirportName(const string& fullName) {
-    size_t pos = fullName.find(": ");
-    if (pos != string::npos && pos + 2 < fullName.size()) {
-        return fullName.substr(pos + 2);
-    }
-    return fullName;
-}
 // Function to get Airport Information
-void GetAirportInfo(AirportData& data, vector<string>& columns) {
-    data.code = columns[0];
-    data.name = AirportName(columns[1]);
-    data.month = columns[4];
-    data.year = columns[5];
-    data.carrier = stoi(columns[6]);
-    data.late = stoi(columns[7]);
-    data.navis = stoi(columns[8]);
-    data.security = stoi(columns[9]);
-    data.weather = stoi(columns[10]);
-    data.canceled = stoi(columns[12]);
-    data.delayed = stoi(columns[13]);
-    data.total_flights = stoi(columns[16]);
-}
-// Function to split CSV line if it contains comma within the columns
-// https://stackoverflow.com/questions/1120140/how-can-i-read-and-parse-csv-files-in-c/53845961
-vector<string> splitLine(const string & line) {
-    vector<string> columns;
-    string data;
-    bool quoted = false;
-    char prev = NULL; // Previous character to detect quote escaping
-    for (char c : line) {
-        if (c == '\"') {
-            if (prev != '\\') { // Check for escaped quotes
-                quoted = !quoted; // Toggle quoted state
-            }
-        }
-        else if (c == ',' && !quoted) { // Outside quotes, comma is delimiter
-            columns.push_back(data);
-            data.clear();
-        }
-        else {
-            data.push_back(c);
-        }
-        prev = c;
-    }
-    columns.push_back(data);
-    return columns;
+void GetAirportInfo(AirportData& data, const CsvRow& columns) {
+    data.code.assign(columns[COL_CODE]);
+    data.name.assign(AirportName(columns[COL_NAME]));
+    data.month.assign(columns[COL_MONTH_NAME]);
+    data.year.assign(columns[COL_YEAR]);
+    data.carrier = parseInt(columns[COL_DELAYS_CARRIER]);
+    data.late = parseInt(columns[COL_DELAYS_LATE]);
+    data.navis = parseInt(columns[COL_DELAYS_NAVIS]);
+    data.security = parseInt(columns[COL_DELAYS_SECURITY]);
+    data.weather = parseInt(columns[COL_DELAYS_WEATHER]);
+    data.canceled = parseInt(columns[COL_CANCELED]);
+    data.delayed = parseInt(columns[COL_DELAYED]);
+    data.total_flights = parseInt(columns[COL_TOTAL_FLIGHTS]);
 }
 // Function to insert data into trie
 // https://www.geeksforgeeks.org/trie-insert-and-search/
+// New nodes come from the same arena as the root
 void insertTrie(TrieNode* root, const AirportData& data) {
     TrieNode* current = root;
     for (char c : data.code) {
         if (current->children.find(c) == current->children.end()) {
-            current->children[c] = new TrieNode();
+            current->children[c] = Trie::newNode(root->children.get_allocator().resource());
         }
         current = current->children[c];
     }
     current->airport_data.push_back(data);
 }
+
+Trie::Trie(Trie&& other) noexcept : memory(move(other.memory)), top(other.top) {
+    other.top = nullptr;
+}
+
+Trie& Trie::operator=(Trie&& other) noexcept {
+    if (this != &other) {
+        clear();
+        memory = move(other.memory);
+        top = other.top;
+        other.top = nullptr;
+    }
+    return *this;
+}
+
+Trie::~Trie() {
+    clear();
+}
+
+TrieNode* Trie::newNode(pmr::memory_resource* memory) {
+    return new (memory->allocate(sizeof(TrieNode), alignof(TrieNode))) TrieNode(memory);
+}
+
+// The destructors only free the row strings that live on the heap; giving memory back to
+// the arena does nothing, the blocks go all at once
+static void destroyNodes(TrieNode* node) {
+    for (const auto& child : node->children) {
+        destroyNodes(child.second);
+    }
+    node->~TrieNode();
+}
+
+void Trie::clear() {
+    if (top != nullptr) {
+        destroyNodes(top);
+        top = nullptr;
+    }
+    if (memory) {
+        memory->release();
+    }
+}
+
+TrieNode* Trie::root() {
+    if (top == nullptr) {
+        if (!memory) {
+            memory.reset(new Arena());
+        }
+        top = newNode(memory.get());
+    }
+    return top;
+}
+
+
 // Function to read CSV and build trie
 // https://www.geeksforgeeks.org/trie-insert-and-search/
-TrieNode* buildTrie(const string& filename) {
-    TrieNode* root = new TrieNode();
-    ifstream file(filename);
-    string line;
-    getline(file, line); // Skip the header line
-    while (getline(file, line)) {
-        vector<string> columns = splitLine(line);
-        AirportData data;
+Trie buildTrie(const string& filename) {
+    Trie trie;
+    TrieNode* root = trie.root();
+    MappedFile file(filename);
+    METRICS_TIMER(timer, STAGE_PARSE);
+    AirportData data;
+    forEachCsvRow(file.contents(), [&](const CsvRow& columns) {
+        METRICS_ITEMS(timer, 1);
         GetAirportInfo(data, columns);
         insertTrie(root, data);
-    }
-    return root;
+    });
+    return trie;
 }
 
 // Function to build hash table from CSV
 unordered_map<string, vector<AirportData>> buildHashTable(const string&
 filename) {
     unordered_map<string, vector<AirportData>> dataMap;
-    ifstream file(filename);
-    string line;
-    getline(file, line); // Skip the header line
-    while (getline(file, line)) {
-        vector<string> columns = splitLine(line);
-        AirportData data;
+    MappedFile file(filename);
+    METRICS_TIMER(timer, STAGE_PARSE);
+    AirportData data;
+    forEachCsvRow(file.contents(), [&](const CsvRow& columns) {
+        METRICS_ITEMS(timer, 1);
         GetAirportInfo(data, columns);
         dataMap[data.code].push_back(data);
-    }
+    });
     return dataMap;
 }
-// Function to calculate percentage
-double calculatePercentage(int numerator, int denominator) {
-    if (denominator == 0) {
-        return 0.0; // Avoid division by zero
+// Builds the same AirportData rows from already loaded columns (e.g. a mapped snapshot)
+void GetAirportInfo(AirportData& data, const TableView& table, size_t row) {
+    data.code = table.airportCode(table.airport[row]);
+    data.name.assign(table.airportName(table.airport[row]));
+    data.month = monthName(periodMonth(table.period[row]));
+    data.year = to_string(periodYear(table.period[row]));
+    data.carrier = table.counters[CARRIER_DELAYS][row];
+    data.late = table.counters[LATE_DELAYS][row];
+    data.navis = table.counters[NAVIS_DELAYS][row];
+    data.security = table.counters[SECURITY_DELAYS][row];
+    data.weather = table.counters[WEATHER_DELAYS][row];
+    data.canceled = table.counters[CANCELED_FLIGHTS][row];
+    data.delayed = table.counters[DELAYED_FLIGHTS][row];
+    data.total_flights = table.counters[TOTAL_FLIGHTS][row];
+}
+
+Trie buildTrie(const TableView& table) {
+    METRICS_TIMER(timer, STAGE_INSERT);
+    METRICS_ITEMS(timer, table.rows);
+    Trie trie;
+    TrieNode* root = trie.root();
+    AirportData data;
+    for (size_t i = 0; i < table.rows; i++) {
+        GetAirportInfo(data, table, i);
+        insertTrie(root, data);
+    }
+    return trie;
+}
+
+unordered_map<string, vector<AirportData>> buildHashTable(const TableView& table) {
+    METRICS_TIMER(timer, STAGE_INSERT);
+    METRICS_ITEMS(timer, table.rows);
+    unordered_map<string, vector<AirportData>> dataMap;
+    AirportData data;
+    for (size_t i = 0; i < table.rows; i++) {
+        GetAirportInfo(data, table, i);
+        dataMap[data.code].push_back(data);
     }
-    return (static_cast<double>(numerator) / denominator) * 100.0;
+    return dataMap;
 }
+
 // Function to convert a string to uppercase
 string toUpper(const string& str) {
     string upperStr = str;
@@ -146,44 +211,22 @@ string toLower(const string& str) {
     return lowerStr;
 }
 
-// code below for calulating top 5 most delay airports
-double calculateDelayRate(const vector<AirportData>& data) {
-    int totalFlights = 0;
-    int totalDelayedCanceled = 0;
-    for (const auto& entry : data) {
-        totalFlights += entry.total_flights;
-        totalDelayedCanceled += entry.delayed + entry.canceled;
-    }
-    if (totalFlights == 0) {
-        return 0.0;
-    }
-    return static_cast<double>(totalDelayedCanceled) / totalFlights * 100.0;
-}
-
-// same thing as above except with month and year
-double calculateDelayRate(const vector<AirportData>& data, const string& month, const string& year) {
-    int totalFlights = 0;
-    int totalDelayedCanceled = 0;
-    for (const auto& entry : data) {
-        if (entry.month == month && entry.year == year) {
-            totalFlights += entry.total_flights;
-            totalDelayedCanceled += entry.delayed + entry.canceled;
-        }
-    }
-    if (totalFlights == 0) {
-        return 0.0;
-    }
-    return static_cast<double>(totalDelayedCanceled) / totalFlights * 100.0;
+// Function to parse a whole option value as a number, false on anything else or on overflow
+template <typename Number>
+static bool parseNumber(string_view text, Number& value) {
+    const char* end = text.data() + text.size();
+    from_chars_result result = from_chars(text.data(), end, value);
+    return !text.empty() && result.ec == errc() && result.ptr == end;
 }
 
-
 // traverse trie for airport data for calculating top 5
 void traverseTrie(TrieNode* root, vector<pair<string, vector<AirportData>>>& airportData) {
     if (root == nullptr) {
         return;
     }
     if (!root->airport_data.empty()) {
-        airportData.emplace_back(root->airport_data[0].code, root->airport_data);
+        airportData.emplace_back(root->airport_data[0].code,
+                                 vector<AirportData>(root->airport_data.begin(), root->airport_data.end()));
     }
     for (const auto& child : root->children) {
         traverseTrie(child.second, airportData);
@@ -204,378 +247,1259 @@ string isValidMonth(const string& month) {
 }
 
 // Code for timing the two data structures
-// Function to measure build time and memory usage for hash table
-void measureHashTable(const string& filename) {
-    auto start_time = chrono::high_resolution_clock::now();
-    auto data = buildHashTable(filename);
-    auto end_time = chrono::high_resolution_clock::now();
+// Latency of looking up the given codes (uniform keys) with the benchmark harness
+template <typename Lookup>
+static LatencyStats measureCodeLookups(const vector<string>& airport_codes, Lookup&& lookup) {
+    BenchConfig config;
+    config.repetitions = 5;
+    config.operations = 1000;
+    vector<uint32_t> keys = uniformKeys(airport_codes.size(), config.operations, config.seed);
+    return measureLatency(config, [&](size_t i) { doNotOptimize(lookup(airport_codes[keys[i]])); });
+}
 
-    auto duration = chrono::duration_cast<chrono::microseconds>(end_time - start_time).count();
-    cout << "Hash Table Build Time: " << duration << " microseconds" << endl;
+// Heap a build kept, as counted by the allocation hooks (see MemoryTracker.h); without them
+// the structure's own estimate (its containers, not the heap behind long row strings)
+static void printHeapUsage(const string& label, long long trackedBytes, size_t estimatedBytes, const string& detail = "") {
+    cout << label << " Memory Usage: ";
+    if (ALLOCATION_TRACKING) {
+        cout << trackedBytes / 1024.0 / 1024.0 << " MB" << detail << endl;
+    }
+    else {
+        cout << estimatedBytes / 1024.0 / 1024.0 << " MB" << detail << " (estimated)" << endl;
+    }
+}
 
-    size_t memory_usage = 0;
+// Buckets, nodes (key, row vector, next pointer and cached hash) and the rows
+static size_t estimateHashTable(const unordered_map<string, vector<AirportData>>& data) {
+    size_t bytes = data.bucket_count() * sizeof(void*);
     for (const auto& entry : data) {
-        memory_usage += sizeof(string) + sizeof(vector<AirportData>) + entry.second.capacity() * sizeof(AirportData);
+        bytes += sizeof(entry) + 2 * sizeof(void*) + entry.second.capacity() * sizeof(AirportData);
     }
-    cout << "Hash Table Memory Usage: " << memory_usage / 1024.0 / 1024.0 << " MB" << endl;
+    return bytes;
+}
+
+static void printLatency(const string& label, const LatencyStats& latency) {
+    cout << label << ": mean " << latency.meanNs << " ns, p50 " << latency.p50Ns << " ns, p99 " << latency.p99Ns
+         << " ns (" << latency.samples << " lookups)" << endl;
+}
+
+// Function to measure build time and memory usage for hash table
+// The table is the one main already built (and timed); its memory is the heap the build kept,
+// counted by the allocator, so keys, buckets and node overhead are all included
+void measureHashTable(const unordered_map<string, vector<AirportData>>& data, long long buildMicroseconds,
+                      long long buildBytes) {
+    cout << "Hash Table Build Time: " << buildMicroseconds << " microseconds" << endl;
+    printHeapUsage("Hash Table", buildBytes, estimateHashTable(data));
 
-    // Perform random lookups to measure lookup time
-    cout << "Performing 1000 random lookups..." << endl;
     vector<string> airport_codes;
     for (const auto& entry : data) {
         airport_codes.push_back(entry.first);
     }
+    printLatency("Hash Table Lookup Time", measureCodeLookups(airport_codes, [&](const string& code) { return data.find(code); }));
+}
 
-    start_time = chrono::high_resolution_clock::now();
-    for (int i = 0; i < 1000; i++) {
-        string airport_code = airport_codes[rand() % airport_codes.size()];
-        auto it = data.find(airport_code);
-    }
-    end_time = chrono::high_resolution_clock::now();
+// Function to measure build time and memory usage for the flat hash index, same as the hash table
+void measureFlatIndex(const FlatAirportIndex& index, long long buildMicroseconds, long long buildBytes) {
+    cout << "Flat Index Build Time: " << buildMicroseconds << " microseconds" << endl;
+    printHeapUsage("Flat Index", buildBytes, index.memoryUsage(), " (" + to_string(index.slotCount()) + " slots)");
 
-    duration = chrono::duration_cast<chrono::microseconds>(end_time - start_time).count();
-    cout << "Average Hash Table Lookup Time: " << duration / 1000.0 << " microseconds" << endl;
-}
-void collectAirportCodes(TrieNode* root, vector<string>& airport_codes) {
-    if (root == nullptr) {
-        return;
-    }
-    if (!root->airport_data.empty()) {
-        for (const auto& data : root->airport_data) {
-            airport_codes.push_back(data.code);
-        }
-    }
-    for (const auto& child : root->children) {
-        collectAirportCodes(child.second, airport_codes);
+    vector<string> airport_codes;
+    for (size_t i = 0; i < index.airportCount(); i++) {
+        airport_codes.push_back(index.airportCode(i));
     }
+    printLatency("Flat Index Lookup Time", measureCodeLookups(airport_codes, [&](const string& code) { return index.find(code); }));
 }
+
 // Function to measure build time and memory usage for Trie
-void measureTrie(const string& filename) {
+// The trie is the one main already built (and timed), measured the same way as the hash table
+// The arena line is the trie's own accounting: what its nodes and containers took, what they
+// still hold after growing, and the blocks behind them
+void measureTrie(const Trie& trie, long long buildMicroseconds, long long buildBytes) {
+    TrieNode* root = trie.root();
+    cout << "Trie Build Time: " << buildMicroseconds << " microseconds" << endl;
+    printHeapUsage("Trie", buildBytes, trie.bytesReserved());
+    cout << "Trie Arena: " << trie.bytesUsed() << " bytes used, " << trie.bytesLive() << " live, "
+         << trie.bytesReserved() << " reserved in " << trie.blockCount() << " blocks" << endl;
+
+    // Same comparison for the arena trie and its read-only perfect hash index
+    AllocationScope scope;
     auto start_time = chrono::high_resolution_clock::now();
-    TrieNode* root = buildTrie(filename);
+    vector<pair<string, vector<AirportData>>> airportData;
+    traverseTrie(root, airportData);
+    CompactTrie compact(airportData);
+    PerfectHashIndex perfect(compact);
+    airportData = {};
     auto end_time = chrono::high_resolution_clock::now();
+    long long compactBytes = scope.live();
 
     auto duration = chrono::duration_cast<chrono::microseconds>(end_time - start_time).count();
-    cout << "Trie Build Time: " << duration << " microseconds" << endl;
+    cout << "Compact Trie + Perfect Hash Build Time: " << duration << " microseconds" << endl;
+    printHeapUsage("Compact Trie + Perfect Hash", compactBytes, compact.memoryUsage() + perfect.memoryUsage(),
+                   " (" + to_string(compact.nodeCount()) + " nodes)");
 
-    size_t memory_usage = 0;
-    queue<TrieNode*> q;
-    q.push(root);
-    while (!q.empty()) {
-        TrieNode* node = q.front();
-        q.pop();
-        memory_usage += sizeof(TrieNode) + node->children.size() * sizeof(TrieNode*) + node->airport_data.capacity() * sizeof(AirportData);
-        for (const auto& child : node->children) {
-            q.push(child.second);
-        }
+    vector<string> airport_codes;
+    for (size_t leaf = 0; leaf < compact.airportCount(); leaf++) {
+        airport_codes.push_back(compact.airportCode(leaf));
+    }
+    printLatency("Trie Lookup Time", measureCodeLookups(airport_codes, [&](const string& code) { return findTrie(root, code); }));
+    printLatency("Compact Trie Lookup Time", measureCodeLookups(airport_codes, [&](const string& code) { return compact.find(code); }));
+    printLatency("Perfect Hash Lookup Time", measureCodeLookups(airport_codes, [&](const string& code) { return perfect.find(code); }));
+}
+
+// Function to report load time and memory usage for the columnar table (parsed or mapped)
+void measureAirportTable(const Dataset& dataset, long long loadMicroseconds) {
+    bool mapped = dataset.snapshot.isOpen();
+    cout << (mapped ? "Columnar Snapshot Map Time: " : "Columnar Table Build Time: ") << loadMicroseconds
+         << " microseconds" << endl;
+
+    size_t memory_usage = mapped ? dataset.snapshot.tableBytes() : dataset.owned.memoryUsage();
+    cout << "Columnar Table Memory Usage: " << memory_usage / 1024.0 / 1024.0 << " MB" << endl;
+    if (dataset.table.rows > 0) {
+        cout << "Columnar Table Bytes per Row: " << static_cast<double>(memory_usage) / dataset.table.rows << endl;
     }
-    cout << "Trie Memory Usage: " << memory_usage / 1024.0 / 1024.0 << " MB" << endl;
+    cout << "Aggregate Cube Memory Usage: " << dataset.cube.memoryUsage() / 1024.0 / 1024.0 << " MB" << endl;
+}
 
+// Closest airports to a code that was not found: typos of the code, or a name typed instead
+static void printSuggestions(const Dataset& dataset, const string& text) {
+    AirportSearch search(dataset.table, dataset.cube);
+    vector<SearchHit> hits = search.suggest(text, 5);
+    if (hits.empty()) {
+        return;
+    }
+    cout << "Did you mean:" << endl;
+    for (const SearchHit& hit : hits) {
+        cout << setw(3) << "" << dataset.table.airportCode(hit.airport) << " - " << dataset.table.airportName(hit.airport)
+             << endl;
+    }
+}
 
-    // Perform random lookups to measure lookup time
-    cout << "Performing 1000 random lookups..." << endl;
-    vector<string> airport_codes;
-    collectAirportCodes(root,airport_codes);
+// Prints the month report, the top 5 ranking and the yearly trend for one airport
+// Every number is a cube lookup, nothing here walks the airport's rows
+void printAirportReport(const TableView& table, const AggregateCube& cube, const TrendEngine& trends, int airportId,
+                        const string& travel_month) {
+    METRICS_TIMER(timer, STAGE_FORMAT);
+    METRICS_ITEMS(timer, 1);
+    string airport_code = table.airportCode(airportId);
+    string airport_name(table.airportName(airportId));
+    int month = monthNumber(travel_month);
+    cout << "-----------------------------------------------" << endl;
+    cout << "Airport Code: " << airport_code << endl;
+    cout << "Airport Name: " << airport_name << endl;
+    cout << "Travel Month: " << travel_month << endl;
+    cout << "-----------------------------------------------" << endl;
+    for (int year = cube.firstYear(); year <= cube.lastYear(); year++) {
+        const CubeCell& cell = cube.cell(airportId, year, month);
+        if (cell.rows == 0) {
+            continue;
+        }
+        cout << "Year: " << year << endl;
+        cout << "Flights Canceled: " << cell.totals[CANCELED_FLIGHTS] << endl;
+        cout << "Flights Delayed: " << cell.totals[DELAYED_FLIGHTS] << endl;
+        cout << "Total Flights: " << cell.totals[TOTAL_FLIGHTS] << endl;
+        cout << endl;
+    }
+    const CounterTotals& totals = cube.cell(airportId, AggregateCube::ALL_YEARS, month).totals;
+    long long totalFlights = totals[TOTAL_FLIGHTS];
+    long long totalDelayed = totals[DELAYED_FLIGHTS];
+    long long totalCanceled = totals[CANCELED_FLIGHTS];
 
-    start_time = chrono::high_resolution_clock::now();
-    for (int i = 0; i < 1000; i++) {
-        string airport_code = airport_codes[rand() % airport_codes.size()];
-        TrieNode* node = root;
-        for (char c : airport_code) {
-            if (node->children.find(c) == node->children.end()) {
-                break;
+    // Calculate and display the percentage of delays and cancellations
+    double percentageDelayed = totalFlights == 0 ? 0.0 : static_cast<double>(totalDelayed) / totalFlights * 100.0;
+    double percentageCanceled = totalFlights == 0 ? 0.0 : static_cast<double>(totalCanceled) / totalFlights * 100.0;
+    cout << "----------------------------------------------------------------" << endl;
+    cout << "Welcome to " << airport_name << " Airport!" << endl;
+    cout << setw(8) << "---" << travel_month << " Statistics---" << endl;
+    cout << "Total Flights Canceled in " << airport_code << ": " << totalCanceled << endl;
+    cout << "Total Flights Delayed in " << airport_code << ": " << totalDelayed << endl;
+    cout << "Total Number of Flights in " << airport_code << ": " << totalFlights << endl;
+    cout << endl;
+    cout << "Percentage of Flights Canceled: " << setprecision(3) << percentageCanceled << "%" << endl;
+    cout << "Percentage of Flights Delayed: " << setprecision(4) << percentageDelayed << "%" << endl;
+    cout << endl;
+    cout << "Breakdown of Flights Delayed:" << endl;
+    cout << setw(3) << "" << "- Security Screening: " << totals[SECURITY_DELAYS] << endl;
+    cout << setw(3) << "" << "- Weather Conditions: " << totals[WEATHER_DELAYS] << endl;
+    cout << setw(3) << "" << "- Late Arrival of Aircraft: " << totals[LATE_DELAYS] << endl;
+    cout << setw(3) << "" << "- Carrier (maintenance, cleaning, fueling, etc.): " << totals[CARRIER_DELAYS] << endl;
+    cout << setw(3) << "" << "- National Aviation System (airport operations, etc.): " << totals[NAVIS_DELAYS] << endl;
+    // Only when the columns were loaded (see --columns)
+    if (table.counters[DIVERTED_FLIGHTS] != nullptr) {
+        cout << endl;
+        cout << "Total Flights Diverted in " << airport_code << ": " << totals[DIVERTED_FLIGHTS] << endl;
+    }
+    if (table.counters[ON_TIME_FLIGHTS] != nullptr) {
+        double percentageOnTime = totalFlights == 0 ? 0.0 : static_cast<double>(totals[ON_TIME_FLIGHTS]) / totalFlights * 100.0;
+        cout << "Percentage of Flights On Time: " << setprecision(2) << fixed << percentageOnTime << "%" << endl;
+    }
+    if (table.counters[DELAY_MINUTES] != nullptr) {
+        static const pair<CounterColumn, const char*> causes[] = {
+            { SECURITY_MINUTES, "Security Screening" },
+            { WEATHER_MINUTES, "Weather Conditions" },
+            { LATE_MINUTES, "Late Arrival of Aircraft" },
+            { CARRIER_MINUTES, "Carrier" },
+            { NAVIS_MINUTES, "National Aviation System" },
+        };
+        cout << endl;
+        cout << "Minutes Delayed: " << totals[DELAY_MINUTES] << " (" << setprecision(1) << fixed
+             << averageDelayMinutes(totals) << " minutes per delay)" << endl;
+        for (const auto& cause : causes) {
+            if (table.counters[cause.first] != nullptr) {
+                cout << setw(3) << "" << "- " << cause.second << ": " << totals[cause.first] << " minutes ("
+                     << minuteShare(totals, cause.first) << "%)" << endl;
             }
-            node = node->children[c];
         }
     }
-    end_time = chrono::high_resolution_clock::now();
+    cout << "----------------------------------------------------------------" << endl;
+
+    // Print the top 5 airports with the highest delay/cancellation rates
+    vector<RankedAirport> delayRates = topK(cube, 5, RANK_DELAY_RATE);
+    cout << "Top 5 Airports with the Highest Delay/Cancellation Rates:" << endl;
+    for (size_t i = 0; i < delayRates.size(); i++) {
+        cout << setw(3) << i + 1 << ". " << setw(3) << table.airportCode(delayRates[i].airport) << " - "
+             << table.airportName(delayRates[i].airport) << ": " << setprecision(2) << fixed << delayRates[i].value << "%" << endl;
+    }
+    cout << "----------------------------------------------------------------" << endl;
+
+    // Print the trends
+    cout << "Delay/Cancellation Trends for " << airport_name << " (" << airport_code << "):" << endl;
+    cout << "\nBy Year:" << endl;
 
-    duration = chrono::duration_cast<chrono::microseconds>(end_time - start_time).count();
-    cout << "Average Trie Lookup Time: " << duration / 1000.0 << " microseconds" << endl;
+    // Weighted by flights, so a year with only some months reported is still accurate
+    for (int year = trends.firstYear(); year <= trends.lastYear(); year++) {
+        float rate = trends.yearlyRate(airportId, year);
+        if (!isnan(rate)) {
+            cout << setw(3) << year << ": " << setprecision(2) << fixed << rate << "%" << endl;
+        }
+    }
+    int lastYear, lastMonth;
+    if (trends.lastMonth(airportId, lastYear, lastMonth)) {
+        const TrendPoint& latest = trends.point(airportId, lastYear, lastMonth);
+        cout << "\nRolling, up to " << monthName(lastMonth) << " " << lastYear << ":" << endl;
+        cout << setw(3) << "" << "- Last 3 Months: " << latest.rolling3 << "%" << endl;
+        cout << setw(3) << "" << "- Last 12 Months: " << latest.rolling12 << "%" << endl;
+    }
+    if (month > 0 && !isnan(trends.seasonalMean(airportId, month))) {
+        cout << "\n" << travel_month << " Seasonal Baseline: " << trends.seasonalMean(airportId, month) << "% (std "
+             << trends.seasonalDeviation(airportId, month) << "%)" << endl;
+    }
+    cout << "\nAnomalies (|z| >= 3 against earlier years of the same month):" << endl;
+    size_t shown = 0;
+    for (const TrendAnomaly& anomaly : trends.anomalies()) {
+        if (anomaly.airport == airportId) {
+            cout << setw(3) << "" << "- " << monthName(anomaly.month) << " " << anomaly.year << ": " << anomaly.rate
+                 << "% vs " << anomaly.baseline << "% (z = " << anomaly.zscore << ")" << endl;
+            shown++;
+        }
+    }
+    if (shown == 0) {
+        cout << setw(3) << "" << "- None" << endl;
+    }
+    cout << "----------------------------------------------------------------" << endl;
+}
 
+// Route feed of --route / --bench-routes, parsed on `threads` workers or through the pipeline
+static bool loadRoutes(const string& file, unsigned threads, uint32_t projection, bool pipelined, RouteTable& routes) {
+    string error;
+    if (!isRouteFeed(file)) {
+        error = file + " is not a route feed, its header must start with date,carrier,origin";
+    }
+    else if (pipelined) {
+        buildRouteTablePipelined(file, error, projection, routes);
+    }
+    else {
+        buildRouteTableParallel(file, threads, projection, routes, error);
+    }
+    if (!error.empty()) {
+        cout << error << endl;
+        return false;
+    }
+    return true;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     string file = "airlines.csv";
 
-    // Create a map to store delay/cancellation rates for different time periods
-    unordered_map<string, double> delayRatesByMonth;
-    unordered_map<string, double> delayRatesByYear;
+    string snapshotFile;
+    bool pipelined = false;
+    vector<string> appendFiles;
+    uint32_t projection = ALL_COUNTERS;
+    unsigned threads = defaultThreadCount();
 
-    // User Input for choice
-    int choice;
-    cout << "Disclaimer: To see differences in structure efficiency, run program twice" << endl;
-    cout << "Use same input except chose 1 and 2 respectively, then compare outputs" << endl << endl;
-    cout << "Choose a data structure to use:" << endl;
-    cout << "1. Hash Table" << endl;
-    cout << "2. Trie" << endl;
-    cout << "Enter your choice (1 or 2): ";
-    cin >> choice;
-    switch (choice) {
-        case 1: {
-            auto data = buildHashTable(file);
-            // User Input
-            string airport_code, travel_month;
-            cout << "Enter the airport code: ";
-            cin >> airport_code;
-            airport_code = toUpper(airport_code);
-            cout << "Enter travel month name: ";
-            cin >> travel_month;
-            string validMonth = isValidMonth(travel_month);  // Check if month is valid
-            if (validMonth.empty()) {
-                cout << "Invalid month. Please enter a valid month." << endl;
-                return 0;
+    // Command line modes, without one the interactive menu below runs
+    string mode;
+    vector<string> modeArgs;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--file" && i + 1 < argc) {
+            file = argv[++i];
+        }
+        else if (arg == "--snapshot" && i + 1 < argc) {
+            snapshotFile = argv[++i];
+        }
+        else if (arg == "--pipelined") {
+            pipelined = true;
+        }
+        else if (arg == "--append" && i + 1 < argc) {
+            appendFiles.push_back(argv[++i]);
+        }
+        else if (arg == "--metrics" && i + 1 < argc) {
+            dumpMetricsAtExit(argv[++i]);
+        }
+        else if (arg == "--columns" && i + 1 < argc) {
+            if (!parseCounterProjection(argv[++i], projection)) {
+                cout << "Unknown column in " << argv[i] << ", use delays, minutes, all or any of:";
+                for (int c = 0; c < COUNTER_COUNT; c++) {
+                    cout << " " << counterName(c);
+                }
+                cout << endl;
+                return 1;
+            }
+        }
+        else if (mode.empty() && arg.rfind("--", 0) == 0) {
+            mode = arg;
+        }
+        else {
+            modeArgs.push_back(arg);
+        }
+    }
+    // Compressed input cannot be mapped, it always goes through the pipeline
+    if (isGzipFile(file)) {
+        pipelined = true;
+    }
+    if (mode == "--bench-kernels") {
+        size_t rows = modeArgs.empty() ? 4000000 : stoul(modeArgs[0]);
+        runKernelBenchmark(file, rows);
+        return 0;
+    }
+    if (mode == "--bench") {
+        // --bench [--warmup n] [--reps n] [--ops n] [--zipf s] [--seed n] [--json path|-]
+        BenchConfig config;
+        string jsonFile;
+        for (size_t i = 0; i + 1 < modeArgs.size(); i += 2) {
+            const string& name = modeArgs[i];
+            const string& value = modeArgs[i + 1];
+            if (name == "--warmup") {
+                config.warmup = stoul(value);
+            }
+            else if (name == "--reps") {
+                config.repetitions = max(1ul, stoul(value));
+            }
+            else if (name == "--ops") {
+                config.operations = max(1ul, stoul(value));
+            }
+            else if (name == "--zipf") {
+                config.zipfExponent = stod(value);
+            }
+            else if (name == "--seed") {
+                config.seed = stoull(value);
+            }
+            else if (name == "--json") {
+                jsonFile = value;
+            }
+            else {
+                cout << "Unknown benchmark option: " << name << endl;
+                return 1;
+            }
+        }
+        runLookupBenchmark(file, threads, config, jsonFile);
+        return 0;
+    }
+    if (mode == "--generate") {
+        // --generate <out.csv|-> [--airports n] [--years n] [--first-year y] [--skew s] [--seed n]
+        GeneratorConfig config;
+        string output = "-";
+        for (size_t i = 0; i < modeArgs.size(); i++) {
+            bool hasValue = i + 1 < modeArgs.size();
+            if (modeArgs[i] == "--airports" && hasValue) {
+                config.airports = stoul(modeArgs[++i]);
+            }
+            else if (modeArgs[i] == "--years" && hasValue) {
+                config.years = stoi(modeArgs[++i]);
+            }
+            else if (modeArgs[i] == "--first-year" && hasValue) {
+                config.firstYear = stoi(modeArgs[++i]);
+            }
+            else if (modeArgs[i] == "--skew" && hasValue) {
+                config.skew = stod(modeArgs[++i]);
+            }
+            else if (modeArgs[i] == "--seed" && hasValue) {
+                config.seed = stoull(modeArgs[++i]);
+            }
+            else {
+                output = modeArgs[i];
+            }
+        }
+        if (config.firstYear < 1 || config.firstYear + config.years > 4095) {
+            cerr << "Years must stay within 1-4095" << endl;
+            return 1;
+        }
+        unique_ptr<BufferedWriter> out(output == "-" ? new BufferedWriter(stdout) : new BufferedWriter(output));
+        if (!out->isOpen()) {
+            cerr << "Cannot open " << output << " for writing" << endl;
+            return 1;
+        }
+        size_t rows = generateDataset(config, *out);
+        cerr << "Generated " << rows << " rows for " << config.airports << " airports" << endl;
+        return 0;
+    }
+    if (mode == "--generate-routes") {
+        // --generate-routes <out.csv|-> [--airports n] [--carriers n] [--routes n] [--days n] [--first-year y]
+        //                   [--skew s] [--seed n]
+        RouteGeneratorConfig config;
+        string output = "-";
+        for (size_t i = 0; i < modeArgs.size(); i++) {
+            bool hasValue = i + 1 < modeArgs.size();
+            if (modeArgs[i] == "--airports" && hasValue) {
+                config.airports = stoul(modeArgs[++i]);
+            }
+            else if (modeArgs[i] == "--carriers" && hasValue) {
+                config.carriers = stoul(modeArgs[++i]);
+            }
+            else if (modeArgs[i] == "--routes" && hasValue) {
+                config.routes = stoul(modeArgs[++i]);
+            }
+            else if (modeArgs[i] == "--days" && hasValue) {
+                config.days = max(0, stoi(modeArgs[++i]));
+            }
+            else if (modeArgs[i] == "--first-year" && hasValue) {
+                config.firstYear = stoi(modeArgs[++i]);
+            }
+            else if (modeArgs[i] == "--skew" && hasValue) {
+                config.skew = stod(modeArgs[++i]);
+            }
+            else if (modeArgs[i] == "--seed" && hasValue) {
+                config.seed = stoull(modeArgs[++i]);
+            }
+            else {
+                output = modeArgs[i];
+            }
+        }
+        if (config.firstYear < 1970 || dayNumber(config.firstYear, 1, 1) + static_cast<long long>(config.days) > 65536 ||
+            config.firstYear > 2149) {
+            cerr << "Days must stay within 1970-01-01 and 2149-06-06" << endl;
+            return 1;
+        }
+        if (config.airports > MAX_ROUTE_ID + 1 || config.carriers > MAX_ROUTE_ID + 1) {
+            cerr << "At most " << MAX_ROUTE_ID + 1 << " airports and carriers" << endl;
+            return 1;
+        }
+        unique_ptr<BufferedWriter> out(output == "-" ? new BufferedWriter(stdout) : new BufferedWriter(output));
+        if (!out->isOpen()) {
+            cerr << "Cannot open " << output << " for writing" << endl;
+            return 1;
+        }
+        size_t rows = generateRouteDataset(config, *out);
+        cerr << "Generated " << rows << " route rows for " << config.airports << " airports over " << config.days
+             << " days" << endl;
+        return 0;
+    }
+    if (mode == "--route") {
+        // --route <origin> <dest> <carrier> <date> [last date]: counters of one carrier on one route, one day or a range
+        uint16_t firstDay = 0, lastDay = 0;
+        if (modeArgs.size() < 4 || !parseRouteDate(modeArgs[3], firstDay) ||
+            (modeArgs.size() > 4 && !parseRouteDate(modeArgs[4], lastDay))) {
+            cout << "Usage: --route <origin> <dest> <carrier> <YYYY-MM-DD> [YYYY-MM-DD]" << endl;
+            return 1;
+        }
+        if (modeArgs.size() == 4) {
+            lastDay = firstDay;
+        }
+        RouteTable routes;
+        if (!loadRoutes(file, threads, projection, pipelined, routes)) {
+            return 1;
+        }
+        RouteIndex index(routes, threads);
+        string origin = toUpper(modeArgs[0]);
+        string dest = toUpper(modeArgs[1]);
+        string carrier = toUpper(modeArgs[2]);
+        TableView airports = routes.airports.view();
+        int originId = airports.findAirport(origin);
+        int destId = airports.findAirport(dest);
+        int carrierId = routes.findCarrier(carrier);
+        CounterTotals totals;
+        size_t rows = 0;
+        if (originId >= 0 && destId >= 0 && carrierId >= 0) {
+            for (uint32_t day = firstDay; day <= lastDay; day++) {
+                RouteRows found = index.find(routeKey(originId, destId, carrierId, static_cast<uint16_t>(day)));
+                totals += sumRouteRows(routes, found);
+                rows += found.count;
+            }
+        }
+        cout << "Route " << origin << "-" << dest << " on " << carrier << ", " << modeArgs[3];
+        if (lastDay != firstDay) {
+            cout << " to " << modeArgs[4];
+        }
+        cout << ": " << rows << " rows" << endl;
+        if (rows == 0) {
+            cout << "No data found for this route, carrier and dates." << endl;
+            return 0;
+        }
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (routes.hasColumn(c)) {
+                cout << setw(3) << "" << counterName(c) << ": " << totals[c] << endl;
+            }
+        }
+        cout << "Delay Rate: " << setprecision(2) << fixed << delayRate(totals) << "%" << endl;
+        return 0;
+    }
+    if (mode == "--bench-routes") {
+        // --bench-routes [--shards n] [--ops n] [--reps n] [--zipf s] [--seed n]: sharded index build and lookups
+        BenchConfig config;
+        unsigned shards = 0;
+        for (size_t i = 0; i + 1 < modeArgs.size(); i += 2) {
+            const string& name = modeArgs[i];
+            const string& value = modeArgs[i + 1];
+            if (name == "--shards") {
+                shards = static_cast<unsigned>(stoul(value));
+            }
+            else if (name == "--ops") {
+                config.operations = max(1ul, stoul(value));
+            }
+            else if (name == "--reps") {
+                config.repetitions = max(1ul, stoul(value));
+            }
+            else if (name == "--zipf") {
+                config.zipfExponent = stod(value);
+            }
+            else if (name == "--seed") {
+                config.seed = stoull(value);
+            }
+            else {
+                cout << "Unknown benchmark option: " << name << endl;
+                return 1;
+            }
+        }
+        RouteTable routes;
+        auto start = chrono::steady_clock::now();
+        if (!loadRoutes(file, threads, projection, pipelined, routes)) {
+            return 1;
+        }
+        auto loaded = chrono::steady_clock::now();
+        RouteIndex index(routes, threads, shards);
+        auto indexed = chrono::steady_clock::now();
+        AirportTable rolled = rollUpAirportMonths(routes, threads);
+        auto rolledUp = chrono::steady_clock::now();
+        auto micros = [](chrono::steady_clock::duration d) { return chrono::duration_cast<chrono::microseconds>(d).count(); };
+        cout << "Route Rows: " << routes.rowCount() << " (" << routes.airports.airportCount() << " airports, "
+             << routes.carrierCodes.size() << " carriers)" << endl;
+        cout << "Route Table Load Time: " << micros(loaded - start) << " microseconds" << endl;
+        cout << "Route Table Memory Usage: " << routes.memoryUsage() / 1024.0 / 1024.0 << " MB" << endl;
+        cout << "Route Index Build Time: " << micros(indexed - loaded) << " microseconds (" << threads << " threads)"
+             << endl;
+        cout << "Route Index Memory Usage: " << index.memoryUsage() / 1024.0 / 1024.0 << " MB (" << index.keyCount()
+             << " keys, " << index.slotCount() << " slots in " << index.shardCount() << " shards, largest "
+             << index.largestShard() << " keys, max probe " << index.maxProbeLength() << ")" << endl;
+        cout << "Roll-Up Time: " << micros(rolledUp - indexed) << " microseconds (" << rolled.rowCount()
+             << " airport months)" << endl;
+        if (routes.rowCount() == 0) {
+            return 0;
+        }
+        // Keys of existing rows, so hot routes are drawn as often as they have rows
+        vector<uint32_t> uniform = uniformKeys(routes.rowCount(), config.operations, config.seed);
+        vector<uint32_t> zipf = zipfKeys(routes.rowCount(), config.operations, config.zipfExponent, config.seed);
+        printLatency("Route Lookup Time (uniform)", measureLatency(config, [&](size_t i) {
+            doNotOptimize(sumRouteRows(routes, index.find(routes.keys[uniform[i]])));
+        }));
+        printLatency("Route Lookup Time (zipf)", measureLatency(config, [&](size_t i) {
+            doNotOptimize(sumRouteRows(routes, index.find(routes.keys[zipf[i]])));
+        }));
+        // A day past every row: a miss probes until the first slot that rules the key out
+        printLatency("Route Lookup Time (miss)", measureLatency(config, [&](size_t i) {
+            uint64_t key = routes.keys[uniform[i]];
+            doNotOptimize(index.find(routeKey(routeOrigin(key), routeDest(key), routeCarrier(key), 0xFFFF)));
+        }));
+        return 0;
+    }
+    if (mode == "--bench-scaling") {
+        // --bench-scaling [--sizes a,b,c] [--years n] [--thread-counts a,b] [--reps n] [--ops n] [--json path|-]
+        vector<size_t> sizes = { 100, 1000, 5000 };
+        vector<unsigned> threadCounts = { 1, threads };
+        int years = 20;
+        BenchConfig config;
+        config.repetitions = 5;
+        string jsonFile;
+        auto parseList = [](const string& text) {
+            vector<size_t> values;
+            size_t begin = 0;
+            while (begin < text.size()) {
+                size_t end = min(text.find(',', begin), text.size());
+                values.push_back(stoul(text.substr(begin, end - begin)));
+                begin = end + 1;
+            }
+            return values;
+        };
+        for (size_t i = 0; i + 1 < modeArgs.size(); i += 2) {
+            const string& name = modeArgs[i];
+            const string& value = modeArgs[i + 1];
+            if (name == "--sizes") {
+                sizes = parseList(value);
+            }
+            else if (name == "--years") {
+                years = max(1, stoi(value));
+            }
+            else if (name == "--thread-counts") {
+                threadCounts.clear();
+                for (size_t count : parseList(value)) {
+                    threadCounts.push_back(max(1u, static_cast<unsigned>(count)));
+                }
+            }
+            else if (name == "--reps") {
+                config.repetitions = max(1ul, stoul(value));
+            }
+            else if (name == "--ops") {
+                config.operations = max(1ul, stoul(value));
+            }
+            else if (name == "--json") {
+                jsonFile = value;
+            }
+            else {
+                cout << "Unknown benchmark option: " << name << endl;
+                return 1;
+            }
+        }
+        if (threadCounts.empty()) {
+            threadCounts.push_back(threads);
+        }
+        runScalingBenchmark(sizes, years, threadCounts, config, jsonFile);
+        return 0;
+    }
+    if (mode == "--build-snapshot") {
+        string output = modeArgs.empty() ? "airlines.snap" : modeArgs[0];
+        string error;
+        AirportTable table = loadAirportTable(file, threads, ALL_COUNTERS, pipelined, error);
+        if (!error.empty()) {
+            cout << error << endl;
+            return 1;
+        }
+        Snapshot written;
+        AggregateCube cube(table.view());
+        if (!writeSnapshot(table.view(), cube, output, error) || !written.open(output, true, error)) {
+            cout << error << endl;
+            return 1;
+        }
+        cout << "Wrote " << output << ": " << written.view().rows << " rows, " << written.view().airports
+             << " airports, " << written.fileSize() << " bytes" << endl;
+        return 0;
+    }
+    if (mode == "--build-columns") {
+        string output = modeArgs.empty() ? "airlines.cols" : modeArgs[0];
+        string error;
+        AirportTable table = loadAirportTable(file, threads, ALL_COUNTERS, pipelined, error);
+        if (!error.empty()) {
+            cout << error << endl;
+            return 1;
+        }
+        ColumnFile written;
+        if (!writeColumnFile(table.view(), output, error) || !written.open(output, error)) {
+            cout << error << endl;
+            return 1;
+        }
+        cout << "Wrote " << output << ": " << written.rowCount() << " rows, " << written.dictionary().airports
+             << " airports, " << written.blockCount() << " blocks, " << written.fileSize() << " bytes" << endl;
+        return 0;
+    }
+    if (mode == "--batch") {
+        // --batch <queries|-> [--format csv|jsonl] [--out path], results go to stdout by default
+        string input = "-";
+        string format = "csv";
+        string output;
+        for (size_t i = 0; i < modeArgs.size(); i++) {
+            if (modeArgs[i] == "--format" && i + 1 < modeArgs.size()) {
+                format = modeArgs[++i];
+            }
+            else if (modeArgs[i] == "--out" && i + 1 < modeArgs.size()) {
+                output = modeArgs[++i];
+            }
+            else {
+                input = modeArgs[i];
+            }
+        }
+        if (format != "csv" && format != "jsonl") {
+            cerr << "Unknown batch format: " << format << endl;
+            return 1;
+        }
+        string error;
+        unique_ptr<Dataset> dataset = loadDataset(file, snapshotFile, threads, error, projection, pipelined);
+        if (!dataset) {
+            cerr << error << endl;
+            return 1;
+        }
+        AppendTargets targets;
+        targets.dataset = dataset.get();
+        for (const string& delta : appendFiles) {
+            size_t rows;
+            if (!appendCsvFile(delta, targets, rows, error)) {
+                cerr << error << endl;
+                return 1;
+            }
+        }
+        unique_ptr<BufferedWriter> out(output.empty() ? new BufferedWriter(stdout) : new BufferedWriter(output));
+        if (!out->isOpen()) {
+            cerr << "Cannot open " << output << " for writing" << endl;
+            return 1;
+        }
+        BatchStats stats;
+        auto start = chrono::high_resolution_clock::now();
+        if (!runBatchFile(*dataset, input, format == "jsonl" ? BATCH_JSONL : BATCH_CSV, *out, stats, error)) {
+            cerr << error << endl;
+            return 1;
+        }
+        auto micros = chrono::duration_cast<chrono::microseconds>(chrono::high_resolution_clock::now() - start).count();
+        // Summary on stderr so stdout stays pure results
+        cerr << "Answered " << stats.answered << " of " << stats.queries << " queries in " << micros << " microseconds"
+             << endl;
+        return 0;
+    }
+    if (mode == "--top") {
+        // --top [k] [--metric name] [--year y] [--month name|1-12]
+        size_t k = 5;
+        RankMetric metric = RANK_DELAY_RATE;
+        RankWindow window;
+        for (size_t i = 0; i < modeArgs.size(); i++) {
+            if (modeArgs[i] == "--metric" && i + 1 < modeArgs.size()) {
+                metric = parseRankMetric(modeArgs[++i]);
+            }
+            else if (modeArgs[i] == "--year" && i + 1 < modeArgs.size()) {
+                window.year = atoi(modeArgs[++i].c_str());
+            }
+            else if (modeArgs[i] == "--month" && i + 1 < modeArgs.size()) {
+                const string& month = modeArgs[++i];
+                window.month = isdigit(static_cast<unsigned char>(month[0])) ? atoi(month.c_str()) : monthNumber(month);
+            }
+            else if (!parseNumber(modeArgs[i], k)) {
+                cout << "Usage: --top [k] [--metric name] [--year y] [--month name|1-12], k a count of airports" << endl;
+                return 1;
+            }
+        }
+        if (metric == RANK_METRIC_COUNT) {
+            cout << "Unknown metric, use one of:";
+            for (int m = 0; m < RANK_METRIC_COUNT; m++) {
+                cout << " " << rankMetricName(static_cast<RankMetric>(m));
             }
-            travel_month = validMonth;  // Convert to appropriate case
             cout << endl;
-
-            auto it = data.find(airport_code);
-            if (it != data.end()) {
-                cout << "Accessing Airport Data using Hash Table..." << endl;
-                cout << "-----------------------------------------------" << endl;
-                cout << "Airport Code: " << it->first << endl;
-                cout << "Airport Name: " << it->second[0].name << endl;
-                cout << "Travel Month: " << travel_month << endl;
-                cout << "-----------------------------------------------" << endl;
-                // Initialize variables to calculate total number of flights, delays, and cancellations
-                int totalFlights = 0;
-                int totalDelayed = 0;
-                int totalCarrier = 0;
-                int totalLate = 0;
-                int totalNavis = 0;
-                int totalSecurity = 0;
-                int totalWeather = 0;
-                int totalCanceled = 0;
-                for (const auto& entry : it->second) {
-                    string monthYear = entry.month + " " + entry.year;
-                    delayRatesByMonth[monthYear] = calculateDelayRate(it->second, entry.month, entry.year);
-                    delayRatesByYear[entry.year] += calculateDelayRate(it->second, entry.month, entry.year);
-
-                    if (entry.month == travel_month) {
-                        cout << "Year: " << entry.year << endl;
-                        cout << "Flights Canceled: " << entry.canceled <<
-                             endl;
-                        cout << "Flights Delayed: " << entry.delayed << endl;
-                        cout << "Total Flights: " << entry.total_flights <<
-                             endl;
-                        cout << endl;
-                        totalFlights += entry.total_flights;
-                        totalDelayed += entry.delayed;
-                        totalCanceled += entry.canceled;
-                        totalCarrier += entry.carrier;
-                        totalLate += entry.late;
-                        totalNavis += entry.navis;
-                        totalSecurity += entry.security;
-                        totalWeather += entry.weather;
+            return 1;
+        }
+        // The metric's own columns are loaded even when --columns left them out
+        string error;
+        unique_ptr<Dataset> dataset =
+            loadDataset(file, snapshotFile, threads, error, projection | rankMetricColumns(metric), pipelined);
+        if (!dataset) {
+            cout << error << endl;
+            return 1;
+        }
+        AppendTargets targets;
+        targets.dataset = dataset.get();
+        for (const string& delta : appendFiles) {
+            size_t rows;
+            if (!appendCsvFile(delta, targets, rows, error)) {
+                cout << error << endl;
+                return 1;
+            }
+        }
+        k = min(k, dataset->cube.airportCount());
+        vector<RankedAirport> ranked = topK(dataset->cube, k, metric, window);
+        const char* label = " share of delays";
+        if (metric == RANK_DELAY_RATE || metric == RANK_CANCEL_RATE || metric == RANK_DIVERT_RATE) {
+            label = " rate";
+        }
+        else if (metric == RANK_AVG_DELAY_MINUTES) {
+            label = " per delay";
+        }
+        else if (metric >= RANK_CARRIER_MINUTES_SHARE) {
+            label = " share of minutes delayed";
+        }
+        cout << "Top " << k << " airports by " << rankMetricName(metric) << label << endl;
+        for (size_t i = 0; i < ranked.size(); i++) {
+            cout << setw(3) << i + 1 << ". " << setw(3) << dataset->table.airportCode(ranked[i].airport) << " - "
+                 << dataset->table.airportName(ranked[i].airport) << ": " << setprecision(2) << fixed << ranked[i].value
+                 << (metric == RANK_AVG_DELAY_MINUTES ? " min" : "%") << endl;
+        }
+        return 0;
+    }
+    if (mode == "--query") {
+        // --query [--airports A,B] [--prefix P] [--years y|y1-y2] [--months m1,m2] [--min-flights n]
+        //         [--group airport,year,month,cause] [--backend columnar|hash|trie|file]
+        //         [--column-file path] [--out path]
+        SliceQuery query;
+        string backend = "columnar";
+        string columnFile = "airlines.cols";
+        string output;
+        for (size_t i = 0; i + 1 < modeArgs.size(); i += 2) {
+            const string& name = modeArgs[i];
+            const string& value = modeArgs[i + 1];
+            bool valid = true;
+            if (name == "--airports") {
+                stringstream codes(toUpper(value));
+                for (string code; getline(codes, code, ',');) {
+                    // A repeated code would be counted twice by the row-based backends
+                    if (find(query.airports.begin(), query.airports.end(), code) == query.airports.end()) {
+                        query.airports.push_back(code);
                     }
                 }
-                // Calculate and display the percentage of delays and cancellations
-                double percentageDelayed = calculatePercentage(totalDelayed, totalFlights);
-                double percentageCanceled = calculatePercentage(totalCanceled, totalFlights);
-                cout << "----------------------------------------------------------------" << endl;
-                cout << "Welcome to " << it->second[0].name << " Airport!" << endl;
-                cout << setw(8) << "---" << travel_month << " Statistics--- "<< endl;
-                cout << "Total Flights Canceled in " << airport_code << ": " << totalCanceled << endl;
-                cout << "Total Flights Delayed in " << airport_code << ": " << totalDelayed << endl;
-                cout << "Total Number of Flights in " << airport_code << ": " << totalFlights << endl;
-                cout << endl;
-                cout << "Percentage of Flights Canceled: " << setprecision(3) << percentageCanceled << "%" << endl;
-                cout << "Percentage of Flights Delayed: " << setprecision(4) << percentageDelayed << "%" << endl;
-                cout << endl;
-                cout << "Breakdown of Flights Delayed:" << endl;
-                cout << setw(3) << "" << "- Security Screening: " << totalSecurity << endl;
-                cout << setw(3) << "" << "- Weather Conditions: " << totalWeather << endl;
-                cout << setw(3) << "" << "- Late Arrival of Aircraft: " << totalLate << endl;
-                cout << setw(3) << "" << "- Carrier (maintenance, cleaning, fueling, etc.): " << totalCarrier << endl;
-                cout << setw(3) << "" << "- National Aviation System (airport operations, etc.): " << totalNavis << endl;
-                cout << "----------------------------------------------------------------" << endl;
-
-                vector<pair<string, double>> delayRates;
-                for (const auto& entry : data) {
-                    double rate = calculateDelayRate(entry.second);
-                    delayRates.emplace_back(entry.first, rate);
+            }
+            else if (name == "--prefix") {
+                query.prefix = toUpper(value);
+            }
+            else if (name == "--years") {
+                valid = parseYearRange(value, query.firstYear, query.lastYear);
+            }
+            else if (name == "--months") {
+                valid = parseMonthSet(value, query.monthMask);
+            }
+            else if (name == "--min-flights") {
+                valid = parseNumber(value, query.minFlights);
+            }
+            else if (name == "--group") {
+                valid = parseSliceGroups(value, query.groupBy);
+            }
+            else if (name == "--backend") {
+                backend = value;
+                valid = backend == "columnar" || backend == "hash" || backend == "trie" || backend == "file";
+            }
+            else if (name == "--column-file") {
+                columnFile = value;
+            }
+            else if (name == "--out") {
+                output = value;
+            }
+            else {
+                valid = false;
+            }
+            if (!valid) {
+                cout << "Bad query option: " << name << " " << value << endl;
+                return 1;
+            }
+        }
+        string error;
+        SliceResult result;
+        string scanned;
+        uint32_t summed = ALL_COUNTERS;
+        long long scanMicroseconds = 0;
+        // The file backend reads the column file alone, the CSV is never loaded
+        if (backend == "file") {
+            if (!appendFiles.empty()) {
+                cout << "--append does not apply to the file backend, rebuild the column file instead" << endl;
+                return 1;
+            }
+            ColumnFile columns;
+            if (!columns.open(columnFile, error)) {
+                cout << error << endl;
+                return 1;
+            }
+            size_t blocks = 0;
+            auto start = chrono::steady_clock::now();
+            result = runSlice(columns, query, &blocks);
+            scanMicroseconds = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+            scanned = ", " + to_string(blocks) + " of " + to_string(columns.blockCount()) + " blocks decoded";
+        }
+        else {
+            unique_ptr<Dataset> dataset = loadDataset(file, snapshotFile, threads, error, projection, pipelined);
+            if (!dataset) {
+                cout << error << endl;
+                return 1;
+            }
+            AppendTargets targets;
+            targets.dataset = dataset.get();
+            for (const string& delta : appendFiles) {
+                size_t rows;
+                if (!appendCsvFile(delta, targets, rows, error)) {
+                    cout << error << endl;
+                    return 1;
                 }
-
-                // Sort the vector in descending order based on the delay/cancellation rates
-                sort(delayRates.begin(), delayRates.end(), [](const pair<string, double>& a, const pair<string, double>& b) {
-                    return a.second > b.second;
-                });
-
-                // Print the top 5 airports with the highest delay/cancellation rates
-                cout << "Top 5 Airports with the Highest Delay/Cancellation Rates:" << endl;
-                for (int i = 0; i < 5 && i < delayRates.size(); i++) {
-                    const auto& airport = data.find(delayRates[i].first)->second;
-                    cout << setw(3) << i + 1 << ". " << setw(3) << delayRates[i].first << " - " << airport[0].name << ": "
-                         << setprecision(2) << fixed << delayRates[i].second << "%" << endl;
+            }
+            // Columns left out by --columns are null in the view and sum to nothing
+            summed = 0;
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                summed |= dataset->table.counters[c] != nullptr ? 1u << c : 0;
+            }
+            auto start = chrono::steady_clock::now();
+            if (backend == "hash") {
+                unordered_map<string, vector<AirportData>> data = buildHashTable(dataset->table);
+                start = chrono::steady_clock::now();
+                result = runSlice(data, query);
+                summed &= DELAY_COUNTERS;
+            }
+            else if (backend == "trie") {
+                Trie trie = buildTrie(dataset->table);
+                start = chrono::steady_clock::now();
+                result = runSlice(trie.root(), query);
+                summed &= DELAY_COUNTERS;
+            }
+            else {
+                result = runSlice(dataset->table, query);
+            }
+            scanMicroseconds = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        }
+        unique_ptr<BufferedWriter> out(output.empty() ? new BufferedWriter(stdout) : new BufferedWriter(output));
+        if (!out->isOpen()) {
+            cout << "Cannot open " << output << " for writing" << endl;
+            return 1;
+        }
+        writeSliceCsv(result, query.groupBy, summed, *out);
+        out->flush();
+        cerr << result.size() << " groups from the " << backend << " backend in " << scanMicroseconds << " microseconds"
+             << scanned << endl;
+        return 0;
+    }
+    if (mode == "--trends") {
+        // --trends [--threshold z] [--min-history n] [--out path]: every airport's seasonal anomalies as CSV
+        TrendConfig config;
+        string output;
+        for (size_t i = 0; i + 1 < modeArgs.size(); i += 2) {
+            const string& name = modeArgs[i];
+            const string& value = modeArgs[i + 1];
+            if (name == "--threshold") {
+                config.threshold = stod(value);
+            }
+            else if (name == "--min-history") {
+                config.minHistory = max(1, stoi(value));
+            }
+            else if (name == "--out") {
+                output = value;
+            }
+            else {
+                cout << "Unknown trends option: " << name << endl;
+                return 1;
+            }
+        }
+        string error;
+        unique_ptr<Dataset> dataset = loadDataset(file, snapshotFile, threads, error, projection, pipelined);
+        if (!dataset) {
+            cout << error << endl;
+            return 1;
+        }
+        AppendTargets targets;
+        targets.dataset = dataset.get();
+        for (const string& delta : appendFiles) {
+            size_t rows;
+            if (!appendCsvFile(delta, targets, rows, error)) {
+                cout << error << endl;
+                return 1;
+            }
+        }
+        auto start = chrono::steady_clock::now();
+        TrendEngine trends(dataset->table, config);
+        long long trendMicroseconds = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+        unique_ptr<BufferedWriter> out(output.empty() ? new BufferedWriter(stdout) : new BufferedWriter(output));
+        if (!out->isOpen()) {
+            cout << "Cannot open " << output << " for writing" << endl;
+            return 1;
+        }
+        METRICS_TIMER(formatTimer, STAGE_FORMAT);
+        METRICS_ITEMS(formatTimer, trends.anomalies().size() + 1);
+        out->write("code,year,month,rate,baseline,deviation,zscore\n");
+        for (const TrendAnomaly& anomaly : trends.anomalies()) {
+            out->write(dataset->table.airportCode(anomaly.airport)).write(',').write(static_cast<long long>(anomaly.year));
+            out->write(',').write(monthName(anomaly.month)).write(',').write(anomaly.rate, 2).write(',');
+            out->write(anomaly.baseline, 2).write(',').write(anomaly.deviation, 2).write(',').write(anomaly.zscore, 2).write('\n');
+        }
+        out->flush();
+        cerr << "Trends for " << trends.airportCount() << " airports x " << trends.lastYear() - trends.firstYear() + 1
+             << " years in " << trendMicroseconds << " microseconds, " << trends.anomalies().size() << " anomalies" << endl;
+        return 0;
+    }
+    if (mode == "--search") {
+        // --search <text> [--limit n]: code prefix, airport name words and near-miss codes
+        string text;
+        size_t limit = 10;
+        for (size_t i = 0; i < modeArgs.size(); i++) {
+            if (modeArgs[i] == "--limit" && i + 1 < modeArgs.size()) {
+                limit = stoul(modeArgs[++i]);
+            }
+            else {
+                text += (text.empty() ? "" : " ") + modeArgs[i];
+            }
+        }
+        string error;
+        unique_ptr<Dataset> dataset = loadDataset(file, snapshotFile, threads, error, projection, pipelined);
+        if (!dataset) {
+            cout << error << endl;
+            return 1;
+        }
+        auto start_time = chrono::high_resolution_clock::now();
+        AirportSearch search(dataset->table, dataset->cube, max<size_t>(limit, 10));
+        auto built = chrono::high_resolution_clock::now();
+        vector<SearchHit> hits = search.suggest(text, limit);
+        auto end_time = chrono::high_resolution_clock::now();
+        for (const SearchHit& hit : hits) {
+            cout << setw(4) << left << dataset->table.airportCode(hit.airport) << right << " - "
+                 << dataset->table.airportName(hit.airport) << " (" << hit.flights << " flights"
+                 << (hit.distance > 0 ? ", " + to_string(hit.distance) + " typo" : string()) << ")" << endl;
+        }
+        cout << hits.size() << " matches in " << chrono::duration<double, micro>(end_time - built).count()
+             << " microseconds (index built in " << chrono::duration_cast<chrono::microseconds>(built - start_time).count()
+             << " microseconds)" << endl;
+        return 0;
+    }
+    if (mode == "--serve" || mode == "--bench-serve") {
+        QueryEngine engine(file, snapshotFile, threads, projection);
+        string error;
+        if (!engine.start(error)) {
+            cerr << error << endl;
+            return 1;
+        }
+        if (mode == "--serve") {
+            // Line protocol on stdin/stdout, see QueryServer.h
+            BufferedWriter out(stdout);
+            runServer(engine, stdin, out);
+            return 0;
+        }
+        // --bench-serve [--readers 1,2,4] [--seconds s] [--swap-ms n]
+        vector<unsigned> readerCounts;
+        for (unsigned count = 1; count <= max(1u, thread::hardware_concurrency()); count *= 2) {
+            readerCounts.push_back(count);
+        }
+        double seconds = 2.0;
+        int swapMilliseconds = 100;
+        for (size_t i = 0; i + 1 < modeArgs.size(); i += 2) {
+            if (modeArgs[i] == "--readers") {
+                readerCounts.clear();
+                stringstream list(modeArgs[i + 1]);
+                string count;
+                while (getline(list, count, ',')) {
+                    readerCounts.push_back(max(1, stoi(count)));
+                }
+            }
+            else if (modeArgs[i] == "--seconds") {
+                seconds = stod(modeArgs[i + 1]);
+            }
+            else if (modeArgs[i] == "--swap-ms") {
+                swapMilliseconds = stoi(modeArgs[i + 1]);
+            }
+        }
+        runServeBenchmark(engine, readerCounts, seconds, swapMilliseconds);
+        return 0;
+    }
+    if (mode == "--verify-append") {
+        if (modeArgs.empty()) {
+            cout << "Usage: --verify-append <delta.csv>" << endl;
+            return 1;
+        }
+        string report;
+        bool ok = verifyAppend(file, modeArgs[0], threads, report);
+        cout << report;
+        return ok ? 0 : 1;
+    }
+    if (mode == "--verify-search") {
+        string error;
+        unique_ptr<Dataset> dataset = loadDataset(file, snapshotFile, threads, error, projection, pipelined);
+        if (!dataset) {
+            cout << error << endl;
+            return 1;
+        }
+        string report;
+        bool ok = verifyNameSearch(dataset->table, dataset->cube, report);
+        cout << report;
+        return ok ? 0 : 1;
+    }
+    if (mode == "--follow") {
+        // --follow [path] [--interval ms]: ingests rows as they are written to a growing CSV
+        string followed = file;
+        int intervalMs = 1000;
+        for (size_t i = 0; i < modeArgs.size(); i++) {
+            if (modeArgs[i] == "--interval" && i + 1 < modeArgs.size()) {
+                intervalMs = max(1, atoi(modeArgs[++i].c_str()));
+            }
+            else {
+                followed = modeArgs[i];
+            }
+        }
+        // A gzip stream cannot be read from the middle, so a growing file has to be plain text
+        if (isGzipFile(followed)) {
+            cout << "Cannot follow " << followed << ": it is gzip-compressed, follow the uncompressed file" << endl;
+            return 1;
+        }
+        string error;
+        unique_ptr<Dataset> dataset = loadDataset(file, snapshotFile, threads, error, projection, pipelined);
+        if (!dataset) {
+            cout << error << endl;
+            return 1;
+        }
+        TopKRanker ranker(dataset->cube, 5, RANK_DELAY_RATE);
+        AppendTargets targets;
+        targets.dataset = dataset.get();
+        targets.ranker = &ranker;
+        // Following the loaded file only picks up rows written after the load; a snapshot is
+        // taken to hold the CSV as it is now, so its rows are not appended a second time
+        TailReader tail(followed, followed == file);
+        cout << "Following " << followed << " (" << dataset->table.rows << " rows loaded), Ctrl+C to stop" << endl;
+        string lines;
+        while (true) {
+            if (tail.poll(lines)) {
+                size_t rows = appendRows(lines, false, targets);
+                cout << "Appended " << rows << " rows, " << dataset->table.rows << " total. Top 5:";
+                for (const RankedAirport& ranked : ranker.top()) {
+                    cout << " " << dataset->table.airportCode(ranked.airport) << " " << setprecision(2) << fixed
+                         << ranked.value << "%";
                 }
-                cout << "----------------------------------------------------------------" << endl;
+                cout << endl;
+            }
+            this_thread::sleep_for(chrono::milliseconds(intervalMs));
+        }
+    }
+    if (!mode.empty()) {
+        cout << "Unknown option: " << mode << endl;
+        return 1;
+    }
 
-                // Print the trends
-                cout << "Delay/Cancellation Trends for " << it->second[0].name << " (" << airport_code << "):" << endl;
-                cout << "\nBy Year:" << endl;
+    // User Input for choice
+    int choice;
+    cout << "Disclaimer: To see differences in structure efficiency, run program once per structure" << endl;
+    cout << "Use same input except chose 1, 2 and 3 respectively, then compare outputs" << endl << endl;
+    cout << "Choose a data structure to use:" << endl;
+    cout << "1. Hash Table" << endl;
+    cout << "2. Trie" << endl;
+    cout << "3. Flat Hash Index" << endl;
+    cout << "Enter your choice (1, 2 or 3): ";
+    cin >> choice;
+    if (choice < 1 || choice > 3) {
+        cout << "Invalid choice." << endl;
+        return 0;
+    }
 
-                // Create a map to store delay rates by year
-                map<string, double> delayRatesByYearMap;
+    // The chosen structure finds the airport, the statistics come from the cube built at load time
+    string error;
+    auto start_time = chrono::high_resolution_clock::now();
+    unique_ptr<Dataset> dataset = loadDataset(file, snapshotFile, threads, error, projection, pipelined);
+    auto end_time = chrono::high_resolution_clock::now();
+    if (!dataset) {
+        cout << error << endl;
+        return 1;
+    }
+    long long loadMicroseconds = chrono::duration_cast<chrono::microseconds>(end_time - start_time).count();
+    const TableView& table = dataset->table;
 
-                // Normalize the delay/cancellation rates for years
-                for (auto& entry : delayRatesByYear) {
-                    double normalRate = entry.second /= 12.0;  // Assuming 12 months in a year
-                    delayRatesByYearMap[entry.first] = normalRate;
-                }
+    // With a snapshot the structure is filled from the mapped columns instead of re-parsing the CSV,
+    // and a route feed has no airport rows to parse, only the rolled-up columns
+    bool fromColumns = !snapshotFile.empty() || isRouteFeed(file);
+    unordered_map<string, vector<AirportData>> data;
+    unique_ptr<Trie> trie;
+    TrieNode* root = nullptr;
+    FlatAirportIndex flat;
+    AllocationScope buildScope;
+    start_time = chrono::high_resolution_clock::now();
+    if (choice == 1) {
+        if (fromColumns) {
+            data = buildHashTable(table);
+        }
+        else {
+            data = pipelined ? buildHashTablePipelined(file, error) : buildHashTableParallel(file, threads);
+        }
+    }
+    else if (choice == 2) {
+        if (fromColumns) {
+            trie.reset(new Trie(buildTrie(table)));
+        }
+        else {
+            trie.reset(new Trie(pipelined ? buildTriePipelined(file, error) : buildTrieParallel(file, threads)));
+        }
+        root = trie->root();
+    }
+    else if (appendFiles.empty()) {
+        if (fromColumns) {
+            flat = FlatAirportIndex(table);
+        }
+        else {
+            flat = pipelined ? buildFlatIndexPipelined(file, error) : buildFlatIndexParallel(file, threads);
+        }
+    }
+    if (!error.empty()) {
+        cout << error << endl;
+        return 1;
+    }
+    long long buildBytes = buildScope.live();
+    // New monthly drops go into the structures already built instead of rebuilding them
+    AppendTargets targets;
+    targets.dataset = dataset.get();
+    targets.hashTable = choice == 1 ? &data : nullptr;
+    targets.trie = root;
+    for (const string& delta : appendFiles) {
+        size_t rows;
+        if (!appendCsvFile(delta, targets, rows, error)) {
+            cout << error << endl;
+            return 1;
+        }
+    }
+    if (choice == 3 && !appendFiles.empty()) {
+        // The flat index is read-only, so with deltas it is built once from the updated columns
+        flat = FlatAirportIndex(table);
+        buildBytes = buildScope.live();
+    }
+    end_time = chrono::high_resolution_clock::now();
+    long long buildMicroseconds = chrono::duration_cast<chrono::microseconds>(end_time - start_time).count();
+    TrendEngine trends(dataset->table);
 
-                // Print the delay rates sorted by year
-                for (const auto& entry : delayRatesByYearMap) {
-                    cout << setw(3) << entry.first << ": " << setprecision(2) << fixed << entry.second << "%" << endl;
-                }
-                cout << "\n(Note) 2016 will not be accurate." << endl;
-                cout << "----------------------------------------------------------------" << endl;
+    // User Input
+    string airport_code, travel_month;
+    cout << "Enter the airport code: ";
+    cin >> airport_code;
+    airport_code = toUpper(airport_code);
+    cout << "Enter travel month name: ";
+    cin >> travel_month;
+    string validMonth = isValidMonth(travel_month);  // Check if month is valid
+    if (validMonth.empty()) {
+        cout << "Invalid month. Please enter a valid month." << endl;
+        return 0;
+    }
+    travel_month = validMonth;  // Convert to appropriate case
+    cout << endl;
+
+    switch (choice) {
+        case 1: {
+            auto it = data.find(airport_code);
+            int airportId = table.findAirport(airport_code);
+            if (it != data.end() && airportId >= 0) {
+                cout << "Accessing Airport Data using Hash Table..." << endl;
+                printAirportReport(table, dataset->cube, trends, airportId, travel_month);
                 cout << "Hash Table Efficiency:" << endl;
-                measureHashTable(file);
+                measureHashTable(data, buildMicroseconds, buildBytes);
+                measureAirportTable(*dataset, loadMicroseconds);
                 cout << endl;
-
             }
             else {
                 cout << "No data found for the entered airport code." <<
                      endl;
+                printSuggestions(*dataset, airport_code);
             }
             break;
         }
         case 2: {
-            TrieNode* root = buildTrie(file);
-            // User Input
-            string airport_code, travel_month;
-            cout << "Enter the airport code: ";
-            cin >> airport_code;
-            airport_code = toUpper(airport_code);
-            cout << "Enter travel month name: ";
-            cin >> travel_month;
-            string validMonth = isValidMonth(travel_month);  // Check if month is valid
-            if (validMonth.empty()) {
-                cout << "Invalid month. Please enter a valid month." << endl;
-                return 0;
-            }
-            travel_month = validMonth;  // Convert to appropriate case
-            cout << endl;
             // Find node corresponding to airport code
-            TrieNode* node = root;
-            for (char c : airport_code) {
-                if (node->children.find(c) == node->children.end()) {
-                    cout << "No data found for the entered airport code." <<
-                         endl;
-                    return 0;
-                }
-                node = node->children[c];
+            AirportRecords records = findTrie(root, airport_code);
+            int airportId = table.findAirport(airport_code);
+            if (records.empty() || airportId < 0) {
+                cout << "No data found for the entered airport code." <<
+                     endl;
+                printSuggestions(*dataset, airport_code);
+                return 0;
             }
             cout << "Accessing Airport Data using Trie..." << endl;
-            cout << "-----------------------------------------------" << endl;
-            cout << "Airport Code: " << airport_code << endl;
-            cout << "Airport Name: " << node->airport_data[0].name << endl;
-            cout << "Travel Month: " << travel_month << endl;
-            cout << "-----------------------------------------------" << endl;
-            // Initialize variables to calculate total number of flights, delays, and cancellations
-            int totalFlights = 0;
-            int totalDelayed = 0;
-            int totalCarrier = 0;
-            int totalCanceled = 0;
-            int totalLate = 0;
-            int totalNavis = 0;
-            int totalSecurity = 0;
-            int totalWeather = 0;
-            // Iterate over all airport data under the specified airport code
-            for (const auto& entry : node->airport_data) {
-
-                string monthYear = entry.month + " " + entry.year;
-                delayRatesByMonth[monthYear] = calculateDelayRate(node->airport_data, entry.month, entry.year);
-                delayRatesByYear[entry.year] += calculateDelayRate(node->airport_data, entry.month, entry.year);
-
-                // Check if the entry matches the specified travel month
-                if (entry.month == travel_month) {
-                    cout << "Year: " << entry.year << endl;
-                    cout << "Flights Canceled: " << entry.canceled << endl;
-                    cout << "Flights Delayed: " << entry.delayed << endl;
-                    cout << "Total Flights: " << entry.total_flights << endl;
-                    cout << endl;
-                    totalFlights += entry.total_flights;
-                    totalDelayed += entry.delayed;
-                    totalCanceled += entry.canceled;
-                    totalCarrier += entry.carrier;
-                    totalLate += entry.late;
-                    totalNavis += entry.navis;
-                    totalSecurity += entry.security;
-                    totalWeather += entry.weather;
-                }
-            }
-            // Calculate and display the percentage of delays and cancellations
-            double percentageDelayed = calculatePercentage(totalDelayed, totalFlights);
-            double percentageCanceled = calculatePercentage(totalCanceled, totalFlights);
-            cout << "----------------------------------------------------------------" << endl;
-            cout << "Welcome to " << node->airport_data[0].name << " Airport!" << endl;
-            cout << setw(8) << "---" << travel_month << " Statistics---" << endl;
-            cout << "Total Flights Canceled in " << airport_code << ": " << totalCanceled << endl;
-            cout << "Total Flights Delayed in " << airport_code << ": " << totalDelayed << endl;
-            cout << "Total Number of Flights in " << airport_code << ": " << totalFlights << endl;
-            cout << endl;
-            cout << "Percentage of Flights Canceled: " << setprecision(3) << percentageCanceled << "%" << endl;
-            cout << "Percentage of Flights Delayed: " << setprecision(4) << percentageDelayed << "%" << endl;
-            cout << endl;
-            cout << "Breakdown of Flights Delayed:" << endl;
-            cout << setw(3) << "" << "- Security Screening: " << totalSecurity << endl;
-            cout << setw(3) << "" << "- Weather Conditions: " << totalWeather << endl;
-            cout << setw(3) << "" << "- Late Arrival of Aircraft: " << totalLate << endl;
-            cout << setw(3) << "" << "- Carrier (maintenance, cleaning, fueling, etc.): " << totalCarrier << endl;
-            cout << setw(3) << "" << "- National Aviation System (airport operations, etc.): " << totalNavis << endl;
-            cout << "----------------------------------------------------------------" << endl;
-
-            vector<pair<string, vector<AirportData>>> airportData;
-            traverseTrie(root, airportData);
-
-            // Create a vector to store airport codes and their delay/cancellation rates
-            vector<pair<string, double>> delayRates;
-            for (const auto& entry : airportData) {
-                double rate = calculateDelayRate(entry.second);
-                delayRates.emplace_back(entry.first, rate);
-            }
-
-            // Sort the vector in descending order based on the delay/cancellation rates
-            sort(delayRates.begin(), delayRates.end(), [](const pair<string, double>& a, const pair<string, double>& b) {
-                return a.second > b.second;
-            });
-
-            // Print the top 5 airports with the highest delay/cancellation rates
-            cout << "Top 5 Airports with the Highest Delay/Cancellation Rates:" << endl;
-            for (int i = 0; i < 5 && i < delayRates.size(); i++) {
-                cout << setw(3) << i + 1 << ". " << setw(3) << delayRates[i].first << " - " << airportData[i].second[0].name << ": "
-                     << setprecision(2) << fixed << delayRates[i].second << "%" << endl;
-            }
-            cout << "----------------------------------------------------------------" << endl;
-
-            // Print the trends
-            cout << "Delay/Cancellation Trends for " << node->airport_data[0].name << " (" << airport_code << "):" << endl;
-            cout << "\nBy Year:" << endl;
-
-            // Create a map to store delay rates by year
-            map<string, double> delayRatesByYearMap;
-
-            // Normalize the delay/cancellation rates for years
-            for (auto& entry : delayRatesByYear) {
-                double normalRate = entry.second /= 12.0;  // Assuming 12 months in a year
-                delayRatesByYearMap[entry.first] = normalRate;
-            }
-
-            // Print the delay rates sorted by year
-            for (const auto& entry : delayRatesByYearMap) {
-                cout << setw(3) << entry.first << ": " << setprecision(2) << fixed << entry.second << "%" << endl;
-            }
-            cout << "\n(Note) 2016 will not be accurate." << endl;
-            cout << "----------------------------------------------------------------" << endl;
+            printAirportReport(table, dataset->cube, trends, airportId, travel_month);
             cout << "Trie Efficiency: " << endl;
-            measureTrie(file);
+            measureTrie(*trie, buildMicroseconds, buildBytes);
+            measureAirportTable(*dataset, loadMicroseconds);
 
             break;
         }
-        default:
-            cout << "Invalid choice." << endl;
+        case 3: {
+            AirportRecords records = flat.find(airport_code);
+            int airportId = table.findAirport(airport_code);
+            if (records.empty() || airportId < 0) {
+                cout << "No data found for the entered airport code." << endl;
+                printSuggestions(*dataset, airport_code);
+                return 0;
+            }
+            cout << "Accessing Airport Data using Flat Hash Index..." << endl;
+            printAirportReport(table, dataset->cube, trends, airportId, travel_month);
+            cout << "Flat Index Efficiency:" << endl;
+            measureFlatIndex(flat, buildMicroseconds, buildBytes);
+            measureAirportTable(*dataset, loadMicroseconds);
+            break;
+        }
     }
     return 0;
 }
-
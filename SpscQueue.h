@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+
+// Bounded lock-free queue between exactly one producer thread and one consumer thread
+// A ring of Capacity slots; each side owns one index, on its own cache line, and only reads
+// the other's. push() waits while the ring is full, which is what holds a fast stage back
+// Waiting spins briefly, then yields, then sleeps, so a stalled stage does not burn a core
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool tryPush(T& value) {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - headIndex.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[tail & (Capacity - 1)] = std::move(value);
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(slots[head & (Capacity - 1)]);
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(T value) {
+        for (size_t waits = 0; !tryPush(value); waits++) {
+            backOff(waits);
+        }
+    }
+    void pop(T& value) {
+        for (size_t waits = 0; !tryPop(value); waits++) {
+            backOff(waits);
+        }
+    }
+
+private:
+    static void backOff(size_t waits) {
+        if (waits < 64) {
+            return;
+        }
+        if (waits < 1024) {
+            std::this_thread::yield();
+        }
+        else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    alignas(64) std::atomic<size_t> headIndex{ 0 }; // Next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tailIndex{ 0 }; // Next slot to push, written by the producer
+    alignas(64) T slots[Capacity];
+};
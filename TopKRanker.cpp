@@ -0,0 +1,171 @@
+#include "TopKRanker.h"
+#include "Metrics.h"
+
+#include <algorithm>
+
+using namespace std;
+
+static const char* const METRIC_NAMES[RANK_METRIC_COUNT] = {
+    "delay",           "cancel",        "carrier",       "late",          "navis",
+    "security",        "weather",       "divert",        "minutes",       "carrier-minutes",
+    "late-minutes",    "navis-minutes", "security-minutes", "weather-minutes"
+};
+
+const char* rankMetricName(RankMetric metric) {
+    return metric >= 0 && metric < RANK_METRIC_COUNT ? METRIC_NAMES[metric] : "unknown";
+}
+
+RankMetric parseRankMetric(string_view name) {
+    for (int m = 0; m < RANK_METRIC_COUNT; m++) {
+        if (name == METRIC_NAMES[m]) {
+            return static_cast<RankMetric>(m);
+        }
+    }
+    return RANK_METRIC_COUNT;
+}
+
+static double percentage(long long numerator, long long denominator) {
+    return denominator == 0 ? 0.0 : static_cast<double>(numerator) / denominator * 100.0;
+}
+
+double rankValue(const CounterTotals& totals, RankMetric metric) {
+    switch (metric) {
+        case RANK_DELAY_RATE:
+            return delayRate(totals);
+        case RANK_CANCEL_RATE:
+            return percentage(totals[CANCELED_FLIGHTS], totals[TOTAL_FLIGHTS]);
+        case RANK_DIVERT_RATE:
+            return percentage(totals[DIVERTED_FLIGHTS], totals[TOTAL_FLIGHTS]);
+        case RANK_AVG_DELAY_MINUTES:
+            return averageDelayMinutes(totals);
+        case RANK_CARRIER_SHARE:
+        case RANK_LATE_SHARE:
+        case RANK_NAVIS_SHARE:
+        case RANK_SECURITY_SHARE:
+        case RANK_WEATHER_SHARE: {
+            long long causes = 0;
+            for (int c = CARRIER_DELAYS; c <= WEATHER_DELAYS; c++) {
+                causes += totals[c];
+            }
+            return percentage(totals[CARRIER_DELAYS + (metric - RANK_CARRIER_SHARE)], causes);
+        }
+        default:
+            return minuteShare(totals, static_cast<CounterColumn>(CARRIER_MINUTES + (metric - RANK_CARRIER_MINUTES_SHARE)));
+    }
+}
+
+uint32_t rankMetricColumns(RankMetric metric) {
+    switch (metric) {
+        case RANK_DELAY_RATE:
+        case RANK_CANCEL_RATE:
+            return REQUIRED_COUNTERS;
+        case RANK_DIVERT_RATE:
+            return REQUIRED_COUNTERS | (1u << DIVERTED_FLIGHTS);
+        case RANK_AVG_DELAY_MINUTES:
+            return REQUIRED_COUNTERS | (1u << DELAY_MINUTES);
+        case RANK_CARRIER_SHARE:
+        case RANK_LATE_SHARE:
+        case RANK_NAVIS_SHARE:
+        case RANK_SECURITY_SHARE:
+        case RANK_WEATHER_SHARE: {
+            uint32_t columns = 0;
+            for (int c = CARRIER_DELAYS; c <= WEATHER_DELAYS; c++) {
+                columns |= 1u << c;
+            }
+            return columns;
+        }
+        default:
+            return (1u << DELAY_MINUTES) | (1u << (CARRIER_MINUTES + (metric - RANK_CARRIER_MINUTES_SHARE)));
+    }
+}
+
+// Strict order used everywhere: higher value first, lower airport id on ties
+static bool better(const RankedAirport& a, const RankedAirport& b) {
+    return a.value > b.value || (a.value == b.value && a.airport < b.airport);
+}
+
+// False when the airport has no rows in the window, so it is not ranked at all
+static bool rankedValue(const AggregateCube& cube, int airport, RankMetric metric, RankWindow window,
+                        RankedAirport& entry) {
+    const CubeCell& cell = cube.cell(airport, window.year, window.month);
+    entry.airport = airport;
+    entry.value = rankValue(cell.totals, metric);
+    return cell.rows > 0;
+}
+
+vector<RankedAirport> topK(const AggregateCube& cube, size_t k, RankMetric metric, RankWindow window) {
+    METRICS_TIMER(timer, STAGE_RANK);
+    METRICS_ITEMS(timer, cube.airportCount());
+    // Heap of the best k so far with the worst of them on top, so each airport is
+    // compared with the cut-off once and only k entries are ever ordered
+    k = min(k, cube.airportCount());
+    vector<RankedAirport> heap;
+    heap.reserve(k + 1);
+    RankedAirport entry;
+    for (size_t a = 0; a < cube.airportCount() && k > 0; a++) {
+        if (!rankedValue(cube, static_cast<int>(a), metric, window, entry)) {
+            continue;
+        }
+        if (heap.size() < k) {
+            heap.push_back(entry);
+            push_heap(heap.begin(), heap.end(), better);
+        }
+        else if (better(entry, heap.front())) {
+            pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = entry;
+            push_heap(heap.begin(), heap.end(), better);
+        }
+    }
+    sort_heap(heap.begin(), heap.end(), better);
+    return heap;
+}
+
+TopKRanker::TopKRanker(const AggregateCube& cube, size_t k, RankMetric metric, RankWindow window)
+    : cube(&cube), k(k), metric(metric), window(window) {
+    reselect();
+}
+
+void TopKRanker::reselect() {
+    ranked = topK(*cube, k, metric, window);
+    stale = false;
+}
+
+void TopKRanker::update(int airport) {
+    if (stale || k == 0) {
+        return; // Rebuilt on the next top() anyway
+    }
+    RankedAirport entry;
+    bool present = rankedValue(*cube, airport, metric, window, entry);
+    auto member = find_if(ranked.begin(), ranked.end(), [&](const RankedAirport& r) { return r.airport == airport; });
+    if (member != ranked.end()) {
+        // Every unranked airport is worse than the current cut-off; the airport keeps
+        // its place unless it fell below that, in which case one of them may now be better
+        RankedAirport cutoff = ranked.back();
+        bool othersExist = cube->airportCount() > ranked.size();
+        if (!present || (othersExist && better(cutoff, entry))) {
+            stale = true;
+            return;
+        }
+        *member = entry;
+    }
+    else if (!present) {
+        return;
+    }
+    else if (ranked.size() < k) {
+        ranked.push_back(entry);
+    }
+    else if (better(entry, ranked.back())) {
+        ranked.back() = entry;
+    }
+    else {
+        return;
+    }
+    sort(ranked.begin(), ranked.end(), better);
+}
+
+const vector<RankedAirport>& TopKRanker::top() {
+    if (stale) {
+        reselect();
+    }
+    return ranked;
+}
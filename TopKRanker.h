@@ -0,0 +1,71 @@
+#pragma once
+
+#include "AggregateCube.h"
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// What airports are ranked by, every metric but the average minutes is a percentage
+enum RankMetric {
+    RANK_DELAY_RATE,     // Delayed + canceled over total flights
+    RANK_CANCEL_RATE,    // Canceled over total flights
+    RANK_CARRIER_SHARE,  // One delay cause over all counted delay causes
+    RANK_LATE_SHARE,
+    RANK_NAVIS_SHARE,
+    RANK_SECURITY_SHARE,
+    RANK_WEATHER_SHARE,
+    RANK_DIVERT_RATE,    // Diverted over total flights
+    RANK_AVG_DELAY_MINUTES, // Minutes delayed per delayed flight
+    RANK_CARRIER_MINUTES_SHARE, // One cause's minutes over all minutes delayed
+    RANK_LATE_MINUTES_SHARE,
+    RANK_NAVIS_MINUTES_SHARE,
+    RANK_SECURITY_MINUTES_SHARE,
+    RANK_WEATHER_MINUTES_SHARE,
+    RANK_METRIC_COUNT
+};
+
+const char* rankMetricName(RankMetric metric);
+// Accepts the names above ("delay", "cancel", "carrier", "minutes", "late-minutes", ...),
+// RANK_METRIC_COUNT if unknown
+RankMetric parseRankMetric(std::string_view name);
+double rankValue(const CounterTotals& totals, RankMetric metric);
+// Counter columns rankValue reads for the metric (see --columns)
+uint32_t rankMetricColumns(RankMetric metric);
+
+struct RankedAirport {
+    int airport;
+    double value;
+};
+
+// Cells of one (year, month) window of the cube; the defaults are the all-time totals
+struct RankWindow {
+    int year = AggregateCube::ALL_YEARS;
+    int month = AggregateCube::WHOLE_YEAR;
+};
+
+// The k highest-ranked airports, best first, by bounded heap selection in O(n log k)
+// Ties go to the lower airport id; airports without rows in the window are left out
+std::vector<RankedAirport> topK(const AggregateCube& cube, size_t k, RankMetric metric, RankWindow window = RankWindow());
+
+// Top k kept current while the cube changes: update() costs O(k) per changed airport,
+// a full reselect only happens when a ranked airport drops below the cut-off
+// The cube must outlive the ranker
+class TopKRanker {
+public:
+    TopKRanker(const AggregateCube& cube, size_t k, RankMetric metric, RankWindow window = RankWindow());
+
+    // Call after rows of `airport` were added to the cube (new airport ids are fine)
+    void update(int airport);
+    const std::vector<RankedAirport>& top();
+
+private:
+    void reselect();
+
+    const AggregateCube* cube;
+    size_t k;
+    RankMetric metric;
+    RankWindow window;
+    std::vector<RankedAirport> ranked; // Best first
+    bool stale = false;
+};
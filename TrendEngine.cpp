@@ -0,0 +1,168 @@
+#include "TrendEngine.h"
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+static const float NO_DATA = numeric_limits<float>::quiet_NaN();
+static const TrendPoint EMPTY_POINT = { NO_DATA, NO_DATA, NO_DATA, NO_DATA };
+
+static float rateOf(long long numerator, long long denominator) {
+    return denominator == 0 ? NO_DATA : static_cast<float>(static_cast<double>(numerator) / denominator * 100.0);
+}
+
+// Welford's running mean and variance of one month of the year
+struct RunningStats {
+    long long count = 0;
+    double mean = 0.0;
+    double squares = 0.0;
+
+    void add(double value) {
+        count++;
+        double delta = value - mean;
+        mean += delta / count;
+        squares += delta * (value - mean);
+    }
+    double deviation() const { return count > 1 ? sqrt(squares / (count - 1)) : 0.0; }
+};
+
+// Running sums of one airport while its months are streamed in time order
+struct AirportState {
+    long long window[12][2] = {}; // Last 12 months' (numerator, denominator), by month index % 12
+    long long sum3[2] = {};
+    long long sum12[2] = {};
+    long long year[2] = {};
+    RunningStats history[12];     // Monthly rates so far, per month of the year
+};
+
+TrendEngine::TrendEngine(const TableView& table, TrendConfig config) {
+    METRICS_TIMER(timer, STAGE_AGGREGATE);
+    METRICS_ITEMS(timer, table.rows);
+    airports = table.airports;
+    int maxYear = 0;
+    minYear = 4095;
+    for (size_t i = 0; i < table.rows; i++) {
+        minYear = min(minYear, periodYear(table.period[i]));
+        maxYear = max(maxYear, periodYear(table.period[i]));
+    }
+    years = max(0, maxYear - minYear + 1);
+    size_t months = static_cast<size_t>(years) * 12;
+
+    // The dense time axis, month-major like the CSV (every airport of a month, then the next
+    // month), so both the scatter and the stream below walk memory in order
+    // Only the three columns the rate needs are read
+    vector<long long> numerators(months * airports, 0);
+    vector<long long> denominators(months * airports, 0);
+    const int32_t* delayed = table.counters[DELAYED_FLIGHTS];
+    const int32_t* canceled = table.counters[CANCELED_FLIGHTS];
+    const int32_t* total = table.counters[TOTAL_FLIGHTS];
+    for (size_t i = 0; i < table.rows; i++) {
+        int month = periodMonth(table.period[i]);
+        if (month < 1 || month > 12) {
+            continue; // Not a real month, same as the cube
+        }
+        size_t t = static_cast<size_t>(periodYear(table.period[i]) - minYear) * 12 + month - 1;
+        numerators[t * airports + table.airport[i]] += delayed[i] + canceled[i];
+        denominators[t * airports + table.airport[i]] += total[i];
+    }
+
+    points.assign(months * airports, EMPTY_POINT);
+    yearly.assign(static_cast<size_t>(years) * airports, NO_DATA);
+    seasonal.assign(airports * 12, Baseline{ NO_DATA, NO_DATA });
+    latest.assign(airports, -1);
+    vector<AirportState> states(airports);
+    for (size_t t = 0; t < months; t++) {
+        int year = minYear + static_cast<int>(t / 12);
+        int month = static_cast<int>(t % 12) + 1;
+        size_t slot = t % 12;
+        size_t dropped = (t + 9) % 12; // Month index t - 3, leaving the 3-month window
+        for (size_t a = 0; a < airports; a++) {
+            AirportState& state = states[a];
+            long long numerator = numerators[t * airports + a];
+            long long denominator = denominators[t * airports + a];
+
+            // Slide the windows: drop the month leaving each one, add this one
+            state.sum12[0] += numerator - state.window[slot][0];
+            state.sum12[1] += denominator - state.window[slot][1];
+            if (t >= 3) {
+                state.sum3[0] -= state.window[dropped][0];
+                state.sum3[1] -= state.window[dropped][1];
+            }
+            state.sum3[0] += numerator;
+            state.sum3[1] += denominator;
+            state.window[slot][0] = numerator;
+            state.window[slot][1] = denominator;
+            state.year[0] += numerator;
+            state.year[1] += denominator;
+
+            TrendPoint& point = points[t * airports + a];
+            point.rolling3 = rateOf(state.sum3[0], state.sum3[1]);
+            point.rolling12 = rateOf(state.sum12[0], state.sum12[1]);
+            if (denominator > 0) {
+                point.rate = rateOf(numerator, denominator);
+                RunningStats& stats = state.history[month - 1];
+                if (stats.count >= config.minHistory) {
+                    double deviation = stats.deviation();
+                    if (deviation > 0.0) {
+                        point.zscore = static_cast<float>((point.rate - stats.mean) / deviation);
+                        if (fabs(point.zscore) >= config.threshold) {
+                            flagged.push_back(TrendAnomaly{ static_cast<int>(a), year, month, point.rate, stats.mean,
+                                                            deviation, point.zscore });
+                        }
+                    }
+                }
+                stats.add(point.rate);
+                latest[a] = static_cast<int>(t);
+            }
+            if (month == 12) {
+                yearly[static_cast<size_t>(year - minYear) * airports + a] = rateOf(state.year[0], state.year[1]);
+                state.year[0] = 0;
+                state.year[1] = 0;
+            }
+        }
+    }
+    for (size_t a = 0; a < airports; a++) {
+        for (int m = 0; m < 12; m++) {
+            const RunningStats& stats = states[a].history[m];
+            if (stats.count > 0) {
+                seasonal[a * 12 + m] = Baseline{ static_cast<float>(stats.mean), static_cast<float>(stats.deviation()) };
+            }
+        }
+    }
+    // Found in time order; the stable sort keeps that order within each airport
+    stable_sort(flagged.begin(), flagged.end(),
+                [](const TrendAnomaly& x, const TrendAnomaly& y) { return x.airport < y.airport; });
+}
+
+const TrendPoint& TrendEngine::point(int airport, int year, int month) const {
+    if (airport < 0 || static_cast<size_t>(airport) >= airports || year < minYear || year >= minYear + years || month < 1 ||
+        month > 12) {
+        return EMPTY_POINT;
+    }
+    return points[(static_cast<size_t>(year - minYear) * 12 + month - 1) * airports + airport];
+}
+
+float TrendEngine::yearlyRate(int airport, int year) const {
+    if (airport < 0 || static_cast<size_t>(airport) >= airports || year < minYear || year >= minYear + years) {
+        return NO_DATA;
+    }
+    return yearly[static_cast<size_t>(year - minYear) * airports + airport];
+}
+
+bool TrendEngine::lastMonth(int airport, int& year, int& month) const {
+    if (airport < 0 || static_cast<size_t>(airport) >= airports || latest[airport] < 0) {
+        return false;
+    }
+    year = minYear + latest[airport] / 12;
+    month = latest[airport] % 12 + 1;
+    return true;
+}
+
+size_t TrendEngine::memoryUsage() const {
+    return points.capacity() * sizeof(TrendPoint) + yearly.capacity() * sizeof(float) +
+           seasonal.capacity() * sizeof(Baseline) + latest.capacity() * sizeof(int) +
+           flagged.capacity() * sizeof(TrendAnomaly);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ColumnStore.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Delay/cancellation rates of one airport-month, as percentages; NaN when there is no data
+struct TrendPoint {
+    float rate;      // The month itself
+    float rolling3;  // Flight-weighted over the last 3 calendar months
+    float rolling12; // Flight-weighted over the last 12 calendar months
+    float zscore;    // Against the same month of earlier years, NaN without enough history
+};
+
+// A month whose rate is far from its seasonal baseline
+struct TrendAnomaly {
+    int airport;
+    int year;
+    int month;
+    double rate;
+    double baseline;  // Mean rate of the same month in earlier years
+    double deviation; // Their standard deviation
+    double zscore;
+};
+
+struct TrendConfig {
+    double threshold = 3.0; // |z| at or above which a month is flagged
+    int minHistory = 3;     // Earlier years of the same month needed before flagging
+};
+
+// Trends for every airport: the delayed, canceled and total columns are scattered once into a
+// dense (year * 12 + month, airport) axis, which is then streamed in time order. Each airport
+// keeps running sums for the rolling windows, per year, and per month of the year (Welford
+// mean/variance), so the cost is one visit per row and one per cell
+// Seasonal z-scores only look at earlier years, so a month is judged as it would have been then
+class TrendEngine {
+public:
+    TrendEngine() = default;
+    explicit TrendEngine(const TableView& table, TrendConfig config = TrendConfig());
+
+    int firstYear() const { return minYear; }
+    int lastYear() const { return minYear + years - 1; }
+    size_t airportCount() const { return airports; }
+
+    const TrendPoint& point(int airport, int year, int month) const;
+    // (delayed + canceled) / total over the year's months, NaN when the year has no flights
+    float yearlyRate(int airport, int year) const;
+    // Mean and standard deviation of one month of the year over every year with data
+    float seasonalMean(int airport, int month) const { return seasonal[static_cast<size_t>(airport) * 12 + month - 1].mean; }
+    float seasonalDeviation(int airport, int month) const {
+        return seasonal[static_cast<size_t>(airport) * 12 + month - 1].deviation;
+    }
+    // Latest month with data, false when the airport has none
+    bool lastMonth(int airport, int& year, int& month) const;
+    // Sorted by airport, then time
+    const std::vector<TrendAnomaly>& anomalies() const { return flagged; }
+    size_t memoryUsage() const;
+
+private:
+    struct Baseline {
+        float mean;
+        float deviation;
+    };
+
+    size_t airports = 0;
+    int minYear = 0;
+    int years = 0;
+    std::vector<TrendPoint> points; // years x 12 x airports
+    std::vector<float> yearly;      // years x airports
+    std::vector<Baseline> seasonal; // airports x 12
+    std::vector<int> latest;        // Month index of the latest data per airport, -1 if none
+    std::vector<TrendAnomaly> flagged;
+};